@@ -2,7 +2,9 @@
 
 #include <algorithm>
 #include <memory>
+#include <optional>
 #include <string>
+#include <tuple>
 #include <typeindex>
 #include <unordered_map>
 #include <unordered_set>
@@ -157,6 +159,23 @@ public:
         return component_ptr;
     }
 
+    /**
+     * Create a component and add it under one of its base classes.
+     * Lets a derived component stand in for the base, e.g. get_component<TBase>() returns it.
+     *
+     * @param args The arguments to forward to the component constructor.
+     * @return A pointer to the added component.
+     */
+    template <typename TBase, typename T, typename... TArgs>
+    T* add_component_as(TArgs&&... args)
+    {
+        static_assert(std::is_base_of<TBase, T>::value, "T must derive from TBase");
+        auto new_component = std::make_unique<T>(std::forward<TArgs>(args)...);
+        T* component_ptr = new_component.get();
+        add_component<TBase>(std::unique_ptr<TBase>(std::move(new_component)));
+        return component_ptr;
+    }
+
     /**
      * Get a component of the specified type.
      *
@@ -171,6 +190,18 @@ public:
             auto component = it->second.get();
             return static_cast<T*>(component);
         }
+        return static_cast<T*>(get_static_component(std::type_index(typeid(T))));
+    }
+
+    /**
+     * Get a component stored inline by StaticObject.
+     * For internal use only.
+     *
+     * @param type The type of the component.
+     * @return A pointer to the component, or nullptr if not found.
+     */
+    virtual Component* get_static_component(std::type_index type)
+    {
         return nullptr;
     }
 
@@ -206,6 +237,153 @@ public:
     }
 };
 
+/**
+ * A game object whose component types are known at compile time.
+ * The components are stored inline instead of in separately allocated blocks, and their lifecycle functions are
+ * called directly in the order they are listed, without virtual dispatch. get_component() for one of the listed
+ * types is resolved at compile time. Components can still be added with add_component() as usual.
+ * Use it for game objects there are a lot of, where the cost of dynamic components adds up.
+ *
+ * Each component is created in init() with emplace_component(), since most components need arguments.
+ */
+template <typename... Ts>
+class StaticObject : public GameObject
+{
+public:
+    static_assert((std::is_base_of<Component, Ts>::value && ...), "Ts must derive from Component");
+
+    std::tuple<std::optional<Ts>...> static_components;
+
+    /**
+     * Create one of the listed components in place.
+     *
+     * @param args The arguments to forward to the component constructor.
+     * @return A pointer to the component.
+     */
+    template <typename T, typename... TArgs>
+    T* emplace_component(TArgs&&... args)
+    {
+        auto& slot = std::get<std::optional<T>>(static_components);
+        if (slot)
+        {
+            TraceLog(LOG_ERROR, "Duplicate component added: %s", typeid(T).name());
+            return &*slot;
+        }
+        slot.emplace(std::forward<TArgs>(args)...);
+        slot->owner = this;
+        return &*slot;
+    }
+
+    /**
+     * Get a component of the specified type.
+     * Listed component types are looked up at compile time, anything else falls back to the dynamic components.
+     *
+     * @return A pointer to the component, or nullptr if not found.
+     */
+    template <typename T>
+    T* get_component()
+    {
+        if constexpr ((std::is_same<T, Ts>::value || ...))
+        {
+            auto& slot = std::get<std::optional<T>>(static_components);
+            return slot ? &*slot : nullptr;
+        }
+        else
+        {
+            return GameObject::get_component<T>();
+        }
+    }
+
+    Component* get_static_component(std::type_index type) override
+    {
+        Component* found = nullptr;
+        ((type == std::type_index(typeid(Ts)) ? (void)(found = get_component<Ts>()) : (void)0), ...);
+        return found;
+    }
+
+    void init_object() override
+    {
+        init();
+        (init_component<Ts>(), ...);
+        for (auto& component : components)
+        {
+            component.second->init();
+        }
+    }
+
+    void update_object(float delta_time) override
+    {
+        if (!is_active)
+        {
+            return;
+        }
+        update(delta_time);
+        (update_component<Ts>(delta_time), ...);
+        for (auto& component : components)
+        {
+            component.second->update(delta_time);
+        }
+    }
+
+    void draw_object() override
+    {
+        if (!is_active)
+        {
+            return;
+        }
+        draw();
+        (draw_component<Ts>(), ...);
+        for (auto& component : components)
+        {
+            component.second->draw();
+        }
+    }
+
+    /**
+     * Initialize one of the listed components, if it was created.
+     * For internal use only.
+     */
+    template <typename T>
+    void init_component()
+    {
+        auto& slot = std::get<std::optional<T>>(static_components);
+        if (slot)
+        {
+            slot->T::init();
+        }
+    }
+
+    /**
+     * Update one of the listed components, if it was created.
+     * For internal use only.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    template <typename T>
+    void update_component(float delta_time)
+    {
+        auto& slot = std::get<std::optional<T>>(static_components);
+        if (slot)
+        {
+            slot->T::update(delta_time);
+        }
+    }
+
+    /**
+     * Draw one of the listed components, if it was created.
+     * For internal use only.
+     */
+    template <typename T>
+    void draw_component()
+    {
+        auto& slot = std::get<std::optional<T>>(static_components);
+        if (slot)
+        {
+            slot->T::draw();
+        }
+    }
+};
+
 /**
  * The base class for all services.
  * Services provide Scene level functionality and are accessible by all game objects in the scene.
@@ -280,6 +458,13 @@ public:
      */
     virtual void init() {}
 
+    /**
+     * Lifecycle function called every frame before the current scene is updated.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    virtual void update(float delta_time) {}
+
     /**
      * Initialize the manager.
      */
@@ -432,6 +617,31 @@ public:
         return new_object;
     }
 
+    /**
+     * Remove game objects from the scene.
+     * Must not be called while the scene is iterating its game objects, e.g. from GameObject::update().
+     *
+     * @param to_remove The game objects to remove.
+     */
+    void remove_game_objects(const std::vector<std::shared_ptr<GameObject>>& to_remove)
+    {
+        if (to_remove.empty())
+        {
+            return;
+        }
+        std::unordered_set<GameObject*> lookup;
+        lookup.reserve(to_remove.size());
+        for (auto& game_object : to_remove)
+        {
+            lookup.insert(game_object.get());
+        }
+        game_objects.erase(std::remove_if(game_objects.begin(),
+                                          game_objects.end(),
+                                          [&](const std::shared_ptr<GameObject>& game_object)
+                                          { return lookup.find(game_object.get()) != lookup.end(); }),
+                           game_objects.end());
+    }
+
     /**
      * Add a service to the scene.
      *
@@ -470,6 +680,24 @@ public:
         return service_ptr;
     }
 
+    /**
+     * Check if the scene has a service of the specified type.
+     *
+     * @return True if the service has been added, false otherwise.
+     */
+    template <typename T>
+    bool has_service() const
+    {
+        for (auto& service : services)
+        {
+            if (std::get<0>(service) == std::type_index(typeid(T)))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
     /**
      * Get a service of the specified type.
      *
@@ -542,12 +770,17 @@ public:
     }
 
     /**
-     * Update the current scene.
+     * Update the managers and the current scene.
      *
      * @param delta_time The time elapsed since the last frame.
      */
     void update(float delta_time)
     {
+        for (auto& manager : managers)
+        {
+            manager.second->update(delta_time);
+        }
+
         if (current_scene)
         {
             // Scene is only initialized if it wasn't already.
@@ -0,0 +1,358 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <raylib.h>
+
+#include "engine/thread_pool.h"
+
+/**
+ * A glyph in a GlyphCache's atlas.
+ */
+struct CachedGlyph
+{
+    int offset_x = 0;
+    int offset_y = 0;
+    int advance_x = 0;
+    Rectangle rec = {0, 0, 0, 0};
+    int shelf = -1;
+    bool ready = false;
+};
+
+/**
+ * A row of the atlas. Glyphs are packed left to right and the whole row is evicted at once.
+ */
+struct GlyphShelf
+{
+    int y = 0;
+    int height = 0;
+    int x = 0;
+    unsigned int last_used = 0;
+    std::vector<int> codepoints;
+};
+
+/**
+ * A glyph rasterized on a worker thread, waiting to be packed into the atlas.
+ */
+struct RasterizedGlyph
+{
+    int codepoint = 0;
+    int offset_x = 0;
+    int offset_y = 0;
+    int advance_x = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+};
+
+/**
+ * A font atlas that is filled in as glyphs are used, for scripts with too many characters to bake up front.
+ * Glyphs are rasterized from the font file on a worker thread the first time they are asked for and uploaded to
+ * the atlas on the main thread in update(). When the atlas is full, the least recently used shelf of glyphs is
+ * evicted. Memory is proportional to the glyphs actually on screen rather than the size of the script.
+ */
+class GlyphCache
+{
+public:
+    std::vector<unsigned char> font_data;
+    int font_size = 32;
+    int padding = 1;
+    int atlas_width = 1024;
+    int atlas_height = 1024;
+    Texture2D texture = {0};
+
+    std::unordered_map<int, CachedGlyph> glyphs;
+    std::vector<GlyphShelf> shelves;
+
+    // Bumped when glyphs are added or evicted, so text laid out with the cache knows to lay out again.
+    int version = 0;
+    int eviction_version = 0;
+    unsigned int frame = 1;
+
+    std::mutex finished_mutex;
+    std::vector<RasterizedGlyph> finished;
+
+    // Declared last so the workers finish before anything they use is destroyed.
+    ThreadPool workers;
+
+    /**
+     * Constructor for GlyphCache.
+     *
+     * @param filename The font file to rasterize glyphs from.
+     * @param font_size The size to rasterize glyphs at.
+     * @param atlas_size The width and height of the atlas texture.
+     */
+    GlyphCache(const std::string& filename, int font_size = 32, int atlas_size = 1024) :
+        font_size(font_size),
+        atlas_width(atlas_size),
+        atlas_height(atlas_size),
+        workers(1)
+    {
+        int size = 0;
+        unsigned char* data = LoadFileData(filename.c_str(), &size);
+        if (data == nullptr)
+        {
+            TraceLog(LOG_ERROR, "Failed to load font file: %s", filename.c_str());
+        }
+        else
+        {
+            font_data.assign(data, data + size);
+            UnloadFileData(data);
+        }
+
+        Image atlas = GenImageColor(atlas_width, atlas_height, BLANK);
+        texture = LoadTextureFromImage(atlas);
+        UnloadImage(atlas);
+        SetTextureFilter(texture, TEXTURE_FILTER_BILINEAR);
+    }
+
+    ~GlyphCache()
+    {
+        UnloadTexture(texture);
+    }
+
+    /**
+     * Get a glyph, starting to rasterize it if it hasn't been asked for before.
+     *
+     * @param codepoint The codepoint of the glyph.
+     * @return The glyph, or nullptr if it isn't in the atlas yet.
+     */
+    const CachedGlyph* get(int codepoint)
+    {
+        auto it = glyphs.find(codepoint);
+        if (it == glyphs.end())
+        {
+            request(codepoint);
+            return nullptr;
+        }
+        if (!it->second.ready)
+        {
+            return nullptr;
+        }
+        touch_shelf(it->second.shelf);
+        return &it->second;
+    }
+
+    /**
+     * Mark a shelf as used this frame so it isn't evicted.
+     *
+     * @param shelf The index of the shelf. Negative indices are ignored.
+     */
+    void touch_shelf(int shelf)
+    {
+        if (shelf >= 0)
+        {
+            shelves[shelf].last_used = frame;
+        }
+    }
+
+    /**
+     * Start rasterizing a glyph on the worker thread.
+     * For internal use only.
+     *
+     * @param codepoint The codepoint of the glyph.
+     */
+    void request(int codepoint)
+    {
+        glyphs[codepoint] = CachedGlyph();
+        if (font_data.empty())
+        {
+            return;
+        }
+
+        workers.submit(
+            [this, codepoint]()
+            {
+                RasterizedGlyph result;
+                result.codepoint = codepoint;
+                int requested = codepoint;
+                GlyphInfo* info =
+                    LoadFontData(font_data.data(), (int)font_data.size(), font_size, &requested, 1, FONT_DEFAULT);
+                if (info)
+                {
+                    const Image& image = info[0].image;
+                    result.offset_x = info[0].offsetX;
+                    result.offset_y = info[0].offsetY;
+                    result.advance_x = info[0].advanceX;
+                    result.width = image.width;
+                    result.height = image.height;
+                    if (image.data)
+                    {
+                        // Grayscale, one byte per pixel.
+                        auto pixels = static_cast<const unsigned char*>(image.data);
+                        result.pixels.assign(pixels, pixels + image.width * image.height);
+                    }
+                    UnloadFontData(info, 1);
+                }
+
+                std::lock_guard<std::mutex> lock(finished_mutex);
+                finished.push_back(std::move(result));
+            });
+    }
+
+    /**
+     * Pack the glyphs finished since the last frame into the atlas.
+     * Must be called on the main thread once per frame. FontManager does this for the caches it owns.
+     */
+    void update()
+    {
+        frame++;
+
+        std::vector<RasterizedGlyph> ready;
+        {
+            std::lock_guard<std::mutex> lock(finished_mutex);
+            ready.swap(finished);
+        }
+
+        std::vector<Color> pixels;
+        for (auto& result : ready)
+        {
+            auto it = glyphs.find(result.codepoint);
+            if (it == glyphs.end())
+            {
+                continue;
+            }
+            CachedGlyph& glyph = it->second;
+            glyph.offset_x = result.offset_x;
+            glyph.offset_y = result.offset_y;
+            glyph.advance_x = result.advance_x;
+
+            // Whitespace has nothing to draw.
+            if (result.width == 0 || result.height == 0 || result.pixels.empty())
+            {
+                glyph.ready = true;
+                version++;
+                continue;
+            }
+
+            int width = result.width + padding * 2;
+            int height = result.height + padding * 2;
+            int shelf = -1;
+            Rectangle area;
+            if (!allocate(width, height, shelf, area))
+            {
+                // Everything is in use this frame. Forget the glyph so it is asked for again later.
+                TraceLog(LOG_WARNING, "Glyph cache is full, could not add codepoint %d", result.codepoint);
+                glyphs.erase(it);
+                continue;
+            }
+
+            // White with the coverage in alpha, padded with a transparent border so bilinear sampling is clean.
+            pixels.assign(width * height, BLANK);
+            for (int y = 0; y < result.height; y++)
+            {
+                for (int x = 0; x < result.width; x++)
+                {
+                    unsigned char alpha = result.pixels[y * result.width + x];
+                    pixels[(y + padding) * width + x + padding] = Color{255, 255, 255, alpha};
+                }
+            }
+            UpdateTextureRec(texture, area, pixels.data());
+
+            glyph.rec = {area.x + padding, area.y + padding, (float)result.width, (float)result.height};
+            glyph.shelf = shelf;
+            glyph.ready = true;
+            shelves[shelf].codepoints.push_back(result.codepoint);
+            shelves[shelf].last_used = frame;
+            version++;
+        }
+    }
+
+    /**
+     * Find space in the atlas, evicting the least recently used shelf if needed.
+     * For internal use only.
+     *
+     * @param width The width needed in pixels.
+     * @param height The height needed in pixels.
+     * @param shelf Set to the index of the shelf the space is on.
+     * @param area Set to the space in the atlas.
+     * @return True if space was found, false otherwise.
+     */
+    bool allocate(int width, int height, int& shelf, Rectangle& area)
+    {
+        if (width > atlas_width || height > atlas_height)
+        {
+            return false;
+        }
+
+        // The shortest shelf the glyph fits on wastes the least space.
+        shelf = -1;
+        for (int i = 0; i < (int)shelves.size(); i++)
+        {
+            const auto& candidate = shelves[i];
+            if (candidate.height >= height && candidate.x + width <= atlas_width &&
+                (shelf < 0 || candidate.height < shelves[shelf].height))
+            {
+                shelf = i;
+            }
+        }
+
+        if (shelf < 0)
+        {
+            // Round shelf heights up so glyphs of similar sizes can share them.
+            int shelf_height = (height + 7) / 8 * 8;
+            int next_y = shelves.empty() ? 0 : shelves.back().y + shelves.back().height;
+            if (next_y + shelf_height <= atlas_height)
+            {
+                GlyphShelf new_shelf;
+                new_shelf.y = next_y;
+                new_shelf.height = shelf_height;
+                shelves.push_back(new_shelf);
+                shelf = (int)shelves.size() - 1;
+            }
+            else if (next_y + height <= atlas_height)
+            {
+                GlyphShelf new_shelf;
+                new_shelf.y = next_y;
+                new_shelf.height = height;
+                shelves.push_back(new_shelf);
+                shelf = (int)shelves.size() - 1;
+            }
+        }
+
+        if (shelf < 0)
+        {
+            // Evict the least recently used shelf that is tall enough. Shelves drawn last frame are still on screen.
+            for (int i = 0; i < (int)shelves.size(); i++)
+            {
+                const auto& candidate = shelves[i];
+                if (candidate.height >= height && candidate.last_used + 1 < frame &&
+                    (shelf < 0 || candidate.last_used < shelves[shelf].last_used))
+                {
+                    shelf = i;
+                }
+            }
+            if (shelf < 0)
+            {
+                return false;
+            }
+            evict(shelf);
+        }
+
+        GlyphShelf& target = shelves[shelf];
+        area = {(float)target.x, (float)target.y, (float)width, (float)height};
+        target.x += width;
+        return true;
+    }
+
+    /**
+     * Remove every glyph on a shelf.
+     * For internal use only.
+     *
+     * @param shelf The index of the shelf.
+     */
+    void evict(int shelf)
+    {
+        for (int codepoint : shelves[shelf].codepoints)
+        {
+            glyphs.erase(codepoint);
+        }
+        shelves[shelf].codepoints.clear();
+        shelves[shelf].x = 0;
+        eviction_version++;
+        version++;
+    }
+};
@@ -4,6 +4,7 @@
 #include "engine/prefabs/managers.h"
 #include "engine/prefabs/services.h"
 #include "engine/raycasts.h"
+#include "engine/text_layout.h"
 
 /**
  * For when you want a GameObject to have multiple of the same component.
@@ -12,7 +13,8 @@ template <typename T>
 class MultiComponent : public Component
 {
 public:
-    std::unordered_map<std::string, std::unique_ptr<T>> components;
+    // Usually only a few, so they are kept inline and searched in order.
+    SmallVector<std::pair<InternedName, std::unique_ptr<T>>, 4> components;
 
     MultiComponent() {}
 
@@ -57,11 +59,20 @@ public:
      * @param name The name to give the component.
      * @param component The component to add.
      */
-    void add_component(std::string name, std::unique_ptr<T> component)
+    void add_component(std::string_view name, std::unique_ptr<T> component)
     {
         static_assert(std::is_base_of<Component, T>::value, "T must derive from Component");
-        components[name] = std::move(component);
-        components[name]->owner = owner;
+        component->owner = owner;
+        InternedName interned(name);
+        for (auto& entry : components)
+        {
+            if (entry.first == interned)
+            {
+                entry.second = std::move(component);
+                return;
+            }
+        }
+        components.emplace_back(interned, std::move(component));
     }
 
     /**
@@ -72,7 +83,7 @@ public:
      * @return A pointer to the added component.
      */
     template <typename... TArgs>
-    T* add_component(std::string name, TArgs&&... args)
+    T* add_component(std::string_view name, TArgs&&... args)
     {
         static_assert(std::is_base_of<Component, T>::value, "T must derive from Component");
         auto new_component = std::make_unique<T>(std::forward<TArgs>(args)...);
@@ -85,11 +96,19 @@ public:
      * Get a component by name.
      *
      * @param name The name of the component.
-     * @return A pointer to the component.
+     * @return A pointer to the component, or nullptr if not found.
      */
-    T* get_component(std::string name)
+    T* get_component(std::string_view name)
     {
-        return components[name].get();
+        InternedName interned = InternedName::find(name);
+        for (auto& entry : components)
+        {
+            if (entry.first == interned)
+            {
+                return entry.second.get();
+            }
+        }
+        return nullptr;
     }
 };
 
@@ -108,6 +127,9 @@ public:
     Vector2 position = {0, 0};
     float rotation = 0.0f;
 
+    // Glyph quads laid out when the text, font or size change.
+    TextLayout layout;
+
     /**
      * Constructor for TextComponent.
      *
@@ -137,12 +159,36 @@ public:
      */
     void draw() override
     {
-        DrawTextEx(font_manager->get_font(font_name),
-                   text.c_str(),
-                   position,
-                   static_cast<float>(font_size),
-                   1.0f,
-                   color);
+        update_layout();
+        layout.draw(position, color);
+    }
+
+    /**
+     * Get the size of the text.
+     *
+     * @return The size in pixels.
+     */
+    Vector2 get_size()
+    {
+        update_layout();
+        return layout.get_size();
+    }
+
+    /**
+     * Pass the current text settings to the layout. It only lays the text out again if something changed.
+     * For internal use only.
+     */
+    void update_layout()
+    {
+        GlyphCache* glyph_cache = font_manager->get_glyph_cache(font_name);
+        layout.set_glyph_cache(glyph_cache);
+        if (!glyph_cache)
+        {
+            layout.shader = font_manager->get_shader(font_name);
+            layout.set_font(font_manager->get_font(font_name));
+        }
+        layout.set_font_size(static_cast<float>(font_size));
+        layout.set_text(text);
     }
 
     /**
@@ -246,7 +292,7 @@ public:
     /**
      * Play the sound.
      */
-    void play()
+    virtual void play()
     {
         PlaySound(sound);
     }
@@ -254,7 +300,7 @@ public:
     /**
      * Stop the sound.
      */
-    void stop()
+    virtual void stop()
     {
         StopSound(sound);
     }
@@ -264,7 +310,7 @@ public:
      *
      * @param volume The volume to set.
      */
-    void set_volume(float volume)
+    virtual void set_volume(float volume)
     {
         this->volume = volume;
         SetSoundVolume(sound, volume);
@@ -331,7 +377,7 @@ public:
      */
     BodyComponent(std::function<void(BodyComponent&)> build = {}) : build(std::move(build)) {}
 
-    ~BodyComponent()
+    virtual ~BodyComponent()
     {
         if (b2Body_IsValid(id))
         {
@@ -351,10 +397,20 @@ public:
         }
     }
 
+    /**
+     * Check if the body exists in the physics simulation.
+     *
+     * @return True if the body is valid, false otherwise.
+     */
+    virtual bool is_valid() const
+    {
+        return b2Body_IsValid(id);
+    }
+
     /**
      * Enable the body in the physics simulation.
      */
-    void enable()
+    virtual void enable()
     {
         b2Body_Enable(id);
     }
@@ -362,7 +418,7 @@ public:
     /**
      * Disable the body in the physics simulation.
      */
-    void disable()
+    virtual void disable()
     {
         b2Body_Disable(id);
     }
@@ -370,7 +426,7 @@ public:
     /**
      * Get the position of the body in meters.
      */
-    b2Vec2 get_position_meters() const
+    virtual b2Vec2 get_position_meters() const
     {
         return b2Body_GetPosition(id);
     }
@@ -378,7 +434,7 @@ public:
     /**
      * Get the position of the body in pixels.
      */
-    Vector2 get_position_pixels() const
+    virtual Vector2 get_position_pixels() const
     {
         return physics->convert_to_pixels(get_position_meters());
     }
@@ -388,7 +444,7 @@ public:
      *
      * @param meters The position in meters.
      */
-    void set_position(b2Vec2 meters)
+    virtual void set_position(b2Vec2 meters)
     {
         b2Rot rotation = b2Body_GetRotation(id);
         b2Body_SetTransform(id, meters, rotation);
@@ -399,7 +455,7 @@ public:
      *
      * @param pixels The position in pixels.
      */
-    void set_position(Vector2 pixels)
+    virtual void set_position(Vector2 pixels)
     {
         set_position(physics->convert_to_meters(pixels));
     }
@@ -409,7 +465,7 @@ public:
      *
      * @param degrees The rotation in degrees.
      */
-    void set_rotation(float degrees)
+    virtual void set_rotation(float degrees)
     {
         b2Vec2 position = b2Body_GetPosition(id);
         b2Rot rotation = b2MakeRot(degrees * DEG2RAD);
@@ -421,7 +477,7 @@ public:
      *
      * @return The velocity in meters per second.
      */
-    b2Vec2 get_velocity_meters() const
+    virtual b2Vec2 get_velocity_meters() const
     {
         return b2Body_GetLinearVelocity(id);
     }
@@ -431,7 +487,7 @@ public:
      *
      * @return The velocity in pixels per second.
      */
-    Vector2 get_velocity_pixels() const
+    virtual Vector2 get_velocity_pixels() const
     {
         return physics->convert_to_pixels(get_velocity_meters());
     }
@@ -441,7 +497,7 @@ public:
      *
      * @param meters_per_second The velocity in meters per second.
      */
-    void set_velocity(b2Vec2 meters_per_second)
+    virtual void set_velocity(b2Vec2 meters_per_second)
     {
         b2Body_SetLinearVelocity(id, meters_per_second);
     }
@@ -451,7 +507,7 @@ public:
      *
      * @param pixels_per_second The velocity in pixels per second.
      */
-    void set_velocity(Vector2 pixels_per_second)
+    virtual void set_velocity(Vector2 pixels_per_second)
     {
         set_velocity(physics->convert_to_meters(pixels_per_second));
     }
@@ -461,7 +517,7 @@ public:
      *
      * @return The rotation in degrees.
      */
-    float get_rotation() const
+    virtual float get_rotation() const
     {
         auto rot = b2Body_GetRotation(id);
         return b2Rot_GetAngle(rot) * RAD2DEG;
@@ -473,7 +529,7 @@ public:
      *
      * @return A list of b2BodyIds that are touching this one. Combine with User Data to get your objects.
      */
-    std::vector<b2BodyId> get_contacts()
+    virtual std::vector<b2BodyId> get_contacts()
     {
         // Choose 10 as an arbitrary max number of contacts on the body.
         constexpr int capacity = 10;
@@ -504,7 +560,7 @@ public:
      * @return A list of b2BodyIds that are overlapping the sensor shapes in this body. Combine with User Data to get
      * your objects.
      */
-    std::vector<b2BodyId> get_sensor_overlaps()
+    virtual std::vector<b2BodyId> get_sensor_overlaps()
     {
         // Choose 10 as an arbitrary max number of shapes on the body.
         constexpr int shape_capacity = 10;
@@ -542,6 +598,444 @@ public:
     }
 };
 
+/**
+ * A body simulated by TilePhysicsService instead of Box2D.
+ * Add it in place of a BodyComponent with add_component_as<BodyComponent, TileBodyComponent>() so other components
+ * find it through get_component<BodyComponent>().
+ * The body is an axis-aligned box that only collides with the level's tile grid. It has no rotation, contacts, or
+ * sensor overlaps.
+ * Depends on TilePhysicsService.
+ */
+class TileBodyComponent : public BodyComponent
+{
+public:
+    TilePhysicsService* tile_physics = nullptr;
+    std::shared_ptr<TileActors> actors;
+    int actor = -1;
+    Vector2 start_position;
+    Vector2 size;
+
+    /**
+     * Constructor for TileBodyComponent.
+     *
+     * @param position The starting center of the body in pixels.
+     * @param size The size of the body in pixels.
+     */
+    TileBodyComponent(Vector2 position, Vector2 size) :
+        BodyComponent(std::function<void(BodyComponent&)>()),
+        start_position(position),
+        size(size)
+    {
+    }
+
+    ~TileBodyComponent()
+    {
+        if (actors)
+        {
+            actors->remove(actor);
+        }
+    }
+
+    /**
+     * Initialize the body component.
+     */
+    void init() override
+    {
+        tile_physics = owner->scene->get_service<TilePhysicsService>();
+        actors = tile_physics->actors;
+        actor = actors->add(start_position, size, owner);
+    }
+
+    /**
+     * Check if the body is standing on a solid cell.
+     *
+     * @return True if the body is grounded, false otherwise.
+     */
+    bool is_grounded() const
+    {
+        return actors->flags[actor] & TileActors::grounded;
+    }
+
+    /**
+     * Check if the body is against a solid cell on its left.
+     *
+     * @return True if the body is on a wall, false otherwise.
+     */
+    bool is_on_wall_left() const
+    {
+        return actors->flags[actor] & TileActors::on_wall_left;
+    }
+
+    /**
+     * Check if the body is against a solid cell on its right.
+     *
+     * @return True if the body is on a wall, false otherwise.
+     */
+    bool is_on_wall_right() const
+    {
+        return actors->flags[actor] & TileActors::on_wall_right;
+    }
+
+    /**
+     * Check if the body is against a solid cell above it.
+     *
+     * @return True if the body is touching a ceiling, false otherwise.
+     */
+    bool is_on_ceiling() const
+    {
+        return actors->flags[actor] & TileActors::on_ceiling;
+    }
+
+    bool is_valid() const override
+    {
+        return actors && actor >= 0;
+    }
+
+    void enable() override
+    {
+        actors->flags[actor] |= TileActors::enabled;
+    }
+
+    void disable() override
+    {
+        actors->flags[actor] &= ~TileActors::enabled;
+    }
+
+    b2Vec2 get_position_meters() const override
+    {
+        return tile_physics->convert_to_meters(get_position_pixels());
+    }
+
+    Vector2 get_position_pixels() const override
+    {
+        return {actors->x[actor], actors->y[actor]};
+    }
+
+    void set_position(b2Vec2 meters) override
+    {
+        set_position(tile_physics->convert_to_pixels(meters));
+    }
+
+    void set_position(Vector2 pixels) override
+    {
+        actors->x[actor] = pixels.x;
+        actors->y[actor] = pixels.y;
+    }
+
+    void set_rotation(float degrees) override {}
+
+    b2Vec2 get_velocity_meters() const override
+    {
+        return tile_physics->convert_to_meters(get_velocity_pixels());
+    }
+
+    Vector2 get_velocity_pixels() const override
+    {
+        return {actors->velocity_x[actor], actors->velocity_y[actor]};
+    }
+
+    void set_velocity(b2Vec2 meters_per_second) override
+    {
+        set_velocity(tile_physics->convert_to_pixels(meters_per_second));
+    }
+
+    void set_velocity(Vector2 pixels_per_second) override
+    {
+        actors->velocity_x[actor] = pixels_per_second.x;
+        actors->velocity_y[actor] = pixels_per_second.y;
+    }
+
+    float get_rotation() const override
+    {
+        return 0.0f;
+    }
+
+    std::vector<b2BodyId> get_contacts() override
+    {
+        return {};
+    }
+
+    std::vector<b2BodyId> get_sensor_overlaps() override
+    {
+        return {};
+    }
+};
+
+/**
+ * A sound that plays from a place in the world, attenuated and panned by the AudioListenerService.
+ * Depends on SoundService and AudioListenerService.
+ */
+class PositionalSoundComponent : public SoundComponent
+{
+public:
+    AudioListenerService* listener_service;
+    std::shared_ptr<SoundSources> sources;
+    BodyComponent* body = nullptr;
+    Vector2 position = {0, 0};
+    int source = -1;
+
+    /**
+     * Constructor for PositionalSoundComponent.
+     *
+     * @param filename The filename of the sound to load.
+     * @param body The body to follow, or nullptr to place the sound with set_position().
+     * @param volume The initial volume of the sound.
+     * @param pitch The initial pitch of the sound.
+     */
+    PositionalSoundComponent(std::string filename,
+                             BodyComponent* body = nullptr,
+                             float volume = 1.0f,
+                             float pitch = 1.0f) :
+        SoundComponent(filename, volume, pitch),
+        body(body)
+    {
+    }
+
+    ~PositionalSoundComponent()
+    {
+        if (sources)
+        {
+            sources->remove(source);
+        }
+    }
+
+    void init() override
+    {
+        SoundComponent::init();
+        listener_service = owner->scene->get_service<AudioListenerService>();
+        sources = listener_service->sources;
+        source = listener_service->add_source(sound, volume);
+        listener_service->set_source_position(source, position);
+    }
+
+    void update(float delta_time) override
+    {
+        follow_body();
+    }
+
+    /**
+     * Play the sound from the current position.
+     */
+    void play() override
+    {
+        follow_body();
+        listener_service->play(source);
+    }
+
+    /**
+     * Stop the sound.
+     */
+    void stop() override
+    {
+        listener_service->stop(source);
+    }
+
+    /**
+     * Set the volume of the sound before attenuation.
+     *
+     * @param volume The volume to set.
+     */
+    void set_volume(float volume) override
+    {
+        this->volume = volume;
+        listener_service->set_source_volume(source, volume);
+    }
+
+    /**
+     * Set the position of the sound.
+     *
+     * @param position The position in pixels.
+     */
+    void set_position(Vector2 position)
+    {
+        this->position = position;
+        if (source >= 0)
+        {
+            listener_service->set_source_position(source, position);
+        }
+    }
+
+    /**
+     * Move the sound to the body, if it has one.
+     * For internal use only.
+     */
+    void follow_body()
+    {
+        if (body && body->is_valid())
+        {
+            set_position(body->get_position_pixels());
+        }
+    }
+};
+
+/**
+ * A component for work that can run less often when the game object is far from the action, like AI.
+ * The callback is run by UpdateSchedulerService, every frame when near a focus point and less often further away,
+ * and is given the time since it last ran. It only runs while the game object is active.
+ * Depends on UpdateSchedulerService.
+ */
+class UpdateLODComponent : public Component
+{
+public:
+    std::function<void(float)> on_update;
+    BodyComponent* body = nullptr;
+    UpdateLODParams p;
+    Vector2 position = {0, 0};
+    std::shared_ptr<UpdateSchedule> schedule;
+    int slot = -1;
+
+    /**
+     * Constructor for UpdateLODComponent.
+     *
+     * @param on_update The update to run, given the time since it last ran.
+     * @param body The body to take the position from. If null, use set_position().
+     * @param p How often to update by distance.
+     */
+    UpdateLODComponent(std::function<void(float)> on_update,
+                       BodyComponent* body = nullptr,
+                       UpdateLODParams p = UpdateLODParams()) :
+        on_update(std::move(on_update)),
+        body(body),
+        p(p)
+    {
+    }
+
+    ~UpdateLODComponent()
+    {
+        if (schedule)
+        {
+            schedule->remove(slot);
+        }
+    }
+
+    /**
+     * Initialize the component.
+     */
+    void init() override
+    {
+        schedule = owner->scene->get_service<UpdateSchedulerService>()->schedule;
+        slot = schedule->add(p,
+                             [this](float delta_time)
+                             {
+                                 if (owner->is_active)
+                                 {
+                                     on_update(delta_time);
+                                 }
+                             });
+    }
+
+    /**
+     * Tell the scheduler where the game object is this frame.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        if (body && body->is_valid())
+        {
+            position = body->get_position_pixels();
+        }
+        schedule->report(slot, position);
+    }
+
+    /**
+     * Set the position used to pick how often to update, when not following a body.
+     *
+     * @param new_position The position in pixels.
+     */
+    void set_position(Vector2 new_position)
+    {
+        position = new_position;
+    }
+};
+
+/**
+ * A component that moves a kinematic body along a path of waypoints.
+ * The body is moved by PathFollowService together with every other mover, so the game object doesn't need to steer
+ * it in its own update. The mover is added once the body exists.
+ * Depends on PathFollowService and BodyComponent.
+ */
+class PathFollowComponent : public Component
+{
+public:
+    BodyComponent* body;
+    std::vector<Vector2> waypoints;
+    float speed;
+    bool loop;
+    PathFollowService* path_follow;
+    std::shared_ptr<PathMovers> movers;
+    int slot = -1;
+
+    /**
+     * Constructor for PathFollowComponent.
+     *
+     * @param body The kinematic body to move.
+     * @param waypoints The waypoints in pixels.
+     * @param speed The speed in pixels per second.
+     * @param loop True to loop the path, false to go back and forth along it.
+     */
+    PathFollowComponent(BodyComponent* body, std::vector<Vector2> waypoints, float speed, bool loop = false) :
+        body(body),
+        waypoints(std::move(waypoints)),
+        speed(speed),
+        loop(loop)
+    {
+    }
+
+    ~PathFollowComponent()
+    {
+        if (movers)
+        {
+            movers->remove(slot);
+        }
+    }
+
+    /**
+     * Initialize the component.
+     */
+    void init() override
+    {
+        path_follow = owner->scene->get_service<PathFollowService>();
+        movers = path_follow->movers;
+        add_mover();
+    }
+
+    /**
+     * Add the mover if the body wasn't created yet during init.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        if (slot < 0)
+        {
+            add_mover();
+        }
+    }
+
+    /**
+     * Get the velocity the body was given this frame.
+     *
+     * @return The velocity in pixels per second.
+     */
+    Vector2 get_velocity() const
+    {
+        return slot < 0 ? Vector2{0, 0} : path_follow->get_velocity(slot);
+    }
+
+    /**
+     * Add the mover to the service once the body exists.
+     * For internal use only.
+     */
+    void add_mover()
+    {
+        if (body->is_valid())
+        {
+            slot = path_follow->add_mover(body->id, waypoints, speed, loop);
+        }
+    }
+};
+
 /**
  * A component for rendering a sprite.
  * Depends on TextureService.
@@ -658,6 +1152,111 @@ public:
     }
 };
 
+/**
+ * A component for emitting particles, continuously or in bursts.
+ * Depends on ParticleService.
+ */
+class ParticleEmitterComponent : public Component
+{
+public:
+    std::string texture_file;
+    ParticleParams params;
+    BodyComponent* body = nullptr;
+    ParticleService* particles = nullptr;
+    int system = -1;
+
+    Vector2 position = {0, 0};
+    float rate = 0.0f; // particles / second
+    bool emitting = true;
+    float emit_accumulator = 0.0f;
+
+    /**
+     * Constructor for ParticleEmitterComponent.
+     *
+     * @param texture_file The texture to draw the particles with.
+     * @param params The settings for emitted particles.
+     * @param rate The number of particles to emit per second. Zero to only emit bursts.
+     * @param body The BodyComponent to follow for position, or nullptr to use the position member.
+     */
+    ParticleEmitterComponent(std::string texture_file,
+                             ParticleParams params,
+                             float rate = 0.0f,
+                             BodyComponent* body = nullptr) :
+        texture_file(texture_file),
+        params(params),
+        body(body),
+        rate(rate)
+    {
+    }
+
+    /**
+     * Initialize the emitter component.
+     */
+    void init() override
+    {
+        particles = owner->scene->get_service<ParticleService>();
+        system = particles->get_system(texture_file);
+    }
+
+    /**
+     * Emit particles at the set rate.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        if (!emitting || rate <= 0.0f)
+        {
+            return;
+        }
+
+        emit_accumulator += rate * delta_time;
+        int count = (int)emit_accumulator;
+        emit_accumulator -= count;
+        particles->emit(system, get_emit_position(), params, count);
+    }
+
+    /**
+     * Emit a number of particles at once.
+     *
+     * @param count The number of particles to emit.
+     */
+    void burst(int count)
+    {
+        particles->emit(system, get_emit_position(), params, count);
+    }
+
+    /**
+     * Get the position particles are emitted from.
+     *
+     * @return The position in pixels.
+     */
+    Vector2 get_emit_position() const
+    {
+        return body ? body->get_position_pixels() : position;
+    }
+
+    /**
+     * Set the position of the emitter.
+     *
+     * @param position The position to set.
+     */
+    void set_position(Vector2 position)
+    {
+        this->position = position;
+    }
+
+    /**
+     * Start or stop continuous emission.
+     *
+     * @param emitting True to emit particles at the set rate.
+     */
+    void set_emitting(bool emitting)
+    {
+        this->emitting = emitting;
+    }
+};
+
 /**
  * A class for handling frame-based animations.
  * Depends on TextureService.
@@ -1091,20 +1690,27 @@ struct PlatformerMovementParams
 
 /**
  * A component for 2D platformer movement.
- * Depends on PhysicsService and BodyComponent.
+ * Depends on PhysicsService, TimerService and BodyComponent.
  */
 class PlatformerMovementComponent : public Component
 {
 public:
     PlatformerMovementParams p;
-    PhysicsService* physics;
+    PhysicsService* physics = nullptr;
+    TimerService* timers = nullptr;
+    std::shared_ptr<bool> timers_alive;
     BodyComponent* body;
+    TileBodyComponent* tile_body = nullptr;
 
     bool grounded = false;
+    bool was_grounded = false;
     bool on_wall_left = false;
     bool on_wall_right = false;
-    float coyote_timer = 0.0f;
-    float jump_buffer_timer = 0.0f;
+
+    // Pending while a jump can still happen after walking off a ledge.
+    TimerHandle coyote_timer;
+    // Pending while a jump pressed just before landing is waiting to happen.
+    TimerHandle jump_buffer_timer;
 
     float move_x = 0;
     bool jump_pressed = false;
@@ -1117,13 +1723,29 @@ public:
      */
     PlatformerMovementComponent(PlatformerMovementParams p) : p(p) {}
 
+    ~PlatformerMovementComponent()
+    {
+        // Free the timer slots, unless the whole scene is going and the service is already gone.
+        if (timers_alive && *timers_alive)
+        {
+            timers->cancel(coyote_timer);
+            timers->cancel(jump_buffer_timer);
+        }
+    }
+
     /**
      * Initialize the movement component.
      */
     void init() override
     {
-        physics = owner->scene->get_service<PhysicsService>();
         body = owner->get_component<BodyComponent>();
+        timers = owner->scene->get_service<TimerService>();
+        timers_alive = timers->alive;
+        tile_body = dynamic_cast<TileBodyComponent*>(body);
+        if (!tile_body)
+        {
+            physics = owner->scene->get_service<PhysicsService>();
+        }
     }
 
     /**
@@ -1133,57 +1755,40 @@ public:
      */
     void update(float delta_time) override
     {
-        if (!b2Body_IsValid(body->id))
+        if (!body->is_valid())
         {
             return;
         }
 
-        coyote_timer = std::max(0.0f, coyote_timer - delta_time);
-        jump_buffer_timer = std::max(0.0f, jump_buffer_timer - delta_time);
-
         if (jump_pressed)
         {
-            jump_buffer_timer = p.jump_buffer;
+            timers->cancel(jump_buffer_timer);
+            jump_buffer_timer = timers->schedule(p.jump_buffer);
         }
 
         // Grounded check
-        grounded = false;
-        on_wall_left = false;
-        on_wall_right = false;
-
-        // Convert probe distances to meters
-        float ray_length = physics->convert_to_meters(4.0f);
-
-        float half_width = physics->convert_to_meters(p.width) / 2.0f;
-        float half_height = physics->convert_to_meters(p.height) / 2.0f;
-
-        // Ground: cast down from two points near the feet (left/right)
-        auto pos = body->get_position_meters();
-        b2Vec2 ground_left_start = {pos.x - half_width, pos.y + half_height};
-        b2Vec2 ground_right_start = {pos.x + half_width, pos.y + half_height};
-        b2Vec2 ground_translation = {0, ray_length};
-        const b2WorldId world = physics->world;
-
-        RayHit left_ground_hit = raycast_closest(world, body->id, ground_left_start, ground_translation);
-        RayHit right_ground_hit = raycast_closest(world, body->id, ground_right_start, ground_translation);
-        grounded = left_ground_hit.hit || right_ground_hit.hit;
-
-        // Walls: cast left/right at mid-body height
-        b2Vec2 mid = {pos.x, pos.y};
-        b2Vec2 wall_left_start = {pos.x - half_width, mid.y};
-        b2Vec2 wall_left_translation = {-ray_length, 0};
-        b2Vec2 wall_right_start = {pos.x + half_width, mid.y};
-        b2Vec2 wall_right_translation = {ray_length, 0};
-
-        RayHit left_wall_hit = raycast_closest(world, body->id, wall_left_start, wall_left_translation);
-        RayHit right_wall_hit = raycast_closest(world, body->id, wall_right_start, wall_right_translation);
+        if (tile_body)
+        {
+            // Tile bodies report their own contacts.
+            grounded = tile_body->is_grounded();
+            on_wall_left = tile_body->is_on_wall_left();
+            on_wall_right = tile_body->is_on_wall_right();
+        }
+        else
+        {
+            probe_contacts();
+        }
 
-        on_wall_left = left_wall_hit.hit;
-        on_wall_right = right_wall_hit.hit;
         if (grounded)
         {
-            coyote_timer = p.coyote_time;
+            timers->cancel(coyote_timer);
         }
+        else if (was_grounded)
+        {
+            // Just left the ground.
+            coyote_timer = timers->schedule(p.coyote_time);
+        }
+        was_grounded = grounded;
 
         float target_vx = move_x * p.max_speed;
 
@@ -1205,13 +1810,14 @@ public:
         v.y = std::max(-p.fall_speed, std::min(p.fall_speed, v.y));
 
         // Jump
-        const bool can_jump = (grounded || coyote_timer > 0.0f);
-        if (jump_buffer_timer > 0.0f && can_jump)
+        const bool can_jump = (grounded || timers->is_pending(coyote_timer));
+        if (timers->is_pending(jump_buffer_timer) && can_jump)
         {
             v.y = -p.jump_speed;
-            jump_buffer_timer = 0.0f;
-            coyote_timer = 0.0f;
+            timers->cancel(jump_buffer_timer);
+            timers->cancel(coyote_timer);
             grounded = false;
+            was_grounded = false;
         }
 
         // Variable jump height: cut upward velocity when jump released
@@ -1224,6 +1830,47 @@ public:
         body->set_velocity(v);
     }
 
+    /**
+     * Probe for ground and walls around a Box2D body with short raycasts.
+     * For internal use only.
+     */
+    void probe_contacts()
+    {
+        grounded = false;
+        on_wall_left = false;
+        on_wall_right = false;
+
+        // Convert probe distances to meters
+        float ray_length = physics->convert_to_meters(4.0f);
+
+        float half_width = physics->convert_to_meters(p.width) / 2.0f;
+        float half_height = physics->convert_to_meters(p.height) / 2.0f;
+
+        // Ground: cast down from two points near the feet (left/right)
+        auto pos = body->get_position_meters();
+        b2Vec2 ground_left_start = {pos.x - half_width, pos.y + half_height};
+        b2Vec2 ground_right_start = {pos.x + half_width, pos.y + half_height};
+        b2Vec2 ground_translation = {0, ray_length};
+        const b2WorldId world = physics->world;
+
+        RayHit left_ground_hit = raycast_closest(world, body->id, ground_left_start, ground_translation);
+        RayHit right_ground_hit = raycast_closest(world, body->id, ground_right_start, ground_translation);
+        grounded = left_ground_hit.hit || right_ground_hit.hit;
+
+        // Walls: cast left/right at mid-body height
+        b2Vec2 mid = {pos.x, pos.y};
+        b2Vec2 wall_left_start = {pos.x - half_width, mid.y};
+        b2Vec2 wall_left_translation = {-ray_length, 0};
+        b2Vec2 wall_right_start = {pos.x + half_width, mid.y};
+        b2Vec2 wall_right_translation = {ray_length, 0};
+
+        RayHit left_wall_hit = raycast_closest(world, body->id, wall_left_start, wall_left_translation);
+        RayHit right_wall_hit = raycast_closest(world, body->id, wall_right_start, wall_right_translation);
+
+        on_wall_left = left_wall_hit.hit;
+        on_wall_right = right_wall_hit.hit;
+    }
+
     /**
      * Calculates a value moved towards a target by a maximum delta.
      *
@@ -1295,7 +1942,7 @@ public:
 
     void update(float delta_time) override
     {
-        if (!b2Body_IsValid(body->id))
+        if (!body->is_valid())
         {
             return;
         }
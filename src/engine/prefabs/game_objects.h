@@ -339,6 +339,20 @@ public:
         camera.rotation = angle;
     }
 
+    /**
+     * Get the part of the world the camera sees. Ignores rotation.
+     *
+     * @return The visible rectangle in world pixels.
+     */
+    Rectangle get_view_rect() const
+    {
+        float inv_zoom = (camera.zoom != 0.0f) ? (1.0f / camera.zoom) : 1.0f;
+        return {camera.target.x - camera.offset.x * inv_zoom,
+                camera.target.y - camera.offset.y * inv_zoom,
+                size.x * inv_zoom,
+                size.y * inv_zoom};
+    }
+
     /**
      * Begin drawing with the camera.
      * The rest of the Scene should be drawn between draw_begin() and draw_end().
@@ -391,13 +405,12 @@ public:
 };
 
 /**
- * A split-screen camera that renders to a texture.
+ * A camera for one view of a split screen.
+ * The scene is drawn once with SplitScreenService, and each SplitCamera picks the part of it to show.
  */
 class SplitCamera : public CameraObject
 {
 public:
-    RenderTexture2D renderer;
-
     /**
      * Constructor for SplitCamera.
      *
@@ -420,62 +433,29 @@ public:
     {
     }
 
-    ~SplitCamera()
-    {
-        UnloadRenderTexture(renderer);
-    }
-
-    /**
-     * Initialize the SplitCamera.
-     */
-    void init() override
-    {
-        renderer = LoadRenderTexture((int)size.x, (int)size.y);
-        CameraObject::init();
-    }
-
     /**
-     * Begin drawing to the camera's texture.
-     * The rest of the Scene should be drawn between draw_begin() and draw_end().
-     */
-    void draw_begin()
-    {
-        BeginTextureMode(renderer);
-        ClearBackground(WHITE);
-        BeginMode2D(camera);
-    }
-
-    /**
-     * End drawing to the camera's texture.
+     * Change the size of the camera view.
+     *
+     * @param new_size The new size of the camera view.
      */
-    void draw_end()
+    void set_size(Vector2 new_size)
     {
-        EndMode2D();
-        EndTextureMode();
+        size = new_size;
+        camera.offset = {size.x / 2.0f, size.y / 2.0f};
     }
 
     /**
-     * Draw the camera's texture at the specified position.
+     * Draw the camera's view of the world stretched to the specified rectangle.
      *
-     * @param x The x position to draw the texture.
-     * @param y The y position to draw the texture.
+     * @param split_screen The service the world was drawn with.
+     * @param x The x position to draw the view.
+     * @param y The y position to draw the view.
+     * @param width The width to draw the view.
+     * @param height The height to draw the view.
      */
-    void draw_texture(float x, float y)
+    void draw_view(SplitScreenService* split_screen, float x, float y, float width, float height)
     {
-        DrawTextureRec(renderer.texture,
-                       {0, 0, static_cast<float>(renderer.texture.width), static_cast<float>(-renderer.texture.height)},
-                       {x, y},
-                       WHITE);
-    }
-
-    void draw_texture_pro(float x, float y, float width, float height)
-    {
-        DrawTexturePro(renderer.texture,
-                       {0, 0, static_cast<float>(renderer.texture.width), static_cast<float>(-renderer.texture.height)},
-                       {x, y, width, height},
-                       {0, 0},
-                       0.0f,
-                       WHITE);
+        split_screen->draw_view(get_view_rect(), {x, y, width, height});
     }
 
     /**
@@ -508,24 +488,27 @@ struct CharacterParams
     float friction = 0.0f;
     float restitution = 0.0f;
     float density = 1.0f;
+
+    // Move against the level's tile grid with TilePhysicsService instead of Box2D.
+    bool use_tile_physics = false;
 };
 
 /**
  * A simple platformer character with movement and animation.
+ * Depends on PhysicsService and TimerService.
  */
 class PlatformerCharacter : public GameObject
 {
 public:
     CharacterParams p;
     PhysicsService* physics;
+    InputManager* input;
     BodyComponent* body;
     PlatformerMovementComponent* movement;
 
     bool grounded = false;
     bool on_wall_left = false;
     bool on_wall_right = false;
-    float coyote_timer = 0.0f;
-    float jump_buffer_timer = 0.0f;
     int gamepad = 0;
 
     /**
@@ -540,6 +523,19 @@ public:
      */
     void init() override
     {
+        input = scene->game->get_manager<InputManager>();
+
+        PlatformerMovementParams mp;
+        mp.width = p.width;
+        mp.height = p.height;
+
+        if (p.use_tile_physics)
+        {
+            body = add_component_as<BodyComponent, TileBodyComponent>(p.position, Vector2{p.width, p.height});
+            movement = add_component<PlatformerMovementComponent>(mp);
+            return;
+        }
+
         physics = scene->get_service<PhysicsService>();
 
         body = add_component<BodyComponent>(
@@ -572,9 +568,6 @@ public:
                 b2CreatePolygonShape(b.id, &box_shape_def, &body_polygon);
             });
 
-        PlatformerMovementParams mp;
-        mp.width = p.width;
-        mp.height = p.height;
         movement = add_component<PlatformerMovementComponent>(mp);
     }
 
@@ -583,26 +576,9 @@ public:
      */
     void update(float delta_time) override
     {
-        float deadzone = 0.1f;
-
-        const bool jump_pressed =
-            IsKeyPressed(KEY_W) || IsGamepadButtonPressed(gamepad, GAMEPAD_BUTTON_RIGHT_FACE_DOWN);
-        const bool jump_held = IsKeyDown(KEY_W) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_RIGHT_FACE_DOWN);
-
-        float move_x = 0.0f;
-        move_x = GetGamepadAxisMovement(gamepad, GAMEPAD_AXIS_LEFT_X);
-        if (fabsf(move_x) < deadzone)
-        {
-            move_x = 0.0f;
-        }
-        if (IsKeyDown(KEY_D) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_LEFT_FACE_RIGHT))
-        {
-            move_x = 1.0f;
-        }
-        else if (IsKeyDown(KEY_A) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_LEFT_FACE_LEFT))
-        {
-            move_x = -1.0f;
-        }
+        const bool jump_pressed = input->is_action_pressed("jump", gamepad);
+        const bool jump_held = input->is_action_down("jump", gamepad);
+        float move_x = input->get_action_value("move_right", gamepad) - input->get_action_value("move_left", gamepad);
 
         movement->set_input(move_x, jump_pressed, jump_held);
     }
@@ -1,6 +1,18 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <rlgl.h>
+
 #include "engine/framework.h"
+#include "engine/glyph_cache.h"
+#include "engine/small_vector.h"
 
 /**
  * For when you want multiple of the same manager.
@@ -9,7 +21,8 @@ template <typename T>
 class MultiManager : public Manager
 {
 public:
-    std::unordered_map<std::string, std::unique_ptr<T>> managers;
+    // Usually only a few, so they are kept inline and searched in order.
+    SmallVector<std::pair<InternedName, std::unique_ptr<T>>, 4> managers;
 
     MultiManager() = default;
 
@@ -31,10 +44,19 @@ public:
      * @param name The name to give the manager.
      * @param manager The manager to add.
      */
-    void add_manager(std::string name, std::unique_ptr<T> manager)
+    void add_manager(std::string_view name, std::unique_ptr<T> manager)
     {
         static_assert(std::is_base_of<Manager, T>::value, "T must derive from Manager");
-        managers[name] = std::move(manager);
+        InternedName interned(name);
+        for (auto& entry : managers)
+        {
+            if (entry.first == interned)
+            {
+                entry.second = std::move(manager);
+                return;
+            }
+        }
+        managers.emplace_back(interned, std::move(manager));
     }
 
     /**
@@ -45,7 +67,7 @@ public:
      * @return A pointer to the added manager.
      */
     template <typename... TArgs>
-    T* add_manager(std::string name, TArgs&&... args)
+    T* add_manager(std::string_view name, TArgs&&... args)
     {
         static_assert(std::is_base_of<Manager, T>::value, "T must derive from Manager");
         auto new_manager = std::make_unique<T>(std::forward<TArgs>(args)...);
@@ -58,14 +80,83 @@ public:
      * Get a manager by name.
      *
      * @param name The name of the manager.
-     * @return A pointer to the manager.
+     * @return A pointer to the manager, or nullptr if not found.
      */
-    T* get_manager(std::string name)
+    T* get_manager(std::string_view name)
     {
-        return managers[name].get();
+        InternedName interned = InternedName::find(name);
+        for (auto& entry : managers)
+        {
+            if (entry.first == interned)
+            {
+                return entry.second.get();
+            }
+        }
+        return nullptr;
     }
 };
 
+/**
+ * Fragment shader for drawing signed distance field fonts.
+ * The alpha channel holds the distance to the glyph edge, so the edge is kept sharp at any size by smoothing over
+ * one screen pixel.
+ */
+#ifdef __EMSCRIPTEN__
+inline const char* sdf_font_shader_code = R"(#version 100
+#extension GL_OES_standard_derivatives : enable
+precision mediump float;
+varying vec2 fragTexCoord;
+varying vec4 fragColor;
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+void main()
+{
+    float distance = texture2D(texture0, fragTexCoord).a - 0.5;
+    float width = length(vec2(dFdx(distance), dFdy(distance)));
+    float alpha = smoothstep(-width, width, distance);
+    gl_FragColor = vec4(fragColor.rgb, fragColor.a * alpha) * colDiffuse;
+}
+)";
+#else
+inline const char* sdf_font_shader_code = R"(#version 330
+in vec2 fragTexCoord;
+in vec4 fragColor;
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+out vec4 finalColor;
+void main()
+{
+    float distance = texture(texture0, fragTexCoord).a - 0.5;
+    float width = length(vec2(dFdx(distance), dFdy(distance)));
+    float alpha = smoothstep(-width, width, distance);
+    finalColor = vec4(fragColor.rgb, fragColor.a * alpha) * colDiffuse;
+}
+)";
+#endif
+
+/**
+ * The header of a cached SDF font's glyph file.
+ */
+struct SdfFontCacheHeader
+{
+    char magic[4];
+    int version;
+    int base_size;
+    int glyph_count;
+};
+
+/**
+ * A glyph in a cached SDF font's glyph file.
+ */
+struct SdfGlyphRecord
+{
+    int value;
+    int offset_x;
+    int offset_y;
+    int advance_x;
+    Rectangle rec;
+};
+
 /**
  * Manager for handling fonts so they are not loaded multiple times.
  */
@@ -74,6 +165,13 @@ class FontManager : public Manager
 public:
     std::unordered_map<std::string, Font> fonts;
 
+    // Fonts with signed distance field atlases, which are drawn with sdf_shader.
+    std::unordered_set<std::string> sdf_fonts;
+    Shader sdf_shader = {0};
+
+    // Fonts whose glyphs are rasterized on demand.
+    std::unordered_map<std::string, std::unique_ptr<GlyphCache>> glyph_caches;
+
     /**
      * Constructor for FontManager.
      * Loads the default font.
@@ -89,6 +187,10 @@ public:
         {
             UnloadFont(pair.second);
         }
+        if (sdf_shader.id != 0)
+        {
+            UnloadShader(sdf_shader);
+        }
     }
 
     /**
@@ -112,6 +214,227 @@ public:
         return fonts[name];
     }
 
+    /**
+     * Load a font as a signed distance field atlas.
+     * One SDF atlas stays sharp at any draw size, so a single atlas serves every size the font is used at. Draw it
+     * with the shader from get_shader(). Generating the atlas is slow, so it is saved to cache_file and loaded from
+     * there next time. Delete the cache files to regenerate them.
+     *
+     * @param name The name to associate with the font.
+     * @param filename The filename of the font to load.
+     * @param size The font size to generate the distance field at.
+     * @param cache_file The path to cache the atlas at, without an extension. Empty to not cache.
+     *
+     * @return A reference to the loaded font.
+     */
+    Font& load_sdf_font(const std::string& name,
+                        const std::string& filename,
+                        int size = 48,
+                        const std::string& cache_file = "")
+    {
+        if (fonts.find(name) != fonts.end())
+        {
+            return fonts[name];
+        }
+
+        // Shaders need the window, so load it on first use rather than in init().
+        if (sdf_shader.id == 0)
+        {
+            sdf_shader = LoadShaderFromMemory(nullptr, sdf_font_shader_code);
+        }
+
+        Font font = {0};
+        if (cache_file.empty() || !load_sdf_cache(cache_file, size, font))
+        {
+            int file_size = 0;
+            unsigned char* file_data = LoadFileData(filename.c_str(), &file_size);
+            if (file_data == nullptr)
+            {
+                TraceLog(LOG_ERROR, "Failed to load font file: %s", filename.c_str());
+                return fonts["default"];
+            }
+
+            // The default 95 ASCII characters.
+            font.baseSize = size;
+            font.glyphCount = 95;
+            font.glyphPadding = 0;
+            font.glyphs = LoadFontData(file_data, file_size, size, nullptr, 0, FONT_SDF);
+            UnloadFileData(file_data);
+
+            Image atlas = GenImageFontAtlas(font.glyphs, &font.recs, font.glyphCount, size, 0, 1);
+            font.texture = LoadTextureFromImage(atlas);
+            if (!cache_file.empty())
+            {
+                save_sdf_cache(cache_file, font, atlas);
+            }
+            UnloadImage(atlas);
+        }
+
+        // Bilinear filtering interpolates the distances, which is what keeps edges smooth when scaled.
+        SetTextureFilter(font.texture, TEXTURE_FILTER_BILINEAR);
+        fonts[name] = font;
+        sdf_fonts.insert(name);
+        return fonts[name];
+    }
+
+    /**
+     * Load a font whose glyphs are rasterized the first time they are drawn, for large character sets like CJK.
+     * Draw it with TextLayout::set_glyph_cache() or a TextComponent using this name.
+     *
+     * @param name The name to associate with the font.
+     * @param filename The filename of the font to load.
+     * @param size The font size to rasterize glyphs at.
+     * @param atlas_size The width and height of the glyph atlas.
+     *
+     * @return A pointer to the glyph cache.
+     */
+    GlyphCache* load_dynamic_font(const std::string& name,
+                                  const std::string& filename,
+                                  int size = 32,
+                                  int atlas_size = 1024)
+    {
+        auto it = glyph_caches.find(name);
+        if (it != glyph_caches.end())
+        {
+            return it->second.get();
+        }
+
+        auto cache = std::make_unique<GlyphCache>(filename, size, atlas_size);
+        GlyphCache* cache_ptr = cache.get();
+        glyph_caches[name] = std::move(cache);
+        return cache_ptr;
+    }
+
+    /**
+     * Get the glyph cache of a font loaded with load_dynamic_font().
+     *
+     * @param name The name of the font.
+     * @return A pointer to the glyph cache, or nullptr if the font isn't a dynamic font.
+     */
+    GlyphCache* get_glyph_cache(const std::string& name)
+    {
+        auto it = glyph_caches.find(name);
+        return it != glyph_caches.end() ? it->second.get() : nullptr;
+    }
+
+    /**
+     * Upload glyphs rasterized since the last frame.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        for (auto& pair : glyph_caches)
+        {
+            pair.second->update();
+        }
+    }
+
+    /**
+     * Get the shader a font should be drawn with.
+     *
+     * @param name The name of the font.
+     * @return The SDF shader for SDF fonts, or a shader with id 0 for regular fonts.
+     */
+    Shader get_shader(const std::string& name)
+    {
+        if (sdf_fonts.find(name) != sdf_fonts.end())
+        {
+            return sdf_shader;
+        }
+        return Shader{0};
+    }
+
+    /**
+     * Save an SDF font's atlas and glyph metrics.
+     * For internal use only.
+     *
+     * @param cache_file The path to save to, without an extension.
+     * @param font The font to save.
+     * @param atlas The font's atlas image.
+     */
+    void save_sdf_cache(const std::string& cache_file, const Font& font, Image atlas)
+    {
+        std::vector<unsigned char> data(sizeof(SdfFontCacheHeader) + font.glyphCount * sizeof(SdfGlyphRecord));
+        SdfFontCacheHeader header = {{'S', 'D', 'F', 'C'}, 1, font.baseSize, font.glyphCount};
+        std::memcpy(data.data(), &header, sizeof(header));
+        for (int i = 0; i < font.glyphCount; i++)
+        {
+            const GlyphInfo& glyph = font.glyphs[i];
+            SdfGlyphRecord record = {glyph.value, glyph.offsetX, glyph.offsetY, glyph.advanceX, font.recs[i]};
+            std::memcpy(data.data() + sizeof(header) + i * sizeof(record), &record, sizeof(record));
+        }
+
+        std::string glyph_file = cache_file + ".glyphs";
+        std::string atlas_file = cache_file + ".png";
+        if (!SaveFileData(glyph_file.c_str(), data.data(), (int)data.size()) || !ExportImage(atlas, atlas_file.c_str()))
+        {
+            TraceLog(LOG_WARNING, "Failed to cache SDF font: %s", cache_file.c_str());
+        }
+    }
+
+    /**
+     * Load an SDF font saved by save_sdf_cache().
+     * For internal use only.
+     *
+     * @param cache_file The path to load from, without an extension.
+     * @param size The font size the distance field should have been generated at.
+     * @param font The font to fill in.
+     * @return True if the cache was loaded, false if it is missing or doesn't match.
+     */
+    bool load_sdf_cache(const std::string& cache_file, int size, Font& font)
+    {
+        std::string glyph_file = cache_file + ".glyphs";
+        std::string atlas_file = cache_file + ".png";
+        if (!FileExists(glyph_file.c_str()) || !FileExists(atlas_file.c_str()))
+        {
+            return false;
+        }
+
+        int data_size = 0;
+        unsigned char* data = LoadFileData(glyph_file.c_str(), &data_size);
+        SdfFontCacheHeader header;
+        if (data == nullptr || data_size < (int)sizeof(header))
+        {
+            UnloadFileData(data);
+            return false;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        int expected_size = (int)(sizeof(header) + header.glyph_count * sizeof(SdfGlyphRecord));
+        if (std::memcmp(header.magic, "SDFC", 4) != 0 || header.version != 1 || header.base_size != size ||
+            header.glyph_count <= 0 || data_size != expected_size)
+        {
+            UnloadFileData(data);
+            return false;
+        }
+
+        Image atlas = LoadImage(atlas_file.c_str());
+        if (atlas.data == nullptr)
+        {
+            UnloadFileData(data);
+            return false;
+        }
+
+        // UnloadFont frees these with raylib's allocator, so allocate them with it too.
+        font.baseSize = header.base_size;
+        font.glyphCount = header.glyph_count;
+        font.glyphPadding = 0;
+        font.glyphs = (GlyphInfo*)MemAlloc(header.glyph_count * sizeof(GlyphInfo));
+        font.recs = (Rectangle*)MemAlloc(header.glyph_count * sizeof(Rectangle));
+        for (int i = 0; i < header.glyph_count; i++)
+        {
+            SdfGlyphRecord record;
+            std::memcpy(&record, data + sizeof(header) + i * sizeof(record), sizeof(record));
+            font.glyphs[i] = GlyphInfo{record.value, record.offset_x, record.offset_y, record.advance_x, Image{0}};
+            font.recs[i] = record.rec;
+        }
+        UnloadFileData(data);
+
+        font.texture = LoadTextureFromImage(atlas);
+        UnloadImage(atlas);
+        return true;
+    }
+
     /**
      * Get a font by name.
      *
@@ -138,80 +461,1159 @@ public:
     }
 };
 
+// Sizes of the input snapshot. raylib tracks up to 512 keys and 4 gamepads.
+constexpr int input_key_count = 512;
+constexpr int input_gamepad_count = 4;
+constexpr int input_button_count = GAMEPAD_BUTTON_RIGHT_THUMB + 1;
+constexpr int input_axis_count = GAMEPAD_AXIS_RIGHT_TRIGGER + 1;
+
 /**
- * Manager for handling the application window.
+ * The state of every input device for one frame.
+ * Plain data, so snapshots can be copied to worker threads, recorded and written to files as is.
  */
-class WindowManager : public Manager
+struct InputSnapshot
+{
+    uint64_t keys[input_key_count / 64] = {0};
+    uint32_t buttons[input_gamepad_count] = {0};
+    float axes[input_gamepad_count][input_axis_count] = {{0}};
+    uint32_t gamepads = 0;
+    uint32_t mouse_buttons = 0;
+    Vector2 mouse_position = {0, 0};
+    float mouse_wheel = 0.0f;
+
+    /**
+     * Check if a key is down.
+     *
+     * @param key The raylib key code.
+     * @return True if the key is down.
+     */
+    bool key(int key) const
+    {
+        return key >= 0 && key < input_key_count && (keys[key / 64] >> (key % 64)) & 1;
+    }
+
+    /**
+     * Check if a gamepad button is down.
+     *
+     * @param gamepad The gamepad index.
+     * @param button The raylib gamepad button.
+     * @return True if the button is down.
+     */
+    bool button(int gamepad, int button) const
+    {
+        return gamepad >= 0 && gamepad < input_gamepad_count && button >= 0 && button < input_button_count &&
+               (buttons[gamepad] >> button) & 1;
+    }
+
+    /**
+     * Get a gamepad axis.
+     *
+     * @param gamepad The gamepad index.
+     * @param axis The raylib gamepad axis.
+     * @return The axis value, or 0 if the gamepad or axis doesn't exist.
+     */
+    float axis(int gamepad, int axis) const
+    {
+        if (gamepad < 0 || gamepad >= input_gamepad_count || axis < 0 || axis >= input_axis_count)
+        {
+            return 0.0f;
+        }
+        return axes[gamepad][axis];
+    }
+};
+
+/**
+ * Where an action binding reads from.
+ */
+enum class InputSource
+{
+    Key,
+    Button,
+    Axis
+};
+
+/**
+ * One input bound to an action.
+ */
+struct InputBinding
+{
+    InputSource source = InputSource::Key;
+    int code = 0;
+    // For axes, 1 reads the positive half and -1 the negative half.
+    float direction = 1.0f;
+};
+
+/**
+ * Manager for reading input.
+ * raylib is polled once at the start of each frame into a snapshot, and everything reads the snapshot instead of
+ * raylib, so reads don't depend on update order and are safe from worker threads.
+ * Actions map names like "jump" to keys, buttons and axes. Keys count for every player, buttons and axes only for
+ * the player's gamepad.
+ * Snapshots can be recorded and played back for replays, or injected for tests and headless runs.
+ */
+class InputManager : public Manager
 {
 public:
-    int width = 1280;
-    int height = 720;
-    std::string title = "My Game";
-    int target_fps = 60;
+    InputSnapshot current;
+    InputSnapshot previous;
 
-    WindowManager(int w, int h, const std::string& t, int fps = 60) : width(w), height(h), title(t), target_fps(fps) {}
+    std::unordered_map<std::string, std::vector<InputBinding>> actions;
+
+    // Axis values smaller than this are read as 0.
+    float axis_deadzone = 0.1f;
+    // How far an axis must move for its action to count as down.
+    float axis_press_threshold = 0.5f;
+
+    // False to stop reading raylib, for headless runs that only use injected snapshots.
+    bool poll_devices = true;
+
+    std::deque<InputSnapshot> injected;
+    std::vector<InputSnapshot> recording;
+    bool is_recording = false;
+    std::vector<InputSnapshot> playback;
+    int playback_frame = -1;
 
     /**
-     * Initialize the window.
+     * Constructor for InputManager.
+     * Binds the actions the prefabs and samples use.
      */
-    void init() override
+    InputManager()
     {
-        SetConfigFlags(FLAG_WINDOW_RESIZABLE);
-        InitWindow(width, height, title.c_str());
-        InitAudioDevice();
-        SetTargetFPS(target_fps);
+        bind_key("move_left", KEY_A);
+        bind_button("move_left", GAMEPAD_BUTTON_LEFT_FACE_LEFT);
+        bind_axis("move_left", GAMEPAD_AXIS_LEFT_X, -1.0f);
+        bind_key("move_right", KEY_D);
+        bind_button("move_right", GAMEPAD_BUTTON_LEFT_FACE_RIGHT);
+        bind_axis("move_right", GAMEPAD_AXIS_LEFT_X, 1.0f);
+        bind_key("move_up", KEY_W);
+        bind_button("move_up", GAMEPAD_BUTTON_LEFT_FACE_UP);
+        bind_axis("move_up", GAMEPAD_AXIS_LEFT_Y, -1.0f);
+        bind_key("move_down", KEY_S);
+        bind_button("move_down", GAMEPAD_BUTTON_LEFT_FACE_DOWN);
+        bind_axis("move_down", GAMEPAD_AXIS_LEFT_Y, 1.0f);
+        bind_key("jump", KEY_W);
+        bind_button("jump", GAMEPAD_BUTTON_RIGHT_FACE_DOWN);
+        bind_key("attack", KEY_SPACE);
+        bind_button("attack", GAMEPAD_BUTTON_RIGHT_FACE_RIGHT);
+        bind_key("start", KEY_ENTER);
+        bind_button("start", GAMEPAD_BUTTON_MIDDLE_RIGHT);
+    }
 
-        char* mappings = LoadFileText("assets/gamecontrollerdb.txt");
-        SetGamepadMappings(mappings);
-        Manager::init();
+    /**
+     * Take this frame's snapshot.
+     * Comes from playback or an injected snapshot if there is one, otherwise from raylib.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        previous = current;
+        if (playback_frame >= 0)
+        {
+            current = playback[playback_frame++];
+            if (playback_frame >= (int)playback.size())
+            {
+                playback_frame = -1;
+            }
+        }
+        else if (!injected.empty())
+        {
+            current = injected.front();
+            injected.pop_front();
+        }
+        else if (poll_devices)
+        {
+            poll();
+        }
+
+        if (is_recording)
+        {
+            recording.push_back(current);
+        }
     }
 
     /**
-     * Set the window title.
+     * Read every device from raylib into the current snapshot.
+     * For internal use only.
+     */
+    void poll()
+    {
+        current = InputSnapshot();
+        for (int key = 1; key < input_key_count; key++)
+        {
+            if (IsKeyDown(key))
+            {
+                current.keys[key / 64] |= 1ull << (key % 64);
+            }
+        }
+
+        for (int gamepad = 0; gamepad < input_gamepad_count; gamepad++)
+        {
+            if (!IsGamepadAvailable(gamepad))
+            {
+                continue;
+            }
+            current.gamepads |= 1u << gamepad;
+            for (int button = 1; button < input_button_count; button++)
+            {
+                if (IsGamepadButtonDown(gamepad, button))
+                {
+                    current.buttons[gamepad] |= 1u << button;
+                }
+            }
+            for (int axis = 0; axis < input_axis_count; axis++)
+            {
+                current.axes[gamepad][axis] = GetGamepadAxisMovement(gamepad, axis);
+            }
+        }
+
+        for (int button = 0; button <= MOUSE_BUTTON_BACK; button++)
+        {
+            if (IsMouseButtonDown(button))
+            {
+                current.mouse_buttons |= 1u << button;
+            }
+        }
+        current.mouse_position = GetMousePosition();
+        current.mouse_wheel = GetMouseWheelMove();
+    }
+
+    /**
+     * Bind a key to an action.
      *
-     * @param t The new title.
+     * @param action The name of the action.
+     * @param key The raylib key code.
      */
-    void set_title(const std::string& t)
+    void bind_key(const std::string& action, int key)
     {
-        title = t;
-        SetWindowTitle(title.c_str());
+        actions[action].push_back({InputSource::Key, key, 1.0f});
     }
 
     /**
-     * Get the window width.
+     * Bind a gamepad button to an action.
      *
-     * @return The window width.
+     * @param action The name of the action.
+     * @param button The raylib gamepad button.
      */
-    float get_width() const
+    void bind_button(const std::string& action, int button)
     {
-        return static_cast<float>(width);
+        actions[action].push_back({InputSource::Button, button, 1.0f});
     }
 
     /**
-     * Get the window height.
+     * Bind half of a gamepad axis to an action.
+     *
+     * @param action The name of the action.
+     * @param axis The raylib gamepad axis.
+     * @param direction 1 for the positive half of the axis, -1 for the negative half.
      */
-    float get_height() const
+    void bind_axis(const std::string& action, int axis, float direction)
     {
-        return static_cast<float>(height);
+        actions[action].push_back({InputSource::Axis, axis, direction});
     }
 
     /**
-     * Get the window size.
+     * Remove every binding of an action.
      *
-     * @return The window size as a Vector2.
+     * @param action The name of the action.
      */
-    Vector2 get_size() const
+    void unbind(const std::string& action)
     {
-        return Vector2{(float)width, (float)height};
+        actions.erase(action);
     }
 
     /**
-     * Get the window aspect ratio.
+     * Get how far an action is pushed in a snapshot.
+     * For internal use only.
      *
-     * @return The window aspect ratio.
+     * @param snapshot The snapshot to read.
+     * @param action The name of the action.
+     * @param gamepad The gamepad of the player.
+     * @return The strongest of the action's bindings, between 0 and 1.
      */
-    float get_aspect_ratio() const
+    float read_action(const InputSnapshot& snapshot, const std::string& action, int gamepad) const
     {
-        return static_cast<float>(width) / static_cast<float>(height);
+        auto it = actions.find(action);
+        if (it == actions.end())
+        {
+            return 0.0f;
+        }
+
+        float value = 0.0f;
+        for (const auto& binding : it->second)
+        {
+            switch (binding.source)
+            {
+            case InputSource::Key:
+                value = snapshot.key(binding.code) ? 1.0f : value;
+                break;
+            case InputSource::Button:
+                value = snapshot.button(gamepad, binding.code) ? 1.0f : value;
+                break;
+            case InputSource::Axis:
+            {
+                float axis = snapshot.axis(gamepad, binding.code) * binding.direction;
+                if (axis >= axis_deadzone)
+                {
+                    value = std::max(value, std::min(axis, 1.0f));
+                }
+                break;
+            }
+            }
+        }
+        return value;
+    }
+
+    /**
+     * Get how far an action is pushed this frame.
+     *
+     * @param action The name of the action.
+     * @param gamepad The gamepad of the player.
+     * @return 1 for keys and buttons that are down, the axis value for axes, 0 if released.
+     */
+    float get_action_value(const std::string& action, int gamepad = 0) const
+    {
+        return read_action(current, action, gamepad);
+    }
+
+    /**
+     * Check if an action is down this frame.
+     *
+     * @param action The name of the action.
+     * @param gamepad The gamepad of the player.
+     * @return True if the action is down.
+     */
+    bool is_action_down(const std::string& action, int gamepad = 0) const
+    {
+        return read_action(current, action, gamepad) >= axis_press_threshold;
+    }
+
+    /**
+     * Check if an action went down this frame.
+     *
+     * @param action The name of the action.
+     * @param gamepad The gamepad of the player.
+     * @return True if the action is down this frame and was up last frame.
+     */
+    bool is_action_pressed(const std::string& action, int gamepad = 0) const
+    {
+        return is_action_down(action, gamepad) && read_action(previous, action, gamepad) < axis_press_threshold;
+    }
+
+    /**
+     * Check if an action went up this frame.
+     *
+     * @param action The name of the action.
+     * @param gamepad The gamepad of the player.
+     * @return True if the action is up this frame and was down last frame.
+     */
+    bool is_action_released(const std::string& action, int gamepad = 0) const
+    {
+        return !is_action_down(action, gamepad) && read_action(previous, action, gamepad) >= axis_press_threshold;
+    }
+
+    /**
+     * Check if a key is down this frame.
+     *
+     * @param key The raylib key code.
+     * @return True if the key is down.
+     */
+    bool is_key_down(int key) const
+    {
+        return current.key(key);
     }
-};
\ No newline at end of file
+
+    /**
+     * Check if a key went down this frame.
+     *
+     * @param key The raylib key code.
+     * @return True if the key is down this frame and was up last frame.
+     */
+    bool is_key_pressed(int key) const
+    {
+        return current.key(key) && !previous.key(key);
+    }
+
+    /**
+     * Check if a gamepad button is down this frame.
+     *
+     * @param gamepad The gamepad index.
+     * @param button The raylib gamepad button.
+     * @return True if the button is down.
+     */
+    bool is_button_down(int gamepad, int button) const
+    {
+        return current.button(gamepad, button);
+    }
+
+    /**
+     * Check if a gamepad button went down this frame.
+     *
+     * @param gamepad The gamepad index.
+     * @param button The raylib gamepad button.
+     * @return True if the button is down this frame and was up last frame.
+     */
+    bool is_button_pressed(int gamepad, int button) const
+    {
+        return current.button(gamepad, button) && !previous.button(gamepad, button);
+    }
+
+    /**
+     * Get a gamepad axis this frame.
+     *
+     * @param gamepad The gamepad index.
+     * @param axis The raylib gamepad axis.
+     * @return The axis value.
+     */
+    float get_axis(int gamepad, int axis) const
+    {
+        return current.axis(gamepad, axis);
+    }
+
+    /**
+     * Check if a gamepad is connected this frame.
+     *
+     * @param gamepad The gamepad index.
+     * @return True if the gamepad is connected.
+     */
+    bool is_gamepad_available(int gamepad) const
+    {
+        return gamepad >= 0 && gamepad < input_gamepad_count && (current.gamepads >> gamepad) & 1;
+    }
+
+    /**
+     * Queue a snapshot to use instead of the devices. Each injected snapshot lasts one frame.
+     *
+     * @param snapshot The snapshot to use.
+     */
+    void inject(const InputSnapshot& snapshot)
+    {
+        injected.push_back(snapshot);
+    }
+
+    /**
+     * Start recording a snapshot every frame. Clears any previous recording.
+     */
+    void start_recording()
+    {
+        recording.clear();
+        is_recording = true;
+    }
+
+    /**
+     * Stop recording.
+     */
+    void stop_recording()
+    {
+        is_recording = false;
+    }
+
+    /**
+     * Play back recorded snapshots, one per frame, instead of reading the devices.
+     *
+     * @param snapshots The snapshots to play back.
+     */
+    void start_playback(const std::vector<InputSnapshot>& snapshots)
+    {
+        playback = snapshots;
+        playback_frame = playback.empty() ? -1 : 0;
+    }
+
+    /**
+     * Stop playing back and go back to reading the devices.
+     */
+    void stop_playback()
+    {
+        playback_frame = -1;
+    }
+
+    /**
+     * Check if a recording is being played back.
+     *
+     * @return True while playing back.
+     */
+    bool is_playing_back() const
+    {
+        return playback_frame >= 0;
+    }
+
+    /**
+     * Write the recording to a file.
+     *
+     * @param filename The file to write.
+     * @return True if the file was written.
+     */
+    bool save_recording(const std::string& filename) const
+    {
+        int size = (int)(recording.size() * sizeof(InputSnapshot));
+        return SaveFileData(filename.c_str(), (void*)recording.data(), size);
+    }
+
+    /**
+     * Read a recording from a file.
+     *
+     * @param filename The file to read.
+     * @return The snapshots in the file, empty if it couldn't be read.
+     */
+    std::vector<InputSnapshot> load_recording(const std::string& filename) const
+    {
+        std::vector<InputSnapshot> snapshots;
+        int size = 0;
+        unsigned char* data = LoadFileData(filename.c_str(), &size);
+        if (data == nullptr)
+        {
+            TraceLog(LOG_ERROR, "Failed to load input recording: %s", filename.c_str());
+            return snapshots;
+        }
+        snapshots.resize(size / sizeof(InputSnapshot));
+        std::memcpy(snapshots.data(), data, snapshots.size() * sizeof(InputSnapshot));
+        UnloadFileData(data);
+        return snapshots;
+    }
+};
+
+/**
+ * A music track played by the MusicManager.
+ */
+struct MusicTrack
+{
+    std::string filename;
+    Music music;
+    float fade = 0.0f;
+    float fade_speed = 0.0f;
+    bool stopping = false;
+
+    // Set by the decoding thread while it is streaming the track, which keeps it from being unloaded.
+    std::atomic<bool> busy = false;
+};
+
+/**
+ * Manager for streamed background music.
+ * Tracks are decoded a little at a time into the stream's buffers on a worker thread, so the main thread never
+ * decodes audio and only the stream buffers are kept in memory rather than the whole track. The worker only holds
+ * the lock to pick which tracks to decode, not while decoding, so the main thread doesn't wait on it.
+ * Playing a new track crossfades from the old one, and managers live across scenes, so scenes can call play() in
+ * on_enter().
+ * Web builds have no worker thread and decode in update() instead.
+ */
+class MusicManager : public Manager
+{
+public:
+    std::vector<std::unique_ptr<MusicTrack>> tracks;
+    float volume = 1.0f;
+
+    // Frames in each half of a track's stream buffer. Larger buffers decode further ahead.
+    int buffer_frames = 16384;
+    int decode_interval_ms = 10;
+
+    std::mutex mutex;
+    std::atomic<bool> running = false;
+    std::thread worker;
+
+    // The tracks the worker is decoding this pass. Only used by the worker.
+    std::vector<MusicTrack*> decoding;
+
+    /**
+     * Constructor for MusicManager.
+     *
+     * @param volume The music volume.
+     * @param buffer_frames The number of frames in each half of a track's stream buffer.
+     */
+    MusicManager(float volume = 1.0f, int buffer_frames = 16384) : volume(volume), buffer_frames(buffer_frames) {}
+
+    ~MusicManager()
+    {
+        running = false;
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+        for (auto& track : tracks)
+        {
+            StopMusicStream(track->music);
+            UnloadMusicStream(track->music);
+        }
+    }
+
+    /**
+     * Start the decoding thread.
+     */
+    void init() override
+    {
+#ifndef __EMSCRIPTEN__
+        running = true;
+        worker = std::thread(
+            [this]()
+            {
+                while (running)
+                {
+                    {
+                        // Mark the tracks busy under the lock so update() won't unload them while they decode.
+                        std::lock_guard<std::mutex> lock(mutex);
+                        decoding.clear();
+                        for (auto& track : tracks)
+                        {
+                            if (!track->stopping || track->fade > 0.0f)
+                            {
+                                track->busy = true;
+                                decoding.push_back(track.get());
+                            }
+                        }
+                    }
+                    for (auto track : decoding)
+                    {
+                        UpdateMusicStream(track->music);
+                        track->busy = false;
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(decode_interval_ms));
+                }
+            });
+#endif
+        Manager::init();
+    }
+
+    /**
+     * Play a track, fading out whatever is playing.
+     * Does nothing if the track is already playing.
+     *
+     * @param filename The filename of the track.
+     * @param fade_time The time in seconds to crossfade over. Zero to switch immediately.
+     * @param loop True to loop the track.
+     */
+    void play(const std::string& filename, float fade_time = 1.0f, bool loop = true)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!tracks.empty() && !tracks.back()->stopping && tracks.back()->filename == filename)
+        {
+            return;
+        }
+        fade_out_all(fade_time);
+
+        // Stream buffers take their size from the default when they are created.
+        SetAudioStreamBufferSizeDefault(buffer_frames);
+        Music music = LoadMusicStream(filename.c_str());
+        SetAudioStreamBufferSizeDefault(0);
+        if (!IsMusicValid(music))
+        {
+            TraceLog(LOG_WARNING, "Failed to load music: %s", filename.c_str());
+            return;
+        }
+
+        auto track = std::make_unique<MusicTrack>();
+        track->filename = filename;
+        track->music = music;
+        track->music.looping = loop;
+        track->fade = fade_time > 0.0f ? 0.0f : 1.0f;
+        track->fade_speed = fade_time > 0.0f ? 1.0f / fade_time : 0.0f;
+        SetMusicVolume(track->music, track->fade * volume);
+        PlayMusicStream(track->music);
+        tracks.push_back(std::move(track));
+    }
+
+    /**
+     * Fade out and stop the music.
+     *
+     * @param fade_time The time in seconds to fade over. Zero to stop immediately.
+     */
+    void stop(float fade_time = 1.0f)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fade_out_all(fade_time);
+    }
+
+    /**
+     * Set the music volume.
+     *
+     * @param new_volume The volume, between 0.0 and 1.0.
+     */
+    void set_volume(float new_volume)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        volume = new_volume;
+        for (auto& track : tracks)
+        {
+            SetMusicVolume(track->music, track->fade * volume);
+        }
+    }
+
+    /**
+     * Advance fades and unload tracks that have finished.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = (int)tracks.size() - 1; i >= 0; i--)
+        {
+            auto& track = *tracks[i];
+#ifdef __EMSCRIPTEN__
+            UpdateMusicStream(track.music);
+#endif
+            if (track.stopping)
+            {
+                track.fade = track.fade_speed > 0.0f ? track.fade - track.fade_speed * delta_time : 0.0f;
+            }
+            else if (track.fade < 1.0f)
+            {
+                track.fade = std::min(1.0f, track.fade + track.fade_speed * delta_time);
+            }
+
+            if ((track.stopping && track.fade <= 0.0f) || !IsMusicStreamPlaying(track.music))
+            {
+                // Still being decoded, try again next frame.
+                if (track.busy)
+                {
+                    continue;
+                }
+                StopMusicStream(track.music);
+                UnloadMusicStream(track.music);
+                tracks.erase(tracks.begin() + i);
+                continue;
+            }
+            SetMusicVolume(track.music, track.fade * volume);
+        }
+    }
+
+    /**
+     * Start fading out every track. The mutex must be held.
+     * For internal use only.
+     *
+     * @param fade_time The time in seconds to fade over.
+     */
+    void fade_out_all(float fade_time)
+    {
+        for (auto& track : tracks)
+        {
+            if (!track->stopping)
+            {
+                track->stopping = true;
+                // Fade from the current volume so an interrupted fade in doesn't jump.
+                track->fade_speed = fade_time > 0.0f ? 1.0f / fade_time : 0.0f;
+            }
+        }
+    }
+};
+
+/**
+ * Manager for handling the application window.
+ */
+class WindowManager : public Manager
+{
+public:
+    int width = 1280;
+    int height = 720;
+    std::string title = "My Game";
+    int target_fps = 60;
+
+    WindowManager(int w, int h, const std::string& t, int fps = 60) : width(w), height(h), title(t), target_fps(fps) {}
+
+    /**
+     * Initialize the window.
+     */
+    void init() override
+    {
+        SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+        InitWindow(width, height, title.c_str());
+        InitAudioDevice();
+        SetTargetFPS(target_fps);
+
+        char* mappings = LoadFileText("assets/gamecontrollerdb.txt");
+        SetGamepadMappings(mappings);
+        Manager::init();
+    }
+
+    /**
+     * Set the window title.
+     *
+     * @param t The new title.
+     */
+    void set_title(const std::string& t)
+    {
+        title = t;
+        SetWindowTitle(title.c_str());
+    }
+
+    /**
+     * Get the window width.
+     *
+     * @return The window width.
+     */
+    float get_width() const
+    {
+        return static_cast<float>(width);
+    }
+
+    /**
+     * Get the window height.
+     */
+    float get_height() const
+    {
+        return static_cast<float>(height);
+    }
+
+    /**
+     * Get the window size.
+     *
+     * @return The window size as a Vector2.
+     */
+    Vector2 get_size() const
+    {
+        return Vector2{(float)width, (float)height};
+    }
+
+    /**
+     * Get the window aspect ratio.
+     *
+     * @return The window aspect ratio.
+     */
+    float get_aspect_ratio() const
+    {
+        return static_cast<float>(width) / static_cast<float>(height);
+    }
+};
+/**
+ * An offscreen render target handed out by the RenderTargetManager.
+ * Callers always draw in the base size; the texture behind it may be smaller.
+ */
+struct RenderTarget
+{
+    int width = 0;
+    int height = 0;
+    bool pixel_perfect = false;
+    bool fixed_resolution = false;
+    bool in_use = false;
+    float scale = 1.0f;
+    RenderTexture2D texture = {0};
+};
+
+/**
+ * Manager for offscreen render targets.
+ * Render textures are pooled by size and reused across scenes, so a scene can hand its textures back when it is
+ * left. Targets that are not pixel perfect are rendered at a lower internal resolution when the frame time goes over
+ * budget, and scaled back up once there is room again.
+ */
+class RenderTargetManager : public Manager
+{
+public:
+    std::vector<RenderTarget> targets;
+    std::vector<RenderTexture2D> free_textures;
+    int max_free_textures = 8;
+
+    bool dynamic_resolution = true;
+    float frame_budget = 1.0f / 60.0f;
+    float resolution_scale = 1.0f;
+    float min_scale = 0.5f;
+    float max_scale = 1.0f;
+    float scale_step = 0.125f;
+
+    // Frame time smoothing and how long to wait between changes so the scale doesn't flicker.
+    float average_frame_time = 1.0f / 60.0f;
+    float smoothing = 0.1f;
+    float change_delay = 0.5f;
+    float recover_delay = 3.0f;
+    float change_timer = 0.0f;
+    float under_budget_time = 0.0f;
+
+    /**
+     * Constructor for RenderTargetManager.
+     *
+     * @param target_fps The frame rate to budget for.
+     */
+    RenderTargetManager(float target_fps = 60.0f) :
+        frame_budget(1.0f / target_fps),
+        average_frame_time(1.0f / target_fps)
+    {
+    }
+
+    ~RenderTargetManager()
+    {
+        for (auto& target : targets)
+        {
+            if (target.texture.id != 0)
+            {
+                UnloadRenderTexture(target.texture);
+            }
+        }
+        for (auto& texture : free_textures)
+        {
+            UnloadRenderTexture(texture);
+        }
+    }
+
+    /**
+     * Adjust the resolution scale from the frame time.
+     * A frame limiter hides how much headroom there is, so the scale only drops when frames run over budget and is
+     * raised again after frames have been on budget for a while.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        // Ignore hitches like scene loads, they say nothing about the rendering cost.
+        if (!dynamic_resolution || delta_time > 0.25f)
+        {
+            return;
+        }
+
+        average_frame_time += (delta_time - average_frame_time) * smoothing;
+        change_timer -= delta_time;
+        if (change_timer > 0.0f)
+        {
+            return;
+        }
+
+        if (average_frame_time > frame_budget * 1.15f)
+        {
+            under_budget_time = 0.0f;
+            if (resolution_scale > min_scale)
+            {
+                resolution_scale = std::max(min_scale, resolution_scale - scale_step);
+                change_timer = change_delay;
+            }
+        }
+        else if (average_frame_time < frame_budget * 1.02f)
+        {
+            under_budget_time += delta_time;
+            if (under_budget_time >= recover_delay && resolution_scale < max_scale)
+            {
+                resolution_scale = std::min(max_scale, resolution_scale + scale_step);
+                change_timer = change_delay;
+                under_budget_time = 0.0f;
+            }
+        }
+        else
+        {
+            under_budget_time = 0.0f;
+        }
+    }
+
+    /**
+     * Create a render target.
+     * The texture is not allocated until the target is first drawn to.
+     *
+     * @param width The width callers will draw in, in pixels.
+     * @param height The height callers will draw in, in pixels.
+     * @param pixel_perfect True to always render at full resolution and only scale by whole numbers when drawn.
+     * @param fixed_resolution True to always render at full resolution but scale freely when drawn.
+     * @return The id of the render target.
+     */
+    int create_target(int width, int height, bool pixel_perfect = false, bool fixed_resolution = false)
+    {
+        RenderTarget target;
+        target.width = std::max(1, width);
+        target.height = std::max(1, height);
+        target.pixel_perfect = pixel_perfect;
+        target.fixed_resolution = fixed_resolution;
+        target.in_use = true;
+
+        for (int i = 0; i < (int)targets.size(); i++)
+        {
+            if (!targets[i].in_use)
+            {
+                targets[i] = target;
+                return i;
+            }
+        }
+        targets.push_back(target);
+        return (int)targets.size() - 1;
+    }
+
+    /**
+     * Destroy a render target and return its texture to the pool.
+     *
+     * @param id The id of the render target.
+     */
+    void destroy_target(int id)
+    {
+        if (id < 0 || id >= (int)targets.size())
+        {
+            return;
+        }
+        release_texture(id);
+        targets[id].in_use = false;
+    }
+
+    /**
+     * Change the size callers draw a render target in.
+     *
+     * @param id The id of the render target.
+     * @param width The new width in pixels.
+     * @param height The new height in pixels.
+     */
+    void resize_target(int id, int width, int height)
+    {
+        auto& target = targets[id];
+        target.width = std::max(1, width);
+        target.height = std::max(1, height);
+    }
+
+    /**
+     * Return a render target's texture to the pool without destroying the target.
+     * Scenes should call this when they are left so the next scene can reuse the texture. It is reallocated the
+     * next time the target is drawn to.
+     *
+     * @param id The id of the render target.
+     */
+    void release_texture(int id)
+    {
+        auto& target = targets[id];
+        if (target.texture.id == 0)
+        {
+            return;
+        }
+
+        free_textures.push_back(target.texture);
+        if ((int)free_textures.size() > max_free_textures)
+        {
+            UnloadRenderTexture(free_textures.front());
+            free_textures.erase(free_textures.begin());
+        }
+        target.texture = {0};
+    }
+
+    /**
+     * Get the texture of a render target, allocating it at the current resolution scale if needed.
+     *
+     * @param id The id of the render target.
+     * @return The render texture.
+     */
+    RenderTexture2D& get_texture(int id)
+    {
+        auto& target = targets[id];
+        float scale = (target.pixel_perfect || target.fixed_resolution) ? 1.0f : resolution_scale;
+        int width = std::max(1, (int)(target.width * scale));
+        int height = std::max(1, (int)(target.height * scale));
+        if (target.texture.id != 0 && target.texture.texture.width == width && target.texture.texture.height == height)
+        {
+            return target.texture;
+        }
+
+        release_texture(id);
+        target.texture = acquire_texture(width, height);
+        target.scale = scale;
+        // Smooth the upscale unless the target is full resolution and meant to keep its pixels.
+        bool smooth = width < target.width || target.fixed_resolution;
+        SetTextureFilter(target.texture.texture, smooth ? TEXTURE_FILTER_BILINEAR : TEXTURE_FILTER_POINT);
+        return target.texture;
+    }
+
+    /**
+     * Get the size callers draw a render target in.
+     *
+     * @param id The id of the render target.
+     * @return The size in pixels.
+     */
+    Vector2 get_size(int id) const
+    {
+        return {(float)targets[id].width, (float)targets[id].height};
+    }
+
+    /**
+     * Begin drawing to a render target.
+     * Coordinates are in the target's base size regardless of the texture's resolution, so cameras and screen space
+     * drawing work unchanged.
+     *
+     * @param id The id of the render target.
+     */
+    void begin_target(int id)
+    {
+        auto& target = targets[id];
+        BeginTextureMode(get_texture(id));
+        if (target.texture.texture.width != target.width || target.texture.texture.height != target.height)
+        {
+            // BeginTextureMode sets the projection to the texture size; map the base size onto it instead.
+            rlMatrixMode(RL_PROJECTION);
+            rlLoadIdentity();
+            rlOrtho(0, target.width, target.height, 0, 0.0, 1.0);
+            rlMatrixMode(RL_MODELVIEW);
+        }
+    }
+
+    /**
+     * End drawing to a render target.
+     *
+     * @param id The id of the render target.
+     */
+    void end_target(int id)
+    {
+        EndTextureMode();
+    }
+
+    /**
+     * Draw a render target to the current framebuffer.
+     * Pixel perfect targets are drawn at the largest whole number scale that fits and centered in the rectangle.
+     *
+     * @param id The id of the render target.
+     * @param dest The rectangle to draw into.
+     * @param tint The color to tint the texture with.
+     */
+    void draw_target(int id, Rectangle dest, Color tint = WHITE)
+    {
+        auto& target = targets[id];
+        if (target.texture.id == 0)
+        {
+            return;
+        }
+
+        if (target.pixel_perfect)
+        {
+            float scale = std::floor(std::min(dest.width / target.width, dest.height / target.height));
+            scale = std::max(1.0f, scale);
+            float width = target.width * scale;
+            float height = target.height * scale;
+            dest = {dest.x + (dest.width - width) / 2.0f, dest.y + (dest.height - height) / 2.0f, width, height};
+        }
+
+        draw_target_region(id, {0.0f, 0.0f, (float)target.width, (float)target.height}, dest, tint);
+    }
+
+    /**
+     * Draw part of a render target to the current framebuffer.
+     *
+     * @param id The id of the render target.
+     * @param region The part of the target to draw, in the target's base size.
+     * @param dest The rectangle to draw into.
+     * @param tint The color to tint the texture with.
+     */
+    void draw_target_region(int id, Rectangle region, Rectangle dest, Color tint = WHITE)
+    {
+        auto& target = targets[id];
+        if (target.texture.id == 0)
+        {
+            return;
+        }
+
+        // Render textures are stored upside down, so flip the region and sample it with a negative height.
+        const Texture2D& texture = target.texture.texture;
+        float scale_x = (float)texture.width / target.width;
+        float scale_y = (float)texture.height / target.height;
+        Rectangle source = {region.x * scale_x,
+                            (target.height - region.y - region.height) * scale_y,
+                            region.width * scale_x,
+                            -region.height * scale_y};
+        DrawTexturePro(texture, source, dest, {0.0f, 0.0f}, 0.0f, tint);
+    }
+
+    /**
+     * Get a render texture of the given size from the pool, or load a new one.
+     * For internal use only.
+     *
+     * @param width The width of the texture.
+     * @param height The height of the texture.
+     * @return The render texture.
+     */
+    RenderTexture2D acquire_texture(int width, int height)
+    {
+        for (int i = 0; i < (int)free_textures.size(); i++)
+        {
+            auto texture = free_textures[i];
+            if (texture.texture.width == width && texture.texture.height == height)
+            {
+                free_textures.erase(free_textures.begin() + i);
+                return texture;
+            }
+        }
+        return LoadRenderTexture(width, height);
+    }
+};
@@ -1,10 +1,16 @@
 #pragma once
 
 #include <LDtkLoader/Project.hpp>
+#include <rlgl.h>
 
 #include "engine/framework.h"
+#include "engine/prefabs/managers.h"
 #include "engine/physics_debug.h"
 #include "engine/raycasts.h"
+#include "engine/simd.h"
+#include "engine/text_layout.h"
+#include "engine/thread_pool.h"
+#include "engine/tile_grid.h"
 
 /**
  * For when you want multiple of the same service.
@@ -13,7 +19,8 @@ template <typename T>
 class MultiService : public Service
 {
 public:
-    std::unordered_map<std::string, std::unique_ptr<T>> services;
+    // Usually only a few, so they are kept inline and searched in order.
+    SmallVector<std::pair<InternedName, std::unique_ptr<T>>, 4> services;
 
     MultiService() = default;
 
@@ -36,9 +43,8 @@ public:
     {
         for (auto& service : services)
         {
-            service.second->update();
+            service.second->update(delta_time);
         }
-        Service::update(delta_time);
     }
 
     /**
@@ -58,10 +64,19 @@ public:
      * @param name The name to give the service.
      * @param service The service to add.
      */
-    void add_service(std::string name, std::unique_ptr<T> service)
+    void add_service(std::string_view name, std::unique_ptr<T> service)
     {
         static_assert(std::is_base_of<Service, T>::value, "T must derive from Service");
-        services[name] = std::move(service);
+        InternedName interned(name);
+        for (auto& entry : services)
+        {
+            if (entry.first == interned)
+            {
+                entry.second = std::move(service);
+                return;
+            }
+        }
+        services.emplace_back(interned, std::move(service));
     }
 
     /**
@@ -72,7 +87,7 @@ public:
      * @return A pointer to the added service.
      */
     template <typename... TArgs>
-    T* add_service(std::string name, TArgs&&... args)
+    T* add_service(std::string_view name, TArgs&&... args)
     {
         static_assert(std::is_base_of<Service, T>::value, "T must derive from Service");
         auto new_service = std::make_unique<T>(std::forward<TArgs>(args)...);
@@ -85,11 +100,19 @@ public:
      * Get a service by name.
      *
      * @param name The name of the service.
-     * @return A pointer to the service.
+     * @return A pointer to the service, or nullptr if not found.
      */
-    T* get_service(std::string name)
+    T* get_service(std::string_view name)
     {
-        return services[name].get();
+        InternedName interned = InternedName::find(name);
+        for (auto& entry : services)
+        {
+            if (entry.first == interned)
+            {
+                return entry.second.get();
+            }
+        }
+        return nullptr;
     }
 };
 
@@ -129,18 +152,100 @@ public:
     }
 };
 
+/**
+ * The header of a SoundService cache file.
+ */
+struct SoundCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t sample_rate;
+    uint32_t sound_count;
+};
+
+/**
+ * A sound in a SoundService cache file. Followed by the filename and the samples.
+ */
+struct SoundCacheRecord
+{
+    uint32_t name_length;
+    uint32_t frame_count;
+    int64_t mod_time;
+    uint32_t sample_rate;
+    uint32_t sample_size;
+    uint32_t channels;
+    uint32_t reserved = 0;
+};
+
+/**
+ * A decoded sound waiting to be uploaded, or read from the sound cache file.
+ */
+struct DecodedSound
+{
+    long mod_time = 0;
+    Wave wave = {0};
+};
+
 /**
  * Service for managing sounds.
  * Useful when you don't want to load the same sound multiple times and want to play overlapping sounds.
+ * Sounds passed to the constructor are decoded in parallel on worker threads while the scene sets up its other
+ * services, and uploaded when the service is initialized, so get_sound() never touches the filesystem for them.
+ * With a cache file, decoded sounds are stored already converted to the mixer's format and are read back on later
+ * runs instead of being decoded again. Entries are decoded again when their source file changes.
  */
 class SoundService : public Service
 {
 public:
     std::unordered_map<std::string, std::vector<Sound>> sounds;
 
-    SoundService() = default;
+    std::string cache_file;
+    // The rate sounds are resampled to before caching. Should match the audio device so uploading is a plain copy.
+    int sample_rate = 48000;
+    bool cache_dirty = false;
+
+    // Every sound that will be in the cache file, including ones other scenes use.
+    std::unordered_map<std::string, DecodedSound> cached;
+    // Sounds decoded by the workers, waiting to be uploaded.
+    std::unordered_map<std::string, DecodedSound> decoded;
+    std::mutex decoded_mutex;
+
+    // Only alive while preloading.
+    std::unique_ptr<ThreadPool> workers;
+
+    /**
+     * Constructor for SoundService.
+     *
+     * @param filenames The sounds to start decoding now.
+     * @param cache_file The file to keep decoded sounds in, empty for no cache.
+     * @param sample_rate The rate to resample cached sounds to.
+     */
+    SoundService(const std::vector<std::string>& filenames = {},
+                 const std::string& cache_file = "",
+                 int sample_rate = 48000) :
+        cache_file(cache_file),
+        sample_rate(sample_rate)
+    {
+        if (!cache_file.empty())
+        {
+            load_cache();
+        }
+        preload(filenames);
+    }
+
     ~SoundService()
     {
+        // Let any decodes still running finish before freeing what they wrote.
+        workers.reset();
+        for (auto& pair : decoded)
+        {
+            UnloadWave(pair.second.wave);
+        }
+        for (auto& pair : cached)
+        {
+            UnloadWave(pair.second.wave);
+        }
+
         for (auto& pair : sounds)
         {
             // The first sound is a real sound.
@@ -152,9 +257,113 @@ public:
         }
     }
 
+    /**
+     * Upload the preloaded sounds.
+     */
+    void init() override
+    {
+        finish_preload();
+    }
+
+    /**
+     * Start decoding sounds on worker threads.
+     * Sounds found in the cache file are not decoded again.
+     * If the service is already initialized, this waits for the sounds and uploads them.
+     *
+     * @param filenames The sounds to decode.
+     */
+    void preload(const std::vector<std::string>& filenames)
+    {
+        for (const auto& filename : filenames)
+        {
+            if (sounds.find(filename) != sounds.end() || decoded.find(filename) != decoded.end())
+            {
+                continue;
+            }
+
+            long mod_time = GetFileModTime(filename.c_str());
+            auto it = cached.find(filename);
+            if (it != cached.end() && it->second.mod_time == mod_time)
+            {
+                continue;
+            }
+
+            if (!workers)
+            {
+                int thread_count = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+                workers = std::make_unique<ThreadPool>(std::min(thread_count, (int)filenames.size()));
+            }
+
+            {
+                // Reserve the entry so the same sound isn't decoded twice.
+                std::lock_guard<std::mutex> lock(decoded_mutex);
+                decoded[filename].mod_time = mod_time;
+            }
+            workers->submit(
+                [this, filename]()
+                {
+                    Wave wave = LoadWave(filename.c_str());
+                    if (IsWaveValid(wave))
+                    {
+                        // Convert to the mixer's format now so uploading doesn't have to.
+                        WaveFormat(&wave, sample_rate, 32, 2);
+                    }
+                    std::lock_guard<std::mutex> lock(decoded_mutex);
+                    decoded[filename].wave = wave;
+                });
+        }
+
+        if (is_init)
+        {
+            finish_preload();
+        }
+    }
+
+    /**
+     * Wait for the workers and upload everything they decoded, then save the cache file if it changed.
+     * For internal use only.
+     */
+    void finish_preload()
+    {
+        workers.reset();
+
+        for (auto& pair : decoded)
+        {
+            if (!IsWaveValid(pair.second.wave))
+            {
+                TraceLog(LOG_ERROR, "Failed to load sound: %s", pair.first.c_str());
+                continue;
+            }
+            sounds[pair.first] = {LoadSoundFromWave(pair.second.wave)};
+
+            if (!cache_file.empty())
+            {
+                auto it = cached.find(pair.first);
+                if (it != cached.end())
+                {
+                    UnloadWave(it->second.wave);
+                }
+                cached[pair.first] = pair.second;
+                cache_dirty = true;
+            }
+            else
+            {
+                UnloadWave(pair.second.wave);
+            }
+        }
+        decoded.clear();
+
+        // Cached sounds are uploaded when first asked for, since the cache may hold other scenes' sounds.
+        if (cache_dirty)
+        {
+            save_cache();
+            cache_dirty = false;
+        }
+    }
+
     /**
      * Get a sound by filename.
-     * Loads the sound if it is not already loaded.
+     * Uploads the sound from the cache, or loads it if it was not preloaded.
      * Creates a new alias if the sound is already loaded to allow overlapping sounds.
      *
      * @param filename The filename of the sound.
@@ -164,8 +373,17 @@ public:
     {
         if (sounds.find(filename) == sounds.end())
         {
-            Sound sound = LoadSound(filename.c_str());
-            sounds[filename] = {sound};
+            auto it = cached.find(filename);
+            if (it != cached.end())
+            {
+                sounds[filename] = {LoadSoundFromWave(it->second.wave)};
+            }
+            else
+            {
+                TraceLog(LOG_WARNING, "Sound was not preloaded: %s", filename.c_str());
+                Sound sound = LoadSound(filename.c_str());
+                sounds[filename] = {sound};
+            }
         }
         else
         {
@@ -175,985 +393,5619 @@ public:
         }
         return sounds[filename].back();
     }
+
+    /**
+     * Read the cache file.
+     * For internal use only.
+     */
+    void load_cache()
+    {
+        if (!FileExists(cache_file.c_str()))
+        {
+            return;
+        }
+        int size = 0;
+        unsigned char* data = LoadFileData(cache_file.c_str(), &size);
+        if (data == nullptr)
+        {
+            return;
+        }
+
+        int offset = 0;
+        auto read = [&](void* out, int bytes)
+        {
+            if (offset + bytes > size)
+            {
+                return false;
+            }
+            std::memcpy(out, data + offset, bytes);
+            offset += bytes;
+            return true;
+        };
+
+        SoundCacheHeader header;
+        if (!read(&header, sizeof(header)) || std::memcmp(header.magic, "SNDC", 4) != 0 || header.version != 1 ||
+            header.sample_rate != (uint32_t)sample_rate)
+        {
+            TraceLog(LOG_WARNING, "Ignoring out of date sound cache: %s", cache_file.c_str());
+            UnloadFileData(data);
+            return;
+        }
+
+        for (uint32_t i = 0; i < header.sound_count; i++)
+        {
+            SoundCacheRecord record;
+            if (!read(&record, sizeof(record)) || offset + (int)record.name_length > size)
+            {
+                TraceLog(LOG_WARNING, "Sound cache is truncated: %s", cache_file.c_str());
+                break;
+            }
+            std::string filename(reinterpret_cast<const char*>(data + offset), record.name_length);
+            offset += record.name_length;
+
+            DecodedSound sound;
+            sound.mod_time = (long)record.mod_time;
+            sound.wave.frameCount = record.frame_count;
+            sound.wave.sampleRate = record.sample_rate;
+            sound.wave.sampleSize = record.sample_size;
+            sound.wave.channels = record.channels;
+            int bytes = (int)(record.frame_count * record.channels * (record.sample_size / 8));
+            sound.wave.data = MemAlloc(bytes);
+            if (!read(sound.wave.data, bytes))
+            {
+                TraceLog(LOG_WARNING, "Sound cache is truncated: %s", cache_file.c_str());
+                MemFree(sound.wave.data);
+                break;
+            }
+            cached[filename] = sound;
+        }
+        UnloadFileData(data);
+    }
+
+    /**
+     * Write every cached sound to the cache file.
+     * For internal use only.
+     */
+    void save_cache()
+    {
+        std::vector<unsigned char> buffer;
+        auto write = [&](const void* in, size_t bytes)
+        {
+            auto bytes_in = static_cast<const unsigned char*>(in);
+            buffer.insert(buffer.end(), bytes_in, bytes_in + bytes);
+        };
+
+        SoundCacheHeader header;
+        std::memcpy(header.magic, "SNDC", 4);
+        header.version = 1;
+        header.sample_rate = sample_rate;
+        header.sound_count = (uint32_t)cached.size();
+        write(&header, sizeof(header));
+
+        for (const auto& pair : cached)
+        {
+            const Wave& wave = pair.second.wave;
+            SoundCacheRecord record;
+            record.name_length = (uint32_t)pair.first.size();
+            record.mod_time = (int64_t)pair.second.mod_time;
+            record.frame_count = wave.frameCount;
+            record.sample_rate = wave.sampleRate;
+            record.sample_size = wave.sampleSize;
+            record.channels = wave.channels;
+            write(&record, sizeof(record));
+            write(pair.first.data(), pair.first.size());
+            write(wave.data, wave.frameCount * wave.channels * (wave.sampleSize / 8));
+        }
+
+        if (!SaveFileData(cache_file.c_str(), buffer.data(), (int)buffer.size()))
+        {
+            TraceLog(LOG_WARNING, "Failed to save sound cache: %s", cache_file.c_str());
+        }
+    }
 };
 
 /**
- * Service for managing the physics world.
+ * Hands out slots in a structure of arrays, reusing freed ones before growing.
+ * The storage structs that use it, like SoundSources and PathMovers, are owned through a shared_ptr by both their
+ * service and the components that hold slots in them. A scene destroys its services before its game objects, so the
+ * shared ownership is what lets a component free its slot in its destructor after the service is gone.
  */
-class PhysicsService : public Service
+struct SlotAllocator
 {
-public:
-    b2WorldId world = b2_nullWorldId;
-    b2Vec2 gravity = {0.0f, 10.0f};
-    float time_step = 1.0f / 60.0f;
-    int sub_steps = 6;
-    float meters_to_pixels = 30.0f;
-    float pixels_to_meters = 1.0f / meters_to_pixels;
-    PhysicsDebugRenderer debug_draw;
+    std::vector<int> free_slots;
+    int size = 0;
 
     /**
-     * Constructor for PhysicsService.
+     * Take a slot, reusing a free one if there is one.
      *
-     * @param gravity The gravity vector for the physics world.
-     * @param time_step The time step for the physics simulation.
-     * @param sub_steps The number of sub-steps for the physics simulation.
-     * @param meters_to_pixels The scale factor from meters to pixels.
+     * @return The index of the slot. Equal to the old size when the arrays need to grow to fit it.
      */
-    PhysicsService(b2Vec2 gravity = b2Vec2{0.0f, 10.0f},
-                   float time_step = 1.0f / 60.0f,
-                   int sub_steps = 6,
-                   float meters_to_pixels = 30.0f) :
-        gravity(gravity),
-        time_step(time_step),
-        sub_steps(sub_steps),
-        meters_to_pixels(meters_to_pixels),
-        pixels_to_meters(1.0f / meters_to_pixels)
-    {
-    }
-
-    ~PhysicsService()
+    int acquire()
     {
-        if (b2World_IsValid(world))
+        if (!free_slots.empty())
         {
-            b2DestroyWorld(world);
+            int index = free_slots.back();
+            free_slots.pop_back();
+            return index;
         }
+        return size++;
     }
 
     /**
-     * Initialize the physics world.
+     * Give a slot back to be reused.
+     *
+     * @param index The index of the slot.
      */
-    void init() override
+    void release(int index)
     {
-        b2WorldDef world_def = b2DefaultWorldDef();
-        world_def.gravity = gravity;
-        world_def.contactHertz = 120;
-        world = b2CreateWorld(&world_def);
-        debug_draw.init(meters_to_pixels);
+        free_slots.push_back(index);
     }
+};
+
+/**
+ * Storage for the sound sources of AudioListenerService, as a structure of arrays to keep the per frame pass tight.
+ */
+struct SoundSources
+{
+    SlotAllocator slots;
+    std::vector<Sound> sounds;
+    std::vector<float> source_x;
+    std::vector<float> source_y;
+    std::vector<float> source_volume;
+    std::vector<float> applied_volume;
+    std::vector<float> applied_pan;
+    std::vector<uint8_t> playing;
+    std::vector<uint8_t> in_use;
+
+    // Cleared when the service is destroyed. The SoundService goes with it, so the sounds can't be touched after.
+    bool sounds_loaded = true;
 
     /**
-     * Update the physics world.
+     * Add a source, reusing a free slot if there is one.
      *
-     * @param delta_time The time elapsed since the last frame.
+     * @param sound The sound to play.
+     * @param volume The volume of the sound before attenuation.
+     * @return The index of the source.
      */
-    void update(float delta_time) override
+    int add(Sound sound, float volume)
     {
-        if (!b2World_IsValid(world))
+        int index = slots.acquire();
+        if (index == (int)in_use.size())
         {
-            return;
+            sounds.emplace_back();
+            source_x.push_back(0.0f);
+            source_y.push_back(0.0f);
+            source_volume.push_back(0.0f);
+            applied_volume.push_back(0.0f);
+            applied_pan.push_back(0.0f);
+            playing.push_back(0);
+            in_use.push_back(0);
         }
-        b2World_Step(world, time_step, sub_steps);
+
+        sounds[index] = sound;
+        source_x[index] = 0.0f;
+        source_y[index] = 0.0f;
+        source_volume[index] = volume;
+        applied_volume[index] = -1.0f;
+        applied_pan[index] = -1.0f;
+        playing[index] = 0;
+        in_use[index] = 1;
+        return index;
     }
 
     /**
-     * Draw the physics debug information.
+     * Remove a source and free its slot, stopping it if it is playing.
+     *
+     * @param index The index of the source.
      */
-    void draw_debug()
+    void remove(int index)
     {
-        debug_draw.draw_debug(world);
+        if (index < 0 || index >= (int)in_use.size() || !in_use[index])
+        {
+            return;
+        }
+        if (playing[index] && sounds_loaded)
+        {
+            StopSound(sounds[index]);
+        }
+        playing[index] = 0;
+        in_use[index] = 0;
+        slots.release(index);
+    }
+};
+
+/**
+ * Service for sounds that come from a place in the world.
+ * Each frame the volume and pan of every playing source is worked out from its distance to the nearest listener in
+ * one pass over all sources, and only pushed to the mixer when it changed. Sources too far from every listener to be
+ * heard are never started, and playing ones are stopped once they fall out of range.
+ * With no listeners, sources play at full volume and centered.
+ */
+class AudioListenerService : public Service
+{
+public:
+    std::vector<Vector2> listeners;
+
+    // Sources are at full volume within min_distance and silent past max_distance, in pixels.
+    float min_distance = 100.0f;
+    float max_distance = 800.0f;
+    // How far to the side a source is panned fully left or right, in pixels.
+    float pan_distance = 400.0f;
+    // Sources quieter than this are culled.
+    float cull_volume = 0.01f;
+
+    std::shared_ptr<SoundSources> sources = std::make_shared<SoundSources>();
+
+    // Scratch buffers for the per frame pass.
+    std::vector<int> active;
+    std::vector<float> gains;
+    std::vector<float> offsets;
+
+    ~AudioListenerService()
+    {
+        sources->sounds_loaded = false;
     }
 
     /**
-     * Convert between pixels and meters.
+     * Add a listener.
      *
-     * @param meters The value in meters.
-     * @return The value in pixels.
+     * @param position The position of the listener in pixels.
+     * @return The index of the listener.
      */
-    Vector2 convert_to_pixels(b2Vec2 meters) const
+    int add_listener(Vector2 position)
     {
-        const auto converted = meters * meters_to_pixels;
-        return {converted.x, converted.y};
+        listeners.push_back(position);
+        return (int)listeners.size() - 1;
     }
 
     /**
-     * Convert between pixels and meters.
+     * Move a listener. Usually called every frame with a camera's target.
      *
-     * @param pixels The value in pixels.
-     * @return The value in meters.
+     * @param index The index of the listener.
+     * @param position The position of the listener in pixels.
      */
-    b2Vec2 convert_to_meters(Vector2 pixels) const
+    void set_listener_position(int index, Vector2 position)
     {
-        const auto converted = pixels * pixels_to_meters;
-        return {converted.x, converted.y};
+        listeners[index] = position;
     }
 
     /**
-     * Convert a length from meters to pixels.
+     * Add a sound source. The sound should be its own alias, see SoundService::get_sound().
      *
-     * @param meters The length in meters.
-     * @return The length in pixels.
+     * @param sound The sound to play.
+     * @param volume The volume of the sound before attenuation.
+     * @return The index of the source.
      */
-    float convert_to_pixels(float meters) const
+    int add_source(Sound sound, float volume = 1.0f)
     {
-        return meters * meters_to_pixels;
+        return sources->add(sound, volume);
     }
 
     /**
-     * Convert a length from pixels to meters.
+     * Remove a sound source. The sound itself is owned by the SoundService.
      *
-     * @param pixels The length in pixels.
-     * @return The length in meters.
+     * @param index The index of the source.
      */
-    float convert_to_meters(float pixels) const
+    void remove_source(int index)
     {
-        return pixels * pixels_to_meters;
+        sources->remove(index);
     }
 
     /**
-     * Raycast in pixels.
+     * Move a sound source.
      *
-     * @param ignore Box2d body to ignore.
-     * @param from The start point of the ray.
-     * @param to The end point of the ray.
-     * @return A RayHit struct describing the hit.
+     * @param index The index of the source.
+     * @param position The position of the source in pixels.
      */
-    RayHit raycast(b2BodyId ignore, Vector2 from, Vector2 to)
+    void set_source_position(int index, Vector2 position)
     {
-        auto start = convert_to_meters(from);
-        auto translation = convert_to_meters(to - from);
-
-        return raycast_closest(world, ignore, start, translation);
+        sources->source_x[index] = position.x;
+        sources->source_y[index] = position.y;
     }
 
     /**
-     * Check for circle shape overlaps in pixels.
+     * Set the volume of a sound source before attenuation.
      *
-     * @param center The center of the circle.
-     * @param radius The radius of the circle.
-     * @param ignore_body The body to ignore.
-     * @return A vector of body IDs that overlap with the circle.
+     * @param index The index of the source.
+     * @param volume The volume of the source.
      */
-    std::vector<b2BodyId> circle_overlap(Vector2 center, float radius, b2BodyId ignore_body = b2_nullBodyId)
+    void set_source_volume(int index, float volume)
     {
-        auto center_m = convert_to_meters(center);
-        auto radius_m = convert_to_meters(radius);
-        return circle_hit(world, ignore_body, center_m, radius_m);
+        sources->source_volume[index] = volume;
     }
 
     /**
-     * Check for rectangle shape overlaps in pixels.
+     * Play a sound source, unless it is too far away to be heard.
      *
-     * @param rectangle The rectangle to check.
-     * @param rotation The rotation of the rectangle in degrees.
-     * @param ignore_body The body to ignore.
-     * @return A vector of body IDs that overlap with the rectangle.
+     * @param index The index of the source.
      */
-    std::vector<b2BodyId> rectangle_overlap(Rectangle rectangle,
-                                            float rotation = 0.0f,
-                                            b2BodyId ignore_body = b2_nullBodyId)
+    void play(int index)
     {
-        Vector2 size = {rectangle.width, rectangle.height};
-        Vector2 center = {rectangle.x + size.x / 2.0f, rectangle.y + size.y / 2.0f};
-        auto size_m = convert_to_meters(size);
-        auto center_m = convert_to_meters(center);
-        return rectangle_hit(world, ignore_body, center_m, size_m, rotation);
+        active.assign(1, index);
+        attenuate();
+        if (gains[0] * sources->source_volume[index] < cull_volume)
+        {
+            return;
+        }
+        apply(0);
+        PlaySound(sources->sounds[index]);
+        sources->playing[index] = 1;
     }
-};
 
-/**
- * Hash for ldtk::IntPoint to be used in unordered_map/set.
- */
-struct IntPointHash
-{
-    size_t operator()(const ldtk::IntPoint& p) const noexcept
+    /**
+     * Stop a sound source.
+     *
+     * @param index The index of the source.
+     */
+    void stop(int index)
     {
-        std::size_t h1 = std::hash<int>{}(p.x);
-        std::size_t h2 = std::hash<int>{}(p.y);
-        return h1 ^ (h2 << 1);
+        StopSound(sources->sounds[index]);
+        sources->playing[index] = 0;
+    }
+
+    /**
+     * Update the volume and pan of all playing sources.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        active.clear();
+        for (int i = 0; i < (int)sources->playing.size(); i++)
+        {
+            if (!sources->playing[i])
+            {
+                continue;
+            }
+            if (!IsSoundPlaying(sources->sounds[i]))
+            {
+                sources->playing[i] = 0;
+                continue;
+            }
+            active.push_back(i);
+        }
+        if (active.empty())
+        {
+            return;
+        }
+
+        attenuate();
+        for (int a = 0; a < (int)active.size(); a++)
+        {
+            int i = active[a];
+            if (gains[a] * sources->source_volume[i] < cull_volume)
+            {
+                // Out of range, free the voice.
+                StopSound(sources->sounds[i]);
+                sources->playing[i] = 0;
+                continue;
+            }
+            apply(a);
+        }
+    }
+
+    /**
+     * Work out the gain and horizontal offset from the loudest listener for every source in active.
+     * For internal use only.
+     */
+    void attenuate()
+    {
+        int count = (int)active.size();
+        gains.assign(count, listeners.empty() ? 1.0f : 0.0f);
+        offsets.assign(count, 0.0f);
+
+        float range = std::max(1.0f, max_distance - min_distance);
+        for (const auto& listener : listeners)
+        {
+            for (int a = 0; a < count; a++)
+            {
+                int i = active[a];
+                float dx = sources->source_x[i] - listener.x;
+                float dy = sources->source_y[i] - listener.y;
+                float distance = std::sqrt(dx * dx + dy * dy);
+                float t = std::clamp((distance - min_distance) / range, 0.0f, 1.0f);
+                // Squared falloff sounds more natural than linear.
+                float gain = (1.0f - t) * (1.0f - t);
+                if (gain > gains[a])
+                {
+                    gains[a] = gain;
+                    offsets[a] = dx;
+                }
+            }
+        }
+    }
+
+    /**
+     * Push the volume and pan of a source in active to the mixer if they changed enough to hear.
+     * For internal use only.
+     *
+     * @param a The index into active.
+     */
+    void apply(int a)
+    {
+        int i = active[a];
+        float volume = gains[a] * sources->source_volume[i];
+        float pan = 0.5f + 0.5f * std::clamp(offsets[a] / pan_distance, -1.0f, 1.0f);
+        if (std::fabs(volume - sources->applied_volume[i]) > 0.01f)
+        {
+            SetSoundVolume(sources->sounds[i], volume);
+            sources->applied_volume[i] = volume;
+        }
+        if (std::fabs(pan - sources->applied_pan[i]) > 0.01f)
+        {
+            SetSoundPan(sources->sounds[i], pan);
+            sources->applied_pan[i] = pan;
+        }
     }
 };
 
 /**
- * Undirected edge between two IntPoints, stored canonically (a < b).
+ * A handle to a timer scheduled with TimerService.
+ * Stays valid to check after the timer fires or is cancelled, it just stops being pending.
  */
-struct Edge
+struct TimerHandle
 {
-    ldtk::IntPoint a, b;
+    int index = -1;
+    uint32_t generation = 0;
 };
 
 /**
- * Equality operator for Edge.
- *
- * @param e1 The first edge.
- * @param e2 The second edge.
- * @return True if the edges are equal, false otherwise.
+ * A timer in TimerService's wheel, or the head of one of its slot lists.
  */
-static inline bool operator==(const Edge& e1, const Edge& e2)
+struct TimerNode
 {
-    return e1.a == e2.a && e1.b == e2.b;
-}
+    int prev = -1;
+    int next = -1;
+    uint64_t expire = 0;
+    uint32_t interval = 0;
+    uint32_t generation = 0;
+    bool in_use = false;
+    std::function<void()> callback;
+};
 
 /**
- * Hash for Edge to be used in unordered_map/set.
+ * Service for timers, as a hierarchical timing wheel.
+ * Time is counted in fixed ticks. Timers sit in a slot of one of four wheels by how far away they are, and only the
+ * slot for the current tick is looked at, so scheduling and cancelling are O(1) and pending timers cost nothing
+ * until they are due. Timers further out move down to a finer wheel when their turn comes around.
+ * Timers either call a callback when they fire, or can be polled with is_pending(). Timers due on the same tick
+ * don't necessarily fire in the order they were scheduled, since ones moved down from a coarser wheel join the end
+ * of the slot. The order only depends on the sequence of calls though, so with advance() driven by a fixed step the
+ * results are deterministic.
+ * Callbacks must not outlive what they capture. Poll with is_pending() where that is enough, and otherwise cancel
+ * the timer in the destructor of whatever the callback uses, checking alive first since the service is destroyed
+ * before the scene's game objects.
  */
-struct EdgeHash
+class TimerService : public Service
 {
-    size_t operator()(const Edge& e) const noexcept
+public:
+    static constexpr int wheel_bits = 6;
+    static constexpr int wheel_size = 1 << wheel_bits;
+    static constexpr int wheel_mask = wheel_size - 1;
+    static constexpr int wheel_count = 4;
+
+    float tick_duration = 1.0f / 120.0f;
+    float accumulator = 0.0f;
+    uint64_t current_tick = 0;
+
+    // The first wheel_count * wheel_size nodes are the heads of the slot lists, and the one after is the list being
+    // fired. Timers come after them.
+    std::vector<TimerNode> nodes;
+    std::vector<int> free_nodes;
+    int firing_head = 0;
+
+    // Cleared when the service is destroyed, so game objects know if they can still cancel their timers.
+    std::shared_ptr<bool> alive = std::make_shared<bool>(true);
+
+    /**
+     * Constructor for TimerService.
+     *
+     * @param tick_duration The length of a tick in seconds. Timers are rounded to whole ticks.
+     */
+    TimerService(float tick_duration = 1.0f / 120.0f) : tick_duration(tick_duration)
     {
-        IntPointHash h;
-        std::size_t h1 = h(e.a);
-        std::size_t h2 = h(e.b);
-        return h1 ^ (h2 << 1);
+        int heads = wheel_count * wheel_size + 1;
+        nodes.resize(heads);
+        for (int i = 0; i < heads; i++)
+        {
+            nodes[i].prev = i;
+            nodes[i].next = i;
+        }
+        firing_head = heads - 1;
     }
-};
 
-struct LayerRenderer
-{
-    RenderTexture2D renderer;
-    ldtk::IID layer_iid;
-    bool visible = true;
-};
+    ~TimerService()
+    {
+        *alive = false;
+    }
 
-/**
- * Service for managing LDtk levels.
- * Depends on TextureService and PhysicsService.
- */
-class LevelService : public Service
-{
-public:
-    ldtk::Project project;
-    std::string project_file;
-    std::string level_name;
-    std::vector<std::string> collision_names;
-    std::vector<LayerRenderer> renderers;
-    std::vector<b2BodyId> layer_bodies;
-    float scale = 1.0f;
-    PhysicsService* physics;
+    /**
+     * Schedule a timer.
+     *
+     * @param delay The time in seconds until the timer fires.
+     * @param callback Called when the timer fires. Can be empty to poll with is_pending() instead.
+     * @return A handle to the timer.
+     */
+    TimerHandle schedule(float delay, std::function<void()> callback = nullptr)
+    {
+        return add_timer(to_ticks(delay), 0, std::move(callback));
+    }
 
     /**
-     * Constructor for LevelService.
+     * Schedule a timer that fires again every interval until it is cancelled.
      *
-     * @param project_file The path to the LDtk project file.
-     * @param level_name The name of the level to load.
-     * @param collision_names The names of the layers to create collision bodies for.
-     * @param scale The scale factor for the level.
+     * @param interval The time in seconds between firings.
+     * @param callback Called each time the timer fires.
+     * @return A handle to the timer.
      */
-    LevelService(std::string project_file,
-                 std::string level_name,
-                 std::vector<std::string> collision_names,
-                 float scale = 1.0f) :
-        project_file(project_file),
-        level_name(level_name),
-        collision_names(collision_names),
-        scale(scale)
+    TimerHandle schedule_repeating(float interval, std::function<void()> callback)
     {
+        uint32_t ticks = to_ticks(interval);
+        return add_timer(ticks, ticks, std::move(callback));
     }
 
-    virtual ~LevelService()
+    /**
+     * Cancel a timer. Does nothing if it already fired or was cancelled.
+     *
+     * @param handle The handle to the timer. Reset so it no longer refers to a timer.
+     */
+    void cancel(TimerHandle& handle)
     {
-        for (auto& renderer : renderers)
+        if (is_pending(handle))
         {
-            UnloadRenderTexture(renderer.renderer);
+            unlink(handle.index);
+            free_node(handle.index);
         }
+        handle = TimerHandle();
+    }
 
-        for (auto& body : layer_bodies)
-        {
-            if (b2Body_IsValid(body))
-            {
-                b2DestroyBody(body);
-            }
-        }
+    /**
+     * Check if a timer has yet to fire.
+     * Repeating timers are pending until they are cancelled.
+     *
+     * @param handle The handle to the timer.
+     * @return True if the timer is scheduled, false if it fired or was cancelled.
+     */
+    bool is_pending(const TimerHandle& handle) const
+    {
+        return handle.index >= 0 && handle.index < (int)nodes.size() && nodes[handle.index].in_use &&
+               nodes[handle.index].generation == handle.generation;
     }
 
     /**
-     * Initialize the level service.
-     * Loads the LDtk project and level, creates textures and collision bodies.
+     * Get the time left until a timer fires.
+     *
+     * @param handle The handle to the timer.
+     * @return The time in seconds, or 0 if it isn't pending.
      */
-    void init() override
+    float get_remaining(const TimerHandle& handle) const
     {
-        if (!FileExists(project_file.c_str()))
+        if (!is_pending(handle))
         {
-            TraceLog(LOG_FATAL, "LDtk file not found: %s", project_file.c_str());
+            return 0.0f;
         }
-        project.loadFromFile(project_file);
-        const auto& world = project.getWorld();
-        const auto& levels = world.allLevels();
+        return (nodes[handle.index].expire + 1 - current_tick) * tick_duration;
+    }
 
-        bool found = false;
-        for (const auto& level : levels)
+    /**
+     * Advance by the time elapsed, firing timers in whole ticks.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        accumulator += delta_time;
+        int ticks = (int)(accumulator / tick_duration);
+        accumulator -= ticks * tick_duration;
+        advance(ticks);
+    }
+
+    /**
+     * Advance by a number of ticks, firing the timers that are due in order.
+     * Use this instead of update() to drive the timers from a fixed step.
+     *
+     * @param ticks The number of ticks to advance.
+     */
+    void advance(int ticks)
+    {
+        for (int i = 0; i < ticks; i++)
         {
-            if (level.name == level_name)
+            int index = current_tick & wheel_mask;
+            // When the first wheel wraps, bring down the next slot of each coarser wheel that also wrapped.
+            for (int wheel = 1; wheel < wheel_count && index == 0; wheel++)
             {
-                found = true;
-                break;
+                index = (current_tick >> (wheel * wheel_bits)) & wheel_mask;
+                cascade(wheel, index);
             }
-        }
-        if (!found)
-        {
-            TraceLog(LOG_FATAL, "LDtk level not found: %s", level_name.c_str());
-        }
-
-        physics = scene->get_service<PhysicsService>();
-
-        const auto& level = world.getLevel(level_name);
-        const auto& layers = level.allLayers();
 
-        // Loop through all layers and create textures and collisions bodies.
-        for (auto& layer : layers)
-        {
-            if (!layer.hasTileset())
+            int slot = head(0, current_tick & wheel_mask);
+            current_tick++;
+            if (nodes[slot].next == slot)
             {
                 continue;
             }
 
-            // Load the texture and the renderer.
-            auto directory = std::string(GetDirectoryPath(project_file.c_str()));
-            auto tileset_file = directory + "/" + layer.getTileset().path;
-            if (!FileExists(tileset_file.c_str()))
+            // Move the slot to the firing list, so callbacks can schedule and cancel timers freely.
+            splice(slot, firing_head);
+            while (nodes[firing_head].next != firing_head)
             {
-                TraceLog(LOG_FATAL, "Tileset file not found: %s", tileset_file.c_str());
-            }
-            auto texture_service = scene->get_service<TextureService>();
-            Texture2D texture = texture_service->get_texture(tileset_file);
-            RenderTexture2D renderer = LoadRenderTexture(level.size.x, level.size.y);
-
-            // Draw all the tiles.
-            const auto& tiles_vector = layer.allTiles();
-            BeginTextureMode(renderer);
-            // Clear with transparency so we can render layers on top of each other.
-            ClearBackground({0, 0, 0, 0});
-            for (const auto& tile : tiles_vector)
-            {
-                const auto& position = tile.getPosition();
-                const auto& texture_rect = tile.getTextureRect();
-                Vector2 dest = {
-                    static_cast<float>(position.x),
-                    static_cast<float>(position.y),
-                };
-                Rectangle src = {static_cast<float>(texture_rect.x),
-                                 static_cast<float>(texture_rect.y),
-                                 static_cast<float>(texture_rect.width) * (tile.flipX ? -1.0f : 1.0f),
-                                 static_cast<float>(texture_rect.height) * (tile.flipY ? -1.0f : 1.0f)};
-                DrawTextureRec(texture, src, dest, WHITE);
+                int node = nodes[firing_head].next;
+                unlink(node);
+                std::function<void()> callback;
+                if (nodes[node].interval > 0)
+                {
+                    nodes[node].expire += nodes[node].interval;
+                    insert(node);
+                    callback = nodes[node].callback;
+                }
+                else
+                {
+                    callback = std::move(nodes[node].callback);
+                    free_node(node);
+                }
+                if (callback)
+                {
+                    callback();
+                }
             }
-            EndTextureMode();
-            LayerRenderer layer_renderer;
-            layer_renderer.renderer = renderer;
-            layer_renderer.layer_iid = layer.iid;
-            renderers.push_back(layer_renderer);
-
-            // Create bodies.
-            const auto& size = layer.getGridSize();
+        }
+    }
 
-            auto make_edge = [&](ldtk::IntPoint p0, ldtk::IntPoint p1) -> Edge
-            {
-                if (p1.x < p0.x || (p1.x == p0.x && p1.y < p0.y))
-                    std::swap(p0, p1);
-                return {p0, p1};
-            };
+    /**
+     * Convert a time to whole ticks, at least one.
+     * For internal use only.
+     *
+     * @param seconds The time in seconds.
+     * @return The number of ticks.
+     */
+    uint32_t to_ticks(float seconds) const
+    {
+        return (uint32_t)std::max(1.0f, std::round(seconds / tick_duration));
+    }
 
-            std::unordered_set<Edge, EdgeHash> edges;
+    /**
+     * Get the head node of a slot list.
+     * For internal use only.
+     *
+     * @param wheel The wheel.
+     * @param slot The slot in the wheel.
+     * @return The index of the head node.
+     */
+    static int head(int wheel, int slot)
+    {
+        return wheel * wheel_size + slot;
+    }
 
-            for (int y = 0; y < size.y; y++)
-            {
-                for (int x = 0; x < size.x; x++)
-                {
-                    if (!is_solid(layer, x, y, size))
-                        continue;
-
-                    // neighbor empty => boundary edge
-                    if (!is_solid(layer, x, y - 1, size))
-                        edges.insert(make_edge({x, y}, {x + 1, y}));
-                    if (!is_solid(layer, x, y + 1, size))
-                        edges.insert(make_edge({x, y + 1}, {x + 1, y + 1}));
-                    if (!is_solid(layer, x - 1, y, size))
-                        edges.insert(make_edge({x, y}, {x, y + 1}));
-                    if (!is_solid(layer, x + 1, y, size))
-                        edges.insert(make_edge({x + 1, y}, {x + 1, y + 1}));
-                }
-            }
+    /**
+     * Take a node from the free list and schedule it.
+     * For internal use only.
+     *
+     * @param ticks The number of ticks until it fires.
+     * @param interval The number of ticks between repeats, 0 for once.
+     * @param callback Called when it fires.
+     * @return A handle to the timer.
+     */
+    TimerHandle add_timer(uint32_t ticks, uint32_t interval, std::function<void()> callback)
+    {
+        int node;
+        if (!free_nodes.empty())
+        {
+            node = free_nodes.back();
+            free_nodes.pop_back();
+        }
+        else
+        {
+            node = (int)nodes.size();
+            nodes.emplace_back();
+        }
 
-            std::unordered_map<ldtk::IntPoint, std::vector<ldtk::IntPoint>, IntPointHash> adj;
-            adj.reserve(edges.size() * 2);
+        auto& timer = nodes[node];
+        timer.in_use = true;
+        // The tick being processed next counts as the first one.
+        timer.expire = current_tick + ticks - 1;
+        timer.interval = interval;
+        timer.callback = std::move(callback);
+        insert(node);
+        return {node, timer.generation};
+    }
 
-            for (auto& e : edges)
-            {
-                adj[e.a].push_back(e.b);
-                adj[e.b].push_back(e.a);
+    /**
+     * Return a node to the free list. Its handles stop being pending.
+     * For internal use only.
+     *
+     * @param node The index of the node.
+     */
+    void free_node(int node)
+    {
+        auto& timer = nodes[node];
+        timer.in_use = false;
+        timer.generation++;
+        timer.callback = nullptr;
+        free_nodes.push_back(node);
+    }
+
+    /**
+     * Put a node in the slot for its expire tick, on the finest wheel that reaches that far.
+     * For internal use only.
+     *
+     * @param node The index of the node.
+     */
+    void insert(int node)
+    {
+        uint64_t expire = nodes[node].expire;
+        uint64_t delta = expire >= current_tick ? expire - current_tick : 0;
+        uint64_t limit = 1ull << (wheel_count * wheel_bits);
+        if (delta >= limit)
+        {
+            // Further out than the wheels reach. Park it in the last slot until it comes around.
+            expire = current_tick + limit - 1;
+            delta = limit - 1;
+        }
+
+        int wheel = 0;
+        while (wheel < wheel_count - 1 && delta >= (1ull << ((wheel + 1) * wheel_bits)))
+        {
+            wheel++;
+        }
+        int slot = (expire >> (wheel * wheel_bits)) & wheel_mask;
+        link(node, head(wheel, slot));
+    }
+
+    /**
+     * Move every node in a slot of a coarser wheel down to finer wheels.
+     * For internal use only.
+     *
+     * @param wheel The wheel.
+     * @param slot The slot in the wheel.
+     */
+    void cascade(int wheel, int slot)
+    {
+        int list = head(wheel, slot);
+        while (nodes[list].next != list)
+        {
+            int node = nodes[list].next;
+            unlink(node);
+            insert(node);
+        }
+    }
+
+    /**
+     * Add a node to the end of a list.
+     * For internal use only.
+     *
+     * @param node The index of the node.
+     * @param list The index of the list's head node.
+     */
+    void link(int node, int list)
+    {
+        int last = nodes[list].prev;
+        nodes[node].prev = last;
+        nodes[node].next = list;
+        nodes[last].next = node;
+        nodes[list].prev = node;
+    }
+
+    /**
+     * Remove a node from whatever list it is in.
+     * For internal use only.
+     *
+     * @param node The index of the node.
+     */
+    void unlink(int node)
+    {
+        nodes[nodes[node].prev].next = nodes[node].next;
+        nodes[nodes[node].next].prev = nodes[node].prev;
+        nodes[node].prev = node;
+        nodes[node].next = node;
+    }
+
+    /**
+     * Move every node of one list to the end of another, in order.
+     * For internal use only.
+     *
+     * @param from The index of the head node to take from.
+     * @param to The index of the head node to add to.
+     */
+    void splice(int from, int to)
+    {
+        int first = nodes[from].next;
+        int last = nodes[from].prev;
+        if (first == from)
+        {
+            return;
+        }
+        int to_last = nodes[to].prev;
+        nodes[to_last].next = first;
+        nodes[first].prev = to_last;
+        nodes[last].next = to;
+        nodes[to].prev = last;
+        nodes[from].next = from;
+        nodes[from].prev = from;
+    }
+};
+
+/**
+ * The base class for EventService's queues, one per event type.
+ * For internal use only.
+ */
+class EventQueueBase
+{
+public:
+    virtual ~EventQueueBase() = default;
+
+    /**
+     * Make the events published since the last dispatch current and deliver them to subscribers.
+     */
+    virtual void dispatch() = 0;
+};
+
+/**
+ * The events of one type, double buffered.
+ * Events are published into one array while the other holds the events being delivered this frame. The arrays are
+ * swapped and cleared rather than freed, so once they have grown to the busiest frame publishing doesn't allocate.
+ * For internal use only.
+ */
+template <typename T>
+class EventQueue : public EventQueueBase
+{
+public:
+    // Published this frame, delivered next frame.
+    std::vector<T> pending;
+
+    // Delivered this frame.
+    std::vector<T> current;
+
+    // Subscriber ids, whether they unsubscribed, and callbacks. Subscribers that unsubscribe during dispatch are
+    // only marked, and removed once it finishes, so a callback can unsubscribe itself while it is running.
+    std::vector<std::tuple<int, bool, std::function<void(const std::vector<T>& events)>>> subscribers;
+
+    // Subscribers added during dispatch, which start with the next one.
+    std::vector<std::tuple<int, bool, std::function<void(const std::vector<T>& events)>>> added;
+    bool dispatching = false;
+
+    void dispatch() override
+    {
+        current.swap(pending);
+        pending.clear();
+
+        dispatching = true;
+        if (!current.empty())
+        {
+            for (auto& subscriber : subscribers)
+            {
+                if (!std::get<1>(subscriber))
+                {
+                    std::get<2>(subscriber)(current);
+                }
+            }
+        }
+        dispatching = false;
+
+        for (auto& subscriber : added)
+        {
+            subscribers.push_back(std::move(subscriber));
+        }
+        added.clear();
+        remove_unsubscribed();
+    }
+
+    /**
+     * Remove the subscribers that unsubscribed.
+     * For internal use only.
+     */
+    void remove_unsubscribed()
+    {
+        subscribers.erase(std::remove_if(subscribers.begin(),
+                                         subscribers.end(),
+                                         [](const auto& subscriber) { return std::get<1>(subscriber); }),
+                          subscribers.end());
+    }
+};
+
+/**
+ * Service for passing events between game objects and services without them knowing about each other.
+ * Each event type gets its own queue, stored contiguously. Events published during a frame are delivered together
+ * the next time the service updates, so subscribers get one call with the whole batch instead of one call per event,
+ * and events published while delivering are queued rather than delivered recursively.
+ * Events can also be read with get_events() instead of subscribing. The batch doesn't change until the next update,
+ * so it can be split across threads with parallel_for.
+ * All services are added before any of them init, so the order they are added in doesn't matter for finding it. It
+ * does decide the update order though: events published by a service that updates before this one are delivered the
+ * same frame, and ones published by a later service or a game object are delivered the next frame.
+ * Queues are dispatched in the order their event types were first used. An event published while delivering, into a
+ * queue that comes later in that order, is delivered in the same update.
+ */
+class EventService : public Service
+{
+public:
+    std::unordered_map<std::type_index, std::unique_ptr<EventQueueBase>> queues;
+
+    // Queues in the order they were created, so delivery order doesn't depend on hashing.
+    std::vector<EventQueueBase*> queue_order;
+    int next_subscriber_id = 0;
+
+    /**
+     * Get the queue for an event type, creating it if needed.
+     * Hold on to the queue to skip the lookup when publishing a lot of events.
+     *
+     * @return A pointer to the queue.
+     */
+    template <typename T>
+    EventQueue<T>* get_queue()
+    {
+        auto it = queues.find(std::type_index(typeid(T)));
+        if (it != queues.end())
+        {
+            return static_cast<EventQueue<T>*>(it->second.get());
+        }
+        auto queue = std::make_unique<EventQueue<T>>();
+        EventQueue<T>* queue_ptr = queue.get();
+        queues.emplace(std::type_index(typeid(T)), std::move(queue));
+        queue_order.push_back(queue_ptr);
+        return queue_ptr;
+    }
+
+    /**
+     * Publish an event. It is delivered the next time the service updates.
+     *
+     * @param event The event to publish.
+     */
+    template <typename T>
+    void publish(const T& event)
+    {
+        get_queue<T>()->pending.push_back(event);
+    }
+
+    /**
+     * Get the events of a type delivered this frame.
+     *
+     * @return The events, valid until the next update.
+     */
+    template <typename T>
+    const std::vector<T>& get_events()
+    {
+        return get_queue<T>()->current;
+    }
+
+    /**
+     * Subscribe to an event type.
+     * The callback is called once per frame with every event of the type, and not at all on frames without any.
+     *
+     * @param callback The function to call with the events.
+     * @return The id of the subscription, for unsubscribe().
+     */
+    template <typename T>
+    int subscribe(std::function<void(const std::vector<T>& events)> callback)
+    {
+        auto queue = get_queue<T>();
+        int id = next_subscriber_id++;
+        auto& list = queue->dispatching ? queue->added : queue->subscribers;
+        list.emplace_back(id, false, std::move(callback));
+        return id;
+    }
+
+    /**
+     * Remove a subscription.
+     *
+     * @param id The id returned by subscribe().
+     */
+    template <typename T>
+    void unsubscribe(int id)
+    {
+        auto queue = get_queue<T>();
+        for (auto* list : {&queue->subscribers, &queue->added})
+        {
+            for (auto& subscriber : *list)
+            {
+                if (std::get<0>(subscriber) == id)
+                {
+                    // Marked rather than erased, in case the queue is being dispatched.
+                    std::get<1>(subscriber) = true;
+                }
+            }
+        }
+        if (!queue->dispatching)
+        {
+            queue->remove_unsubscribed();
+        }
+    }
+
+    /**
+     * Deliver the events published since the last update.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        // By index, since a subscriber can create a queue by publishing a new type of event.
+        for (size_t i = 0; i < queue_order.size(); i++)
+        {
+            queue_order[i]->dispatch();
+        }
+    }
+};
+
+/**
+ * Service for managing the physics world.
+ */
+class PhysicsService : public Service
+{
+public:
+    b2WorldId world = b2_nullWorldId;
+    b2Vec2 gravity = {0.0f, 10.0f};
+    float time_step = 1.0f / 60.0f;
+    int sub_steps = 6;
+    float meters_to_pixels = 30.0f;
+    float pixels_to_meters = 1.0f / meters_to_pixels;
+    PhysicsDebugRenderer debug_draw;
+
+    /**
+     * Constructor for PhysicsService.
+     *
+     * @param gravity The gravity vector for the physics world.
+     * @param time_step The time step for the physics simulation.
+     * @param sub_steps The number of sub-steps for the physics simulation.
+     * @param meters_to_pixels The scale factor from meters to pixels.
+     */
+    PhysicsService(b2Vec2 gravity = b2Vec2{0.0f, 10.0f},
+                   float time_step = 1.0f / 60.0f,
+                   int sub_steps = 6,
+                   float meters_to_pixels = 30.0f) :
+        gravity(gravity),
+        time_step(time_step),
+        sub_steps(sub_steps),
+        meters_to_pixels(meters_to_pixels),
+        pixels_to_meters(1.0f / meters_to_pixels)
+    {
+    }
+
+    ~PhysicsService()
+    {
+        if (b2World_IsValid(world))
+        {
+            b2DestroyWorld(world);
+        }
+    }
+
+    /**
+     * Initialize the physics world.
+     */
+    void init() override
+    {
+        b2WorldDef world_def = b2DefaultWorldDef();
+        world_def.gravity = gravity;
+        world_def.contactHertz = 120;
+        world = b2CreateWorld(&world_def);
+        debug_draw.init(meters_to_pixels);
+    }
+
+    /**
+     * Update the physics world.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        if (!b2World_IsValid(world))
+        {
+            return;
+        }
+        b2World_Step(world, time_step, sub_steps);
+    }
+
+    /**
+     * Draw the physics debug information.
+     */
+    void draw_debug()
+    {
+        debug_draw.draw_debug(world);
+    }
+
+    /**
+     * Convert between pixels and meters.
+     *
+     * @param meters The value in meters.
+     * @return The value in pixels.
+     */
+    Vector2 convert_to_pixels(b2Vec2 meters) const
+    {
+        const auto converted = meters * meters_to_pixels;
+        return {converted.x, converted.y};
+    }
+
+    /**
+     * Convert between pixels and meters.
+     *
+     * @param pixels The value in pixels.
+     * @return The value in meters.
+     */
+    b2Vec2 convert_to_meters(Vector2 pixels) const
+    {
+        const auto converted = pixels * pixels_to_meters;
+        return {converted.x, converted.y};
+    }
+
+    /**
+     * Convert a length from meters to pixels.
+     *
+     * @param meters The length in meters.
+     * @return The length in pixels.
+     */
+    float convert_to_pixels(float meters) const
+    {
+        return meters * meters_to_pixels;
+    }
+
+    /**
+     * Convert a length from pixels to meters.
+     *
+     * @param pixels The length in pixels.
+     * @return The length in meters.
+     */
+    float convert_to_meters(float pixels) const
+    {
+        return pixels * pixels_to_meters;
+    }
+
+    /**
+     * Raycast in pixels.
+     *
+     * @param ignore Box2d body to ignore.
+     * @param from The start point of the ray.
+     * @param to The end point of the ray.
+     * @return A RayHit struct describing the hit.
+     */
+    RayHit raycast(b2BodyId ignore, Vector2 from, Vector2 to)
+    {
+        auto start = convert_to_meters(from);
+        auto translation = convert_to_meters(to - from);
+
+        return raycast_closest(world, ignore, start, translation);
+    }
+
+    /**
+     * Check for circle shape overlaps in pixels.
+     *
+     * @param center The center of the circle.
+     * @param radius The radius of the circle.
+     * @param ignore_body The body to ignore.
+     * @return A vector of body IDs that overlap with the circle.
+     */
+    std::vector<b2BodyId> circle_overlap(Vector2 center, float radius, b2BodyId ignore_body = b2_nullBodyId)
+    {
+        auto center_m = convert_to_meters(center);
+        auto radius_m = convert_to_meters(radius);
+        return circle_hit(world, ignore_body, center_m, radius_m);
+    }
+
+    /**
+     * Check for rectangle shape overlaps in pixels.
+     *
+     * @param rectangle The rectangle to check.
+     * @param rotation The rotation of the rectangle in degrees.
+     * @param ignore_body The body to ignore.
+     * @return A vector of body IDs that overlap with the rectangle.
+     */
+    std::vector<b2BodyId> rectangle_overlap(Rectangle rectangle,
+                                            float rotation = 0.0f,
+                                            b2BodyId ignore_body = b2_nullBodyId)
+    {
+        Vector2 size = {rectangle.width, rectangle.height};
+        Vector2 center = {rectangle.x + size.x / 2.0f, rectangle.y + size.y / 2.0f};
+        auto size_m = convert_to_meters(size);
+        auto center_m = convert_to_meters(center);
+        return rectangle_hit(world, ignore_body, center_m, size_m, rotation);
+    }
+};
+
+/**
+ * Hash for ldtk::IntPoint to be used in unordered_map/set.
+ */
+struct IntPointHash
+{
+    size_t operator()(const ldtk::IntPoint& p) const noexcept
+    {
+        std::size_t h1 = std::hash<int>{}(p.x);
+        std::size_t h2 = std::hash<int>{}(p.y);
+        return h1 ^ (h2 << 1);
+    }
+};
+
+/**
+ * Undirected edge between two IntPoints, stored canonically (a < b).
+ */
+struct Edge
+{
+    ldtk::IntPoint a, b;
+};
+
+/**
+ * Equality operator for Edge.
+ *
+ * @param e1 The first edge.
+ * @param e2 The second edge.
+ * @return True if the edges are equal, false otherwise.
+ */
+static inline bool operator==(const Edge& e1, const Edge& e2)
+{
+    return e1.a == e2.a && e1.b == e2.b;
+}
+
+/**
+ * Hash for Edge to be used in unordered_map/set.
+ */
+struct EdgeHash
+{
+    size_t operator()(const Edge& e) const noexcept
+    {
+        IntPointHash h;
+        std::size_t h1 = h(e.a);
+        std::size_t h2 = h(e.b);
+        return h1 ^ (h2 << 1);
+    }
+};
+
+struct LayerRenderer
+{
+    RenderTexture2D renderer;
+    ldtk::IID layer_iid;
+    bool visible = true;
+};
+
+/**
+ * Check if a cell in a layer is one of the collision values.
+ *
+ * @param layer The LDtk layer.
+ * @param x The x coordinate of the cell.
+ * @param y The y coordinate of the cell.
+ * @param size The size of the layer in cells.
+ * @param collision_names The IntGrid value names that count as solid.
+ * @return True if the cell is solid, false otherwise. Cells outside the layer are not solid.
+ */
+inline bool is_collision_cell(const ldtk::Layer& layer,
+                              int x,
+                              int y,
+                              const ldtk::IntPoint& size,
+                              const std::vector<std::string>& collision_names)
+{
+    if (x < 0 || y < 0 || x >= size.x || y >= size.y)
+    {
+        return false;
+    }
+
+    const std::string& name = layer.getIntGridVal(x, y).name;
+    return std::find(collision_names.begin(), collision_names.end(), name) != collision_names.end();
+}
+
+/**
+ * Check if there is solid on the right side of a loop of corners.
+ * Used to determine loop winding.
+ *
+ * @param loop_corners The corners of the loop in cells.
+ * @param layer The LDtk layer.
+ * @param collision_names The IntGrid value names that count as solid.
+ * @return True if there is solid on the right side of the loop, false otherwise.
+ */
+inline bool collision_loop_has_solid_on_right(const std::vector<ldtk::IntPoint>& loop_corners,
+                                              const ldtk::Layer& layer,
+                                              const std::vector<std::string>& collision_names)
+{
+    // Pick an edge with non-zero length.
+    int n = (int)loop_corners.size();
+    for (int i = 0; i < n; ++i)
+    {
+        ldtk::IntPoint a = loop_corners[i];
+        ldtk::IntPoint b = loop_corners[(i + 1) % n];
+        float ex = (float)(b.x - a.x);
+        float ey = (float)(b.y - a.y);
+        float len = std::sqrt(ex * ex + ey * ey);
+        if (len < 1e-4f)
+        {
+            continue;
+        }
+        ex /= len;
+        ey /= len;
+
+        // Sample a point a quarter cell to the right of the edge midpoint. Right normal = (-ey, ex).
+        float sx = 0.5f * (a.x + b.x) - ey * 0.25f;
+        float sy = 0.5f * (a.y + b.y) + ex * 0.25f;
+
+        return is_collision_cell(
+            layer, (int)std::floor(sx), (int)std::floor(sy), layer.getGridSize(), collision_names);
+    }
+
+    // Fallback: if degenerate, say false
+    return false;
+}
+
+/**
+ * Trace the boundary between solid and empty cells of a layer into closed loops.
+ * Loops are wound so solid is on the right, which is what Box2D chains expect.
+ *
+ * @param layer The LDtk layer.
+ * @param collision_names The IntGrid value names that count as solid.
+ * @return The loops as lists of cell corners.
+ */
+inline std::vector<std::vector<ldtk::IntPoint>> build_collision_loops(const ldtk::Layer& layer,
+                                                                       const std::vector<std::string>& collision_names)
+{
+    const auto& size = layer.getGridSize();
+    auto is_solid = [&](int x, int y) { return is_collision_cell(layer, x, y, size, collision_names); };
+
+    auto make_edge = [&](ldtk::IntPoint p0, ldtk::IntPoint p1) -> Edge
+    {
+        if (p1.x < p0.x || (p1.x == p0.x && p1.y < p0.y))
+            std::swap(p0, p1);
+        return {p0, p1};
+    };
+
+    std::unordered_set<Edge, EdgeHash> edges;
+
+    for (int y = 0; y < size.y; y++)
+    {
+        for (int x = 0; x < size.x; x++)
+        {
+            if (!is_solid(x, y))
+                continue;
+
+            // neighbor empty => boundary edge
+            if (!is_solid(x, y - 1))
+                edges.insert(make_edge({x, y}, {x + 1, y}));
+            if (!is_solid(x, y + 1))
+                edges.insert(make_edge({x, y + 1}, {x + 1, y + 1}));
+            if (!is_solid(x - 1, y))
+                edges.insert(make_edge({x, y}, {x, y + 1}));
+            if (!is_solid(x + 1, y))
+                edges.insert(make_edge({x + 1, y}, {x + 1, y + 1}));
+        }
+    }
+
+    std::unordered_map<ldtk::IntPoint, std::vector<ldtk::IntPoint>, IntPointHash> adj;
+    adj.reserve(edges.size() * 2);
+
+    for (auto& e : edges)
+    {
+        adj[e.a].push_back(e.b);
+        adj[e.b].push_back(e.a);
+    }
+
+    // Helper to remove an undirected edge from the set as we consume it
+    auto erase_edge = [&](ldtk::IntPoint p0, ldtk::IntPoint p1) { edges.erase(make_edge(p0, p1)); };
+
+    // Walk loops
+    std::vector<std::vector<ldtk::IntPoint>> loops;
+
+    while (!edges.empty())
+    {
+        // pick an arbitrary remaining edge
+        Edge startE = *edges.begin();
+        ldtk::IntPoint start = startE.a;
+        ldtk::IntPoint cur = startE.b;
+        ldtk::IntPoint prev = start;
+
+        std::vector<ldtk::IntPoint> poly;
+        poly.push_back(start);
+        poly.push_back(cur);
+        erase_edge(start, cur);
+
+        while (!(cur == start))
+        {
+            // choose next neighbor that is not prev and still has an edge remaining
+            const auto& nbs = adj[cur];
+            ldtk::IntPoint next = prev; // fallback
+
+            bool found = false;
+            for (const ldtk::IntPoint& cand : nbs)
+            {
+                if (cand == prev)
+                    continue;
+                if (edges.find(make_edge(cur, cand)) != edges.end())
+                {
+                    next = cand;
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found)
+            {
+                // Open chain (should be rare for tile boundaries unless the boundary touches the map edge)
+                break;
+            }
+
+            prev = cur;
+            cur = next;
+            poly.push_back(cur);
+            erase_edge(prev, cur);
+
+            // safety guard to avoid infinite loops on bad topology
+            if (poly.size() > 100000)
+                break;
+        }
+
+        // If closed, last vertex == start; Box2D chains usually want NOT duplicated end vertex.
+        if (!poly.empty() && poly.back() == poly.front())
+        {
+            poly.pop_back();
+        }
+
+        // Only keep valid chains
+        if (poly.size() >= 3)
+        {
+            // If we're not solid on the right, then we wrapped the wrong way.
+            if (!collision_loop_has_solid_on_right(poly, layer, collision_names))
+            {
+                std::reverse(poly.begin(), poly.end());
+            }
+
+            loops.push_back(std::move(poly));
+        }
+    }
+
+    return loops;
+}
+
+/**
+ * Create a static body with one chain shape per collision loop.
+ *
+ * @param physics The physics service to create the body in.
+ * @param loops The collision loops in cells.
+ * @param cell_size The size of a cell in pixels, including any level scale.
+ * @param offset The pixel offset added to every vertex, e.g. the level's position in the world.
+ * @return The created body.
+ */
+inline b2BodyId create_collision_body(PhysicsService* physics,
+                                      const std::vector<std::vector<ldtk::IntPoint>>& loops,
+                                      float cell_size,
+                                      Vector2 offset)
+{
+    b2BodyDef bd = b2DefaultBodyDef();
+    bd.type = b2_staticBody;
+    bd.position = {0, 0};
+    assert(b2World_IsValid(physics->world));
+    b2BodyId body = b2CreateBody(physics->world, &bd);
+
+    std::vector<b2Vec2> verts;
+    std::vector<b2SurfaceMaterial> mats;
+    for (auto& loop : loops)
+    {
+        verts.clear();
+        verts.reserve(loop.size());
+        for (auto& p : loop)
+        {
+            verts.push_back(physics->convert_to_meters({offset.x + p.x * cell_size, offset.y + p.y * cell_size}));
+        }
+
+        b2SurfaceMaterial mat = b2DefaultSurfaceMaterial();
+        mat.friction = 0.1f;
+        mat.restitution = 0.1f;
+        mats.assign(verts.size(), mat);
+
+        b2ChainDef cd = b2DefaultChainDef();
+        cd.points = verts.data();
+        cd.count = (int)verts.size();
+        cd.materials = mats.data();
+        cd.materialCount = (int)mats.size();
+        cd.isLoop = true;
+        b2CreateChain(body, &cd);
+    }
+    return body;
+}
+
+/**
+ * Draw every tile of a layer.
+ * Call between BeginTextureMode() and EndTextureMode() to bake the layer into a texture.
+ *
+ * @param layer The LDtk layer.
+ * @param texture The layer's tileset texture.
+ */
+inline void draw_layer_tiles(const ldtk::Layer& layer, Texture2D texture)
+{
+    for (const auto& tile : layer.allTiles())
+    {
+        const auto& position = tile.getPosition();
+        const auto& texture_rect = tile.getTextureRect();
+        Vector2 dest = {
+            static_cast<float>(position.x),
+            static_cast<float>(position.y),
+        };
+        Rectangle src = {static_cast<float>(texture_rect.x),
+                         static_cast<float>(texture_rect.y),
+                         static_cast<float>(texture_rect.width) * (tile.flipX ? -1.0f : 1.0f),
+                         static_cast<float>(texture_rect.height) * (tile.flipY ? -1.0f : 1.0f)};
+        DrawTextureRec(texture, src, dest, WHITE);
+    }
+}
+
+/**
+ * Service for managing LDtk levels.
+ * Depends on TextureService and PhysicsService.
+ */
+class LevelService : public Service
+{
+public:
+    ldtk::Project project;
+    std::string project_file;
+    std::string level_name;
+    std::vector<std::string> collision_names;
+    std::vector<LayerRenderer> renderers;
+    std::vector<b2BodyId> layer_bodies;
+    float scale = 1.0f;
+    PhysicsService* physics;
+
+    // The level resolved once at init.
+    const ldtk::Level* current_level = nullptr;
+
+    // Entity indexes built once at init, in layer order.
+    std::vector<const ldtk::Entity*> all_entities;
+    std::unordered_map<std::string, std::vector<const ldtk::Entity*>> entities_by_name;
+    std::unordered_map<std::string, std::vector<const ldtk::Entity*>> entities_by_tag;
+
+    // Solid cells of the collision layers in scaled pixels, for queries that don't need Box2D.
+    TileGrid grid;
+
+    // Outlines of the collision layers in scaled pixels, the same loops used for the Box2D chains.
+    std::vector<std::vector<Vector2>> collision_loops;
+
+    /**
+     * Constructor for LevelService.
+     *
+     * @param project_file The path to the LDtk project file.
+     * @param level_name The name of the level to load.
+     * @param collision_names The names of the layers to create collision bodies for.
+     * @param scale The scale factor for the level.
+     */
+    LevelService(std::string project_file,
+                 std::string level_name,
+                 std::vector<std::string> collision_names,
+                 float scale = 1.0f) :
+        project_file(project_file),
+        level_name(level_name),
+        collision_names(collision_names),
+        scale(scale)
+    {
+    }
+
+    virtual ~LevelService()
+    {
+        for (auto& renderer : renderers)
+        {
+            UnloadRenderTexture(renderer.renderer);
+        }
+
+        for (auto& body : layer_bodies)
+        {
+            if (b2Body_IsValid(body))
+            {
+                b2DestroyBody(body);
+            }
+        }
+    }
+
+    /**
+     * Initialize the level service.
+     * Loads the LDtk project and level, creates textures and collision bodies.
+     */
+    void init() override
+    {
+        if (!FileExists(project_file.c_str()))
+        {
+            TraceLog(LOG_FATAL, "LDtk file not found: %s", project_file.c_str());
+        }
+        project.loadFromFile(project_file);
+        const auto& world = project.getWorld();
+        const auto& levels = world.allLevels();
+
+        current_level = nullptr;
+        for (const auto& level : levels)
+        {
+            if (level.name == level_name)
+            {
+                current_level = &level;
+                break;
+            }
+        }
+        if (!current_level)
+        {
+            TraceLog(LOG_FATAL, "LDtk level not found: %s", level_name.c_str());
+        }
+
+        physics = scene->get_service<PhysicsService>();
+
+        const auto& level = *current_level;
+        const auto& layers = level.allLayers();
+        build_entity_indexes();
+
+        // Loop through all layers and create textures and collisions bodies.
+        for (auto& layer : layers)
+        {
+            if (!layer.hasTileset())
+            {
+                continue;
+            }
+
+            // Load the texture and the renderer.
+            auto directory = std::string(GetDirectoryPath(project_file.c_str()));
+            auto tileset_file = directory + "/" + layer.getTileset().path;
+            if (!FileExists(tileset_file.c_str()))
+            {
+                TraceLog(LOG_FATAL, "Tileset file not found: %s", tileset_file.c_str());
+            }
+            auto texture_service = scene->get_service<TextureService>();
+            Texture2D texture = texture_service->get_texture(tileset_file);
+            RenderTexture2D renderer = LoadRenderTexture(level.size.x, level.size.y);
+
+            // Draw all the tiles.
+            BeginTextureMode(renderer);
+            // Clear with transparency so we can render layers on top of each other.
+            ClearBackground({0, 0, 0, 0});
+            draw_layer_tiles(layer, texture);
+            EndTextureMode();
+            LayerRenderer layer_renderer;
+            layer_renderer.renderer = renderer;
+            layer_renderer.layer_iid = layer.iid;
+            renderers.push_back(layer_renderer);
+
+            // Create bodies.
+            auto loops = build_collision_loops(layer, collision_names);
+            float cell_size = layer.getCellSize() * scale;
+            layer_bodies.push_back(create_collision_body(physics, loops, cell_size, Vector2{0.0f, 0.0f}));
+            for (const auto& loop : loops)
+            {
+                std::vector<Vector2> points;
+                points.reserve(loop.size());
+                for (const auto& point : loop)
+                {
+                    points.push_back({point.x * cell_size, point.y * cell_size});
+                }
+                collision_loops.push_back(std::move(points));
+            }
+
+            add_layer_to_grid(layer);
+        }
+    }
+
+    /**
+     * Draw the level.
+     * Draws all the layer renderers.
+     */
+    void draw() override
+    {
+        // Draw renderers in reverse.
+        for (int i = (int)renderers.size() - 1; i >= 0; i--)
+        {
+            const auto& layer_renderer = renderers[i];
+            if (!layer_renderer.visible)
+            {
+                continue;
+            }
+            const auto& renderer = layer_renderer.renderer;
+            Rectangle src = {0,
+                             0,
+                             static_cast<float>(renderer.texture.width),
+                             -static_cast<float>(renderer.texture.height)};
+            Rectangle dest = {0,
+                              0,
+                              static_cast<float>(renderer.texture.width) * scale,
+                              static_cast<float>(renderer.texture.height) * scale};
+            DrawTexturePro(renderer.texture, src, dest, {0}, .0f, WHITE);
+        }
+    }
+
+    /**
+     * Draw a specific layer by its IID.
+     *
+     * @param layer_id The IID of the layer.
+     */
+    void draw_layer(ldtk::IID layer_id)
+    {
+        for (const auto& layer_renderer : renderers)
+        {
+            if (layer_renderer.layer_iid == layer_id)
+            {
+                const auto& renderer = layer_renderer.renderer;
+                Rectangle src = {0,
+                                 0,
+                                 static_cast<float>(renderer.texture.width),
+                                 -static_cast<float>(renderer.texture.height)};
+                Rectangle dest = {0,
+                                  0,
+                                  static_cast<float>(renderer.texture.width) * scale,
+                                  static_cast<float>(renderer.texture.height) * scale};
+                DrawTexturePro(renderer.texture, src, dest, {0}, .0f, WHITE);
+                return;
+            }
+        }
+    }
+
+    /**
+     * Draw a specific layer by its name.
+     *
+     * @param layer_name The name of the layer.
+     */
+    void draw_layer(std::string layer_name)
+    {
+        const auto& level = get_level();
+        const auto& layer = level.getLayer(layer_name);
+        draw_layer(layer.iid);
+    }
+
+    /**
+     * Check if a cell in the layer is solid.
+     * Used for collision generation.
+     *
+     * @param layer The LDtk layer.
+     * @param x The x coordinate of the cell.
+     * @param y The y coordinate of the cell.
+     * @param size The size of the layer in cells.
+     */
+    bool is_solid(const ldtk::Layer& layer, int x, int y, const ldtk::IntPoint& size)
+    {
+        return is_collision_cell(layer, x, y, size, collision_names);
+    };
+
+    /**
+     * Check if there is solid on the right side of a loop of corners.
+     * Used to determine loop winding.
+     *
+     * @param loop_corners The corners of the loop.
+     * @param layer The LDtk layer.
+     * @return True if there is solid on the right side of the loop, false otherwise.
+     */
+    bool loop_has_solid_on_right(const std::vector<ldtk::IntPoint>& loop_corners, const ldtk::Layer& layer)
+    {
+        return collision_loop_has_solid_on_right(loop_corners, layer, collision_names);
+    }
+
+    /**
+     * Mark a layer's solid cells in the tile grid.
+     * The grid uses the cell size of the first layer added. Layers with a different cell size are skipped.
+     * For internal use only.
+     *
+     * @param layer The LDtk layer.
+     */
+    void add_layer_to_grid(const ldtk::Layer& layer)
+    {
+        const auto& size = layer.getGridSize();
+        float cell_size = layer.getCellSize() * scale;
+        if (grid.cells.empty())
+        {
+            grid.resize(size.x, size.y, cell_size);
+        }
+        else if (grid.cell_size != cell_size || grid.width != size.x || grid.height != size.y)
+        {
+            TraceLog(LOG_WARNING, "Layer %s does not match the tile grid size, skipping.", layer.getName().c_str());
+            return;
+        }
+
+        for (int y = 0; y < size.y; y++)
+        {
+            for (int x = 0; x < size.x; x++)
+            {
+                if (is_collision_cell(layer, x, y, size, collision_names))
+                {
+                    grid.set_solid(x, y, true);
+                }
+            }
+        }
+    }
+
+    /**
+     * Check if a point is inside a solid cell of the collision layers.
+     *
+     * @param pixels The point in pixels.
+     * @return True if the point is solid, false otherwise.
+     */
+    bool is_solid_at(Vector2 pixels) const
+    {
+        return grid.is_solid_at(pixels);
+    }
+
+    /**
+     * Check if a rectangle overlaps any solid cell of the collision layers.
+     *
+     * @param rect The rectangle in pixels.
+     * @return True if the rectangle overlaps a solid cell, false otherwise.
+     */
+    bool overlaps_solid(Rectangle rect) const
+    {
+        return grid.overlaps(rect);
+    }
+
+    /**
+     * Cast a ray against the solid cells of the collision layers.
+     * Much cheaper than a physics raycast, but only sees the level, not other bodies.
+     *
+     * @param origin The starting point of the ray in pixels.
+     * @param translation The direction and length of the ray in pixels.
+     * @return Information about the hit.
+     */
+    TileHit raycast_grid(Vector2 origin, Vector2 translation) const
+    {
+        return grid.raycast(origin, translation);
+    }
+
+    /**
+     * Set the visibility of a layer by its IID.
+     *
+     * @param layer_id The IID of the layer.
+     * @param visible True to make the layer visible, false to hide it.
+     */
+    void set_layer_visibility(ldtk::IID layer_id, bool visible)
+    {
+        for (auto& layer_renderer : renderers)
+        {
+            if (layer_renderer.layer_iid == layer_id)
+            {
+                layer_renderer.visible = visible;
+                return;
+            }
+        }
+    }
+
+    /**
+     * Set the visibility of a layer by its name.
+     *
+     * @param layer_name The name of the layer.
+     * @param visible True to make the layer visible, false to hide it.
+     */
+    void set_layer_visibility(std::string layer_name, bool visible)
+    {
+        const auto& level = get_level();
+        const auto& layer = level.getLayer(layer_name);
+        for (auto& layer_renderer : renderers)
+        {
+            if (layer_renderer.layer_iid == layer.iid)
+            {
+                layer_renderer.visible = visible;
+                return;
+            }
+        }
+    }
+
+    /**
+     * Get the LDtk world.
+     *
+     * @return A reference to the LDtk world.
+     */
+    const ldtk::World& get_world()
+    {
+        return project.getWorld();
+    }
+
+    /**
+     * Get the LDtk level.
+     *
+     * @return A reference to the LDtk level.
+     */
+    const ldtk::Level& get_level()
+    {
+        if (!current_level)
+        {
+            // Not initialized yet, resolve by name.
+            return project.getWorld().getLevel(level_name);
+        }
+        return *current_level;
+    }
+
+    /**
+     * Get the level size in pixels.
+     *
+     * @return A Vector2 containing the size of the level.
+     */
+    Vector2 get_size()
+    {
+        const auto& level = get_level();
+        return {level.size.x * scale, level.size.y * scale};
+    }
+
+    /**
+     * Get a layer by its name.
+     *
+     * @param name The name of the layer.
+     * @return A reference to the LDtk layer.
+     */
+    const ldtk::Layer& get_layer_by_name(const std::string& name)
+    {
+        const auto& level = get_level();
+        return level.getLayer(name);
+    }
+
+    /**
+     * Get all entities across all layers in the level.
+     *
+     * @return A vector of LDtk entities, valid until the service is destroyed.
+     */
+    const std::vector<const ldtk::Entity*>& get_entities()
+    {
+        if (!is_init)
+        {
+            TraceLog(LOG_ERROR, "LDtk project not loaded.");
+        }
+        return all_entities;
+    }
+
+    /**
+     * Get all entities across all layers in the level with the given name.
+     *
+     * @param name The name of the entities to get.
+     * @return A vector of LDtk entities, valid until the service is destroyed.
+     */
+    const std::vector<const ldtk::Entity*>& get_entities_by_name(const std::string& name)
+    {
+        if (!is_init)
+        {
+            TraceLog(LOG_ERROR, "LDtk project not loaded.");
+        }
+        return find_entities(entities_by_name, name);
+    }
+
+    /**
+     * Get all entities across all layers in the level with the given tag.
+     *
+     * @param tag The tag of the entities to get.
+     * @return A vector of LDtk entities, valid until the service is destroyed.
+     */
+    const std::vector<const ldtk::Entity*>& get_entities_by_tag(const std::string& tag)
+    {
+        if (!is_init)
+        {
+            TraceLog(LOG_ERROR, "LDtk project not loaded.");
+        }
+        return find_entities(entities_by_tag, tag);
+    }
+
+    /**
+     * Get the first entity across all layers in the level with the given name.
+     *
+     * @param name The name of the entity to get.
+     * @return A pointer to the LDtk entity, or nullptr if not found.
+     */
+    const ldtk::Entity* get_entity_by_name(const std::string& name)
+    {
+        const auto& entities = get_entities_by_name(name);
+        if (entities.empty())
+        {
+            return nullptr;
+        }
+
+        return entities[0];
+    }
+
+    /**
+     * Get the first entity across all layers in the level with the given tag.
+     *
+     * @param tag The tag of the entity to get.
+     * @return A pointer to the LDtk entity, or nullptr if not found.
+     */
+    const ldtk::Entity* get_entity_by_tag(const std::string& tag)
+    {
+        const auto& entities = get_entities_by_tag(tag);
+        if (entities.empty())
+        {
+            return nullptr;
+        }
+
+        return entities[0];
+    }
+
+    /**
+     * Build the entity indexes for the current level.
+     * For internal use only.
+     */
+    void build_entity_indexes()
+    {
+        all_entities.clear();
+        entities_by_name.clear();
+        entities_by_tag.clear();
+
+        for (const auto& layer : current_level->allLayers())
+        {
+            const auto& layer_entities = layer.allEntities();
+            all_entities.reserve(all_entities.size() + layer_entities.size());
+            for (const auto& entity : layer_entities)
+            {
+                all_entities.push_back(&entity);
+                entities_by_name[entity.getName()].push_back(&entity);
+                for (const auto& tag : entity.allTags())
+                {
+                    entities_by_tag[tag].push_back(&entity);
+                }
+            }
+        }
+    }
+
+    /**
+     * Look up an entity index, returning an empty vector when the key is missing.
+     * For internal use only.
+     *
+     * @param index The index to search.
+     * @param key The name or tag to find.
+     * @return A vector of LDtk entities.
+     */
+    static const std::vector<const ldtk::Entity*>& find_entities(
+        const std::unordered_map<std::string, std::vector<const ldtk::Entity*>>& index, const std::string& key)
+    {
+        static const std::vector<const ldtk::Entity*> empty;
+        auto it = index.find(key);
+        if (it == index.end())
+        {
+            return empty;
+        }
+        return it->second;
+    }
+
+    /**
+     * Convert a grid point to pixels.
+     *
+     * @param point The grid point to convert.
+     * @return A Vector2 containing the point in pixels.
+     */
+    Vector2 convert_to_pixels(const ldtk::IntPoint& point) const
+    {
+        return {point.x * scale, point.y * scale};
+    }
+
+    /**
+     * Convert a cell point to pixels.
+     *
+     * @param cell_point The cell point to convert.
+     * @param layer The LDtk layer the cell point is in.
+     */
+    Vector2 convert_cells_to_pixels(const ldtk::IntPoint& cell_point, const ldtk::Layer& layer) const
+    {
+        float cell_size = static_cast<float>(layer.getCellSize());
+        return {cell_point.x * cell_size * scale, cell_point.y * cell_size * scale};
+    }
+
+    /**
+     * Get a path from an entity's position and a Point array field, for use with PathFollowComponent.
+     * None of the sample levels have a Point array field yet, so this hasn't been used by a sample.
+     *
+     * @param entity The entity with the field.
+     * @param field_name The name of the Point array field.
+     * @param layer The LDtk layer the entity is in, since Point fields are in its cells.
+     * @return The entity's position followed by the points of the field, in pixels. Empty points are skipped.
+     */
+    std::vector<Vector2> get_entity_path(const ldtk::Entity& entity,
+                                         const std::string& field_name,
+                                         const ldtk::Layer& layer) const
+    {
+        std::vector<Vector2> path = {convert_to_pixels(entity.getPosition())};
+        for (const auto& point : entity.getArrayField<ldtk::IntPoint>(field_name))
+        {
+            if (!point.is_null())
+            {
+                path.push_back(convert_cells_to_pixels(point.value(), layer));
+            }
+        }
+        return path;
+    }
+
+    /**
+     * Convert a grid point to meters.
+     *
+     * @param point The grid point to convert.
+     * @return A b2Vec2 containing the point in meters.
+     */
+    b2Vec2 convert_to_meters(const ldtk::IntPoint& point) const
+    {
+        return physics->convert_to_meters(convert_to_pixels(point));
+    }
+
+    /**
+     * Convert pixels to a grid point.
+     *
+     * @param pixels The pixel position to convert.
+     * @return An IntPoint containing the point in grid coordinates.
+     */
+    ldtk::IntPoint convert_to_grid(const Vector2& pixels) const
+    {
+        return {static_cast<int>(pixels.x / scale), static_cast<int>(pixels.y / scale)};
+    }
+
+    /**
+     * Convert meters to a grid point.
+     *
+     * @param meters The meter position to convert.
+     * @return An IntPoint containing the point in grid coordinates.
+     */
+    ldtk::IntPoint convert_to_grid(const b2Vec2& meters) const
+    {
+        auto pixels = physics->convert_to_pixels(meters);
+        return {static_cast<int>(pixels.x / scale), static_cast<int>(pixels.y / scale)};
+    }
+
+    /**
+     * Get the position of an entity in pixels.
+     *
+     * @param entity The entity to get the position of.
+     * @return A Vector2 containing the position of the entity in pixels.
+     */
+    Vector2 get_entity_position(ldtk::Entity* entity)
+    {
+        return convert_to_pixels(entity->getPosition());
+    }
+
+    /**
+     * Get the size of an entity in pixels.
+     *
+     * @param entity The entity to get the size of.
+     * @return A Vector2 containing the size of the entity in pixels.
+     */
+    Vector2 get_entity_size(ldtk::Entity* entity)
+    {
+        return convert_to_pixels(entity->getSize());
+    }
+};
+
+/**
+ * Storage for the actors simulated by TilePhysicsService.
+ * Kept as separate arrays so the update loop only touches the data it needs.
+ */
+struct TileActors
+{
+    SlotAllocator slots;
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> velocity_x;
+    std::vector<float> velocity_y;
+    std::vector<float> half_width;
+    std::vector<float> half_height;
+    std::vector<uint8_t> flags;
+    std::vector<GameObject*> owners;
+
+    static constexpr uint8_t active = 1 << 0;
+    static constexpr uint8_t enabled = 1 << 1;
+    static constexpr uint8_t grounded = 1 << 2;
+    static constexpr uint8_t on_wall_left = 1 << 3;
+    static constexpr uint8_t on_wall_right = 1 << 4;
+    static constexpr uint8_t on_ceiling = 1 << 5;
+
+    /**
+     * Add an actor, reusing a free slot if there is one.
+     *
+     * @param position The center of the actor in pixels.
+     * @param size The size of the actor in pixels.
+     * @param owner The game object that owns the actor.
+     * @return The index of the actor.
+     */
+    int add(Vector2 position, Vector2 size, GameObject* owner)
+    {
+        int index = slots.acquire();
+        if (index == (int)x.size())
+        {
+            x.push_back(0);
+            y.push_back(0);
+            velocity_x.push_back(0);
+            velocity_y.push_back(0);
+            half_width.push_back(0);
+            half_height.push_back(0);
+            flags.push_back(0);
+            owners.push_back(nullptr);
+        }
+        x[index] = position.x;
+        y[index] = position.y;
+        velocity_x[index] = 0.0f;
+        velocity_y[index] = 0.0f;
+        half_width[index] = size.x / 2.0f;
+        half_height[index] = size.y / 2.0f;
+        flags[index] = active | enabled;
+        owners[index] = owner;
+        return index;
+    }
+
+    /**
+     * Remove an actor and free its slot.
+     *
+     * @param index The index of the actor.
+     */
+    void remove(int index)
+    {
+        if (index < 0 || index >= (int)flags.size() || !(flags[index] & active))
+        {
+            return;
+        }
+        flags[index] = 0;
+        owners[index] = nullptr;
+        slots.release(index);
+    }
+};
+
+/**
+ * Service for simple kinematic physics against the level's tile grid.
+ * Actors are axis-aligned boxes moved one axis at a time and stopped at solid cells, which is all most platformer
+ * characters need and much cheaper than a Box2D body. Actors don't collide with each other.
+ * Use TileBodyComponent to add an actor to a game object.
+ * Depends on LevelService.
+ */
+class TilePhysicsService : public Service
+{
+public:
+    std::shared_ptr<TileActors> actors = std::make_shared<TileActors>();
+    const TileGrid* grid = nullptr;
+    float time_step = 1.0f / 60.0f;
+    float meters_to_pixels = 30.0f;
+    float pixels_to_meters = 1.0f / meters_to_pixels;
+
+    // How far from a solid cell an actor still counts as touching it, in pixels.
+    float probe_distance = 4.0f;
+
+    /**
+     * Constructor for TilePhysicsService.
+     *
+     * @param time_step The time step for each update, matching PhysicsService.
+     * @param meters_to_pixels The scale factor from meters to pixels, for the BodyComponent meter functions.
+     */
+    TilePhysicsService(float time_step = 1.0f / 60.0f, float meters_to_pixels = 30.0f) :
+        time_step(time_step),
+        meters_to_pixels(meters_to_pixels),
+        pixels_to_meters(1.0f / meters_to_pixels)
+    {
+    }
+
+    void init() override
+    {
+        grid = &scene->get_service<LevelService>()->grid;
+    }
+
+    /**
+     * Move every actor by its velocity, stopping at solid cells, then update its contact flags.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        auto& a = *actors;
+        const int count = (int)a.flags.size();
+        const uint8_t movable = TileActors::active | TileActors::enabled;
+        for (int i = 0; i < count; i++)
+        {
+            if ((a.flags[i] & movable) != movable)
+            {
+                continue;
+            }
+
+            const float width = a.half_width[i] * 2.0f;
+            const float height = a.half_height[i] * 2.0f;
+            Rectangle rect = {a.x[i] - a.half_width[i], a.y[i] - a.half_height[i], width, height};
+            uint8_t flags = movable;
+
+            // Move along x first so characters slide along floors and walls.
+            float dx = a.velocity_x[i] * time_step;
+            float moved_x = grid->sweep_x(rect, dx);
+            if (moved_x != dx)
+            {
+                a.velocity_x[i] = 0.0f;
+            }
+            rect.x += moved_x;
+
+            float dy = a.velocity_y[i] * time_step;
+            float moved_y = grid->sweep_y(rect, dy);
+            if (moved_y != dy)
+            {
+                a.velocity_y[i] = 0.0f;
+            }
+            rect.y += moved_y;
+
+            if (grid->overlaps({rect.x, rect.y + height, width, probe_distance}))
+            {
+                flags |= TileActors::grounded;
+            }
+            if (grid->overlaps({rect.x, rect.y - probe_distance, width, probe_distance}))
+            {
+                flags |= TileActors::on_ceiling;
+            }
+            if (grid->overlaps({rect.x - probe_distance, rect.y, probe_distance, height}))
+            {
+                flags |= TileActors::on_wall_left;
+            }
+            if (grid->overlaps({rect.x + width, rect.y, probe_distance, height}))
+            {
+                flags |= TileActors::on_wall_right;
+            }
+
+            a.x[i] = rect.x + a.half_width[i];
+            a.y[i] = rect.y + a.half_height[i];
+            a.flags[i] = flags;
+        }
+    }
+
+    /**
+     * Convert between pixels and meters.
+     *
+     * @param meters The value in meters.
+     * @return The value in pixels.
+     */
+    Vector2 convert_to_pixels(b2Vec2 meters) const
+    {
+        return {meters.x * meters_to_pixels, meters.y * meters_to_pixels};
+    }
+
+    /**
+     * Convert between pixels and meters.
+     *
+     * @param pixels The value in pixels.
+     * @return The value in meters.
+     */
+    b2Vec2 convert_to_meters(Vector2 pixels) const
+    {
+        return {pixels.x * pixels_to_meters, pixels.y * pixels_to_meters};
+    }
+};
+
+/**
+ * A projectile hitting something, reported by ProjectileService.
+ */
+struct ProjectileHit
+{
+    Vector2 point = {0, 0};
+    Vector2 normal = {0, 0};
+    Vector2 velocity = {0, 0};
+
+    // The body that was hit, or b2_nullBodyId when the projectile hit the level's tile grid.
+    b2BodyId body = b2_nullBodyId;
+
+    // The user data of the body that was hit, if it is a game object.
+    // Hits delivered through EventService arrive a frame later, when the body and object may be gone. Only use these
+    // from on_hit, or check them against objects you know are still alive.
+    GameObject* object = nullptr;
+
+    // The game object that fired the projectile. Same caveat as object.
+    GameObject* owner = nullptr;
+};
+
+/**
+ * Service for large numbers of simple projectiles.
+ * Projectiles are points or circles stored in flat arrays rather than game objects with Box2D bodies. Each frame
+ * they are moved together, then swept against the level's tile grid and the Box2D world to find what they hit.
+ * A projectile is removed when it hits something or its lifetime runs out.
+ * All projectiles share one texture and are drawn in a single batch.
+ * Hits are published as ProjectileHit events when the scene has an EventService.
+ * Depends on TextureService, and PhysicsService or LevelService depending on what projectiles collide with.
+ */
+class ProjectileService : public Service
+{
+public:
+    std::string texture_file;
+    Texture2D texture;
+    bool collide_with_tiles = true;
+    bool collide_with_bodies = true;
+    PhysicsService* physics = nullptr;
+    const TileGrid* grid = nullptr;
+    EventService* events = nullptr;
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> velocity_x;
+    std::vector<float> velocity_y;
+    std::vector<float> life;
+    std::vector<float> radius;
+    std::vector<b2BodyId> ignore_bodies;
+    std::vector<GameObject*> owners;
+    std::vector<uint8_t> dead;
+
+    // Hits from the most recent update.
+    std::vector<ProjectileHit> hits;
+
+    // Called for every hit during update.
+    std::function<void(const ProjectileHit& hit)> on_hit;
+
+    /**
+     * Constructor for ProjectileService.
+     *
+     * @param texture_file The texture to draw every projectile with. It is rotated so its top points forward.
+     * @param collide_with_tiles True to stop projectiles at solid cells of the LevelService tile grid.
+     * @param collide_with_bodies True to stop projectiles at Box2D bodies. Static bodies are skipped when colliding
+     * with tiles, since those are the level walls.
+     */
+    ProjectileService(std::string texture_file, bool collide_with_tiles = true, bool collide_with_bodies = true) :
+        texture_file(texture_file),
+        collide_with_tiles(collide_with_tiles),
+        collide_with_bodies(collide_with_bodies)
+    {
+    }
+
+    void init() override
+    {
+        texture = scene->get_service<TextureService>()->get_texture(texture_file);
+        if (collide_with_bodies)
+        {
+            physics = scene->get_service<PhysicsService>();
+        }
+        if (collide_with_tiles)
+        {
+            grid = &scene->get_service<LevelService>()->grid;
+        }
+        if (scene->has_service<EventService>())
+        {
+            events = scene->get_service<EventService>();
+        }
+    }
+
+    /**
+     * Fire a projectile.
+     *
+     * @param position The starting position in pixels.
+     * @param velocity The velocity in pixels per second.
+     * @param radius The collision radius in pixels. Zero for a point.
+     * @param lifetime The number of seconds before the projectile is removed.
+     * @param ignore_body A body the projectile passes through, usually the shooter's.
+     * @param owner The game object that fired the projectile, reported in hits.
+     */
+    void spawn(Vector2 position,
+               Vector2 velocity,
+               float radius = 0.0f,
+               float lifetime = 5.0f,
+               b2BodyId ignore_body = b2_nullBodyId,
+               GameObject* owner = nullptr)
+    {
+        x.push_back(position.x);
+        y.push_back(position.y);
+        velocity_x.push_back(velocity.x);
+        velocity_y.push_back(velocity.y);
+        life.push_back(lifetime);
+        this->radius.push_back(radius);
+        ignore_bodies.push_back(ignore_body);
+        owners.push_back(owner);
+    }
+
+    /**
+     * Get the number of live projectiles.
+     *
+     * @return The number of projectiles.
+     */
+    int get_count() const
+    {
+        return (int)x.size();
+    }
+
+    /**
+     * Remove every projectile.
+     */
+    void clear()
+    {
+        x.clear();
+        y.clear();
+        velocity_x.clear();
+        velocity_y.clear();
+        life.clear();
+        radius.clear();
+        ignore_bodies.clear();
+        owners.clear();
+    }
+
+    /**
+     * Move all projectiles and resolve their hits.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        hits.clear();
+        int count = get_count();
+        if (count == 0)
+        {
+            return;
+        }
+
+        simd_add(life.data(), -delta_time, count);
+
+        // Sweep each projectile along this frame's movement before moving it.
+        dead.assign(count, 0);
+        for (int i = 0; i < count; i++)
+        {
+            if (life[i] <= 0.0f)
+            {
+                dead[i] = 1;
+                continue;
+            }
+
+            Vector2 start = {x[i], y[i]};
+            Vector2 translation = {velocity_x[i] * delta_time, velocity_y[i] * delta_time};
+            float closest = 2.0f;
+            ProjectileHit hit;
+
+            if (grid)
+            {
+                TileHit tile_hit = grid->raycast(start, translation);
+                if (tile_hit.hit)
+                {
+                    closest = tile_hit.fraction;
+                    hit.point = tile_hit.point;
+                    hit.normal = tile_hit.normal;
+                }
+            }
+
+            if (physics)
+            {
+                b2Vec2 origin = physics->convert_to_meters(start);
+                b2Vec2 cast = physics->convert_to_meters(translation);
+                RayHit body_hit;
+                if (radius[i] > 0.0f)
+                {
+                    body_hit = circle_cast_closest(physics->world,
+                                                   ignore_bodies[i],
+                                                   origin,
+                                                   physics->convert_to_meters(radius[i]),
+                                                   cast,
+                                                   grid != nullptr);
+                }
+                else
+                {
+                    RayContextClosest ctx;
+                    ctx.ignore_body = ignore_bodies[i];
+                    ctx.translation = cast;
+                    ctx.ignore_static = grid != nullptr;
+                    b2World_CastRay(
+                        physics->world, origin, cast, b2DefaultQueryFilter(), raycast_closest_callback, &ctx);
+                    body_hit = ctx.closest;
+                }
+
+                if (body_hit.hit && body_hit.fraction < closest)
+                {
+                    closest = body_hit.fraction;
+                    hit.point = physics->convert_to_pixels(body_hit.point);
+                    hit.normal = {body_hit.normal.x, body_hit.normal.y};
+                    hit.body = body_hit.body;
+                    hit.object = static_cast<GameObject*>(b2Body_GetUserData(body_hit.body));
+                }
+            }
+
+            if (closest <= 1.0f)
+            {
+                hit.velocity = {velocity_x[i], velocity_y[i]};
+                hit.owner = owners[i];
+                hits.push_back(hit);
+                dead[i] = 1;
+            }
+        }
+
+        simd_integrate(x.data(), y.data(), velocity_x.data(), velocity_y.data(), delta_time, count);
+
+        // Remove dead projectiles by swapping in the last one, keeping the arrays packed.
+        for (int i = count - 1; i >= 0; i--)
+        {
+            if (dead[i])
+            {
+                remove(i);
+            }
+        }
+
+        if (on_hit)
+        {
+            for (const auto& hit : hits)
+            {
+                on_hit(hit);
+            }
+        }
+        if (events)
+        {
+            auto queue = events->get_queue<ProjectileHit>();
+            queue->pending.insert(queue->pending.end(), hits.begin(), hits.end());
+        }
+    }
+
+    /**
+     * Draw all projectiles in one batch.
+     */
+    void draw() override
+    {
+        int count = get_count();
+        if (count == 0)
+        {
+            return;
+        }
+
+        const float half_width = texture.width / 2.0f;
+        const float half_height = texture.height / 2.0f;
+        rlSetTexture(texture.id);
+        rlBegin(RL_QUADS);
+        rlColor4ub(255, 255, 255, 255);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+        for (int i = 0; i < count; i++)
+        {
+            // Forward is the direction of travel, which the top of the texture faces.
+            float speed = std::sqrt(velocity_x[i] * velocity_x[i] + velocity_y[i] * velocity_y[i]);
+            Vector2 forward = speed > 0.0f ? Vector2{velocity_x[i] / speed, velocity_y[i] / speed} : Vector2{0, -1};
+            Vector2 right = {-forward.y * half_width, forward.x * half_width};
+            Vector2 up = {forward.x * half_height, forward.y * half_height};
+
+            rlCheckRenderBatchLimit(4);
+            rlTexCoord2f(0.0f, 0.0f);
+            rlVertex2f(x[i] - right.x + up.x, y[i] - right.y + up.y);
+            rlTexCoord2f(0.0f, 1.0f);
+            rlVertex2f(x[i] - right.x - up.x, y[i] - right.y - up.y);
+            rlTexCoord2f(1.0f, 1.0f);
+            rlVertex2f(x[i] + right.x - up.x, y[i] + right.y - up.y);
+            rlTexCoord2f(1.0f, 0.0f);
+            rlVertex2f(x[i] + right.x + up.x, y[i] + right.y + up.y);
+        }
+        rlEnd();
+        rlSetTexture(0);
+    }
+
+    /**
+     * Remove a projectile by swapping the last one into its place.
+     * For internal use only.
+     *
+     * @param index The index of the projectile.
+     */
+    void remove(int index)
+    {
+        int last = get_count() - 1;
+        x[index] = x[last];
+        y[index] = y[last];
+        velocity_x[index] = velocity_x[last];
+        velocity_y[index] = velocity_y[last];
+        life[index] = life[last];
+        radius[index] = radius[last];
+        ignore_bodies[index] = ignore_bodies[last];
+        owners[index] = owners[last];
+        x.pop_back();
+        y.pop_back();
+        velocity_x.pop_back();
+        velocity_y.pop_back();
+        life.pop_back();
+        radius.pop_back();
+        ignore_bodies.pop_back();
+        owners.pop_back();
+    }
+};
+
+/**
+ * Settings for particles when they are emitted.
+ */
+struct ParticleParams
+{
+    float lifetime_min = 0.5f; // seconds
+    float lifetime_max = 1.0f; // seconds
+    float speed_min = 50.0f; // pixels / second
+    float speed_max = 100.0f; // pixels / second
+    float direction = -90.0f; // degrees
+    float spread = 360.0f; // degrees, centered on direction
+    Vector2 gravity = {0.0f, 0.0f}; // pixels / second / second
+    float drag = 0.0f; // fraction of velocity lost per second
+    float size_start = 8.0f; // pixels
+    float size_end = 0.0f; // pixels
+    Color color_start = WHITE;
+    Color color_end = {255, 255, 255, 0};
+};
+
+/**
+ * All particles that share a texture, stored as separate arrays so they can be updated with SIMD.
+ */
+struct ParticleSystem
+{
+    Texture2D texture;
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> velocity_x;
+    std::vector<float> velocity_y;
+    std::vector<float> gravity_x;
+    std::vector<float> gravity_y;
+    std::vector<float> drag;
+    std::vector<float> age;
+    std::vector<float> inverse_lifetime;
+    std::vector<float> life_fraction;
+    std::vector<float> size;
+    std::vector<float> size_start;
+    std::vector<float> size_end;
+    std::vector<Color> color_start;
+    std::vector<Color> color_end;
+
+    /**
+     * Get the number of live particles.
+     *
+     * @return The number of particles.
+     */
+    int get_count() const
+    {
+        return (int)x.size();
+    }
+
+    /**
+     * Update a range of particles.
+     * Ranges don't share data, so they can be updated on different threads.
+     *
+     * @param begin The first particle to update.
+     * @param end One past the last particle to update.
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update_range(int begin, int end, float delta_time)
+    {
+        int n = end - begin;
+        simd_add(age.data() + begin, delta_time, n);
+        simd_add_scaled(velocity_x.data() + begin, gravity_x.data() + begin, delta_time, n);
+        simd_add_scaled(velocity_y.data() + begin, gravity_y.data() + begin, delta_time, n);
+        simd_damp(velocity_x.data() + begin, drag.data() + begin, delta_time, n);
+        simd_damp(velocity_y.data() + begin, drag.data() + begin, delta_time, n);
+        simd_integrate(x.data() + begin,
+                       y.data() + begin,
+                       velocity_x.data() + begin,
+                       velocity_y.data() + begin,
+                       delta_time,
+                       n);
+        simd_multiply(life_fraction.data() + begin, age.data() + begin, inverse_lifetime.data() + begin, n);
+        simd_lerp(size.data() + begin,
+                  size_start.data() + begin,
+                  size_end.data() + begin,
+                  life_fraction.data() + begin,
+                  n);
+    }
+
+    /**
+     * Remove particles that have reached the end of their life, keeping the arrays packed.
+     */
+    void remove_dead()
+    {
+        int count = get_count();
+        int last = count;
+        for (int i = count - 1; i >= 0; i--)
+        {
+            if (life_fraction[i] < 1.0f)
+            {
+                continue;
+            }
+            last--;
+            x[i] = x[last];
+            y[i] = y[last];
+            velocity_x[i] = velocity_x[last];
+            velocity_y[i] = velocity_y[last];
+            gravity_x[i] = gravity_x[last];
+            gravity_y[i] = gravity_y[last];
+            drag[i] = drag[last];
+            age[i] = age[last];
+            inverse_lifetime[i] = inverse_lifetime[last];
+            life_fraction[i] = life_fraction[last];
+            size[i] = size[last];
+            size_start[i] = size_start[last];
+            size_end[i] = size_end[last];
+            color_start[i] = color_start[last];
+            color_end[i] = color_end[last];
+        }
+        if (last != count)
+        {
+            resize(last);
+        }
+    }
+
+    /**
+     * Resize every array.
+     * For internal use only.
+     *
+     * @param count The new number of particles.
+     */
+    void resize(int count)
+    {
+        x.resize(count);
+        y.resize(count);
+        velocity_x.resize(count);
+        velocity_y.resize(count);
+        gravity_x.resize(count);
+        gravity_y.resize(count);
+        drag.resize(count);
+        age.resize(count);
+        inverse_lifetime.resize(count);
+        life_fraction.resize(count);
+        size.resize(count);
+        size_start.resize(count);
+        size_end.resize(count);
+        color_start.resize(count);
+        color_end.resize(count);
+    }
+
+    /**
+     * Draw every particle as a quad in a single batch.
+     */
+    void draw() const
+    {
+        int count = get_count();
+        if (count == 0)
+        {
+            return;
+        }
+
+        rlSetTexture(texture.id);
+        rlBegin(RL_QUADS);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+        for (int i = 0; i < count; i++)
+        {
+            float t = life_fraction[i];
+            const Color& a = color_start[i];
+            const Color& b = color_end[i];
+            float half_size = size[i] / 2.0f;
+
+            rlCheckRenderBatchLimit(4);
+            rlColor4ub((unsigned char)(a.r + (b.r - a.r) * t),
+                       (unsigned char)(a.g + (b.g - a.g) * t),
+                       (unsigned char)(a.b + (b.b - a.b) * t),
+                       (unsigned char)(a.a + (b.a - a.a) * t));
+            rlTexCoord2f(0.0f, 0.0f);
+            rlVertex2f(x[i] - half_size, y[i] - half_size);
+            rlTexCoord2f(0.0f, 1.0f);
+            rlVertex2f(x[i] - half_size, y[i] + half_size);
+            rlTexCoord2f(1.0f, 1.0f);
+            rlVertex2f(x[i] + half_size, y[i] + half_size);
+            rlTexCoord2f(1.0f, 0.0f);
+            rlVertex2f(x[i] + half_size, y[i] - half_size);
+        }
+        rlEnd();
+        rlSetTexture(0);
+    }
+};
+
+/**
+ * Service for updating and drawing particles.
+ * Particles are grouped into one system per texture, and each system is drawn in one batch.
+ * Large systems can be updated across worker threads.
+ * Depends on TextureService.
+ */
+class ParticleService : public Service
+{
+public:
+    std::vector<std::unique_ptr<ParticleSystem>> systems;
+    std::unordered_map<std::string, int> system_indices;
+
+    // Systems with at least this many particles are split across the worker threads.
+    int parallel_threshold = 16384;
+
+    // Declared last so the workers are joined before anything they use is destroyed.
+    ThreadPool workers;
+
+    /**
+     * Constructor for ParticleService.
+     *
+     * @param thread_count The number of worker threads for updating large systems. Zero updates on the main thread.
+     */
+    ParticleService(int thread_count = 0) : workers(thread_count) {}
+
+    /**
+     * Get the system for a texture, creating it if needed.
+     *
+     * @param texture_file The texture to draw the particles with.
+     * @return The index of the system.
+     */
+    int get_system(const std::string& texture_file)
+    {
+        auto it = system_indices.find(texture_file);
+        if (it != system_indices.end())
+        {
+            return it->second;
+        }
+
+        auto system = std::make_unique<ParticleSystem>();
+        system->texture = scene->get_service<TextureService>()->get_texture(texture_file);
+        int index = (int)systems.size();
+        systems.push_back(std::move(system));
+        system_indices[texture_file] = index;
+        return index;
+    }
+
+    /**
+     * Emit particles into a system.
+     *
+     * @param system The index of the system, from get_system().
+     * @param position The position to emit from in pixels.
+     * @param params The settings for the new particles.
+     * @param count The number of particles to emit.
+     */
+    void emit(int system, Vector2 position, const ParticleParams& params, int count)
+    {
+        if (count <= 0 || system < 0 || system >= (int)systems.size())
+        {
+            return;
+        }
+
+        auto& s = *systems[system];
+        int first = s.get_count();
+        s.resize(first + count);
+        for (int i = first; i < first + count; i++)
+        {
+            float angle = (params.direction + random_range(-params.spread, params.spread) / 2.0f) * DEG2RAD;
+            float speed = random_range(params.speed_min, params.speed_max);
+            float lifetime = std::max(0.001f, random_range(params.lifetime_min, params.lifetime_max));
+
+            s.x[i] = position.x;
+            s.y[i] = position.y;
+            s.velocity_x[i] = std::cos(angle) * speed;
+            s.velocity_y[i] = std::sin(angle) * speed;
+            s.gravity_x[i] = params.gravity.x;
+            s.gravity_y[i] = params.gravity.y;
+            s.drag[i] = params.drag;
+            s.age[i] = 0.0f;
+            s.inverse_lifetime[i] = 1.0f / lifetime;
+            s.life_fraction[i] = 0.0f;
+            s.size[i] = params.size_start;
+            s.size_start[i] = params.size_start;
+            s.size_end[i] = params.size_end;
+            s.color_start[i] = params.color_start;
+            s.color_end[i] = params.color_end;
+        }
+    }
+
+    /**
+     * Emit a burst of particles without an emitter component, e.g. sparks where a projectile hit.
+     *
+     * @param texture_file The texture to draw the particles with.
+     * @param position The position to emit from in pixels.
+     * @param params The settings for the new particles.
+     * @param count The number of particles to emit.
+     */
+    void burst(const std::string& texture_file, Vector2 position, const ParticleParams& params, int count)
+    {
+        emit(get_system(texture_file), position, params, count);
+    }
+
+    /**
+     * Update all particles.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        for (auto& system : systems)
+        {
+            auto& s = *system;
+            int count = s.get_count();
+            if (count >= parallel_threshold)
+            {
+                workers.parallel_for(
+                    count, parallel_threshold / 4, [&](int begin, int end) { s.update_range(begin, end, delta_time); });
+            }
+            else
+            {
+                s.update_range(0, count, delta_time);
+            }
+            s.remove_dead();
+        }
+    }
+
+    /**
+     * Draw all particles.
+     */
+    void draw() override
+    {
+        for (const auto& system : systems)
+        {
+            system->draw();
+        }
+    }
+
+    /**
+     * Get a random float in a range.
+     *
+     * @param min The minimum value.
+     * @param max The maximum value.
+     * @return A random value between min and max.
+     */
+    static float random_range(float min, float max)
+    {
+        constexpr int resolution = 10000;
+        return min + (max - min) * (GetRandomValue(0, resolution) / (float)resolution);
+    }
+};
+
+/**
+ * A point light drawn by LightingService.
+ */
+struct Light
+{
+    Vector2 position = {0, 0};
+    float radius = 300.0f;
+    Color color = WHITE;
+    bool active = true;
+};
+
+/**
+ * The steering forces gathered from an agent's neighbors.
+ */
+struct CrowdForces
+{
+    float separation_x = 0.0f;
+    float separation_y = 0.0f;
+    float alignment_x = 0.0f;
+    float alignment_y = 0.0f;
+    float neighbor_count = 0.0f;
+    float avoidance_x = 0.0f;
+    float avoidance_y = 0.0f;
+};
+
+/**
+ * Service for steering crowds of agents so they spread out instead of piling up.
+ * Each agent reports its position, velocity and the direction it wants to go, and gets back a steering direction
+ * with separation from close neighbors, alignment with the crowd's velocity, and avoidance of neighbors it is about
+ * to run into. Agents are sorted into a uniform grid every frame, so each row of neighboring cells is one contiguous
+ * run of the arrays and the neighbor loop is vectorized. Agents that don't report in are left out that frame.
+ * Keeping agents apart this way means far fewer physics contacts than letting Box2D push them apart.
+ */
+class CrowdService : public Service
+{
+public:
+    // Agents, indexed by the id add_agent() returns.
+    std::vector<float> agent_x;
+    std::vector<float> agent_y;
+    std::vector<float> agent_velocity_x;
+    std::vector<float> agent_velocity_y;
+    std::vector<float> agent_preferred_x;
+    std::vector<float> agent_preferred_y;
+    std::vector<float> agent_radius;
+    std::vector<float> agent_max_speed;
+    std::vector<float> steering_x;
+    std::vector<float> steering_y;
+    std::vector<uint8_t> agent_reported;
+    std::vector<uint8_t> agent_in_use;
+    std::vector<int> free_agents;
+
+    // The agents that reported in this frame, sorted by grid cell.
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> velocity_x;
+    std::vector<float> velocity_y;
+    std::vector<float> radius;
+    std::vector<int> sorted_agents;
+
+    // Scratch buffers for sorting.
+    std::vector<int> active;
+    std::vector<int> active_cells;
+    std::vector<int> cell_start;
+
+    float grid_x = 0.0f;
+    float grid_y = 0.0f;
+    float cell_size = 64.0f;
+    int grid_width = 0;
+    int grid_height = 0;
+    // The grid's cells are made larger when the agents are spread too far apart for this many.
+    int max_grid_cells = 65536;
+
+    // Agents within this distance in pixels are neighbors.
+    float neighbor_radius = 64.0f;
+    // Extra space in pixels agents try to keep between each other.
+    float personal_space = 4.0f;
+    // How far ahead in seconds agents look for collisions.
+    float time_horizon = 0.5f;
+    float separation_weight = 1.5f;
+    float alignment_weight = 0.3f;
+    float avoidance_weight = 1.0f;
+
+    // Crowds with at least this many agents are split across the worker threads.
+    int parallel_threshold = 2048;
+
+    // Declared last so the workers are joined before anything they use is destroyed.
+    ThreadPool workers;
+
+    /**
+     * Constructor for CrowdService.
+     *
+     * @param thread_count The number of worker threads for steering large crowds. Zero steers on the main thread.
+     */
+    CrowdService(int thread_count = 0) : workers(thread_count) {}
+
+    /**
+     * Add an agent.
+     *
+     * @param radius The radius of the agent in pixels.
+     * @param max_speed The top speed of the agent in pixels per second.
+     * @return The id of the agent.
+     */
+    int add_agent(float radius, float max_speed)
+    {
+        int id;
+        if (!free_agents.empty())
+        {
+            id = free_agents.back();
+            free_agents.pop_back();
+        }
+        else
+        {
+            id = (int)agent_in_use.size();
+            agent_x.push_back(0.0f);
+            agent_y.push_back(0.0f);
+            agent_velocity_x.push_back(0.0f);
+            agent_velocity_y.push_back(0.0f);
+            agent_preferred_x.push_back(0.0f);
+            agent_preferred_y.push_back(0.0f);
+            agent_radius.push_back(0.0f);
+            agent_max_speed.push_back(0.0f);
+            steering_x.push_back(0.0f);
+            steering_y.push_back(0.0f);
+            agent_reported.push_back(0);
+            agent_in_use.push_back(0);
+        }
+        agent_radius[id] = radius;
+        agent_max_speed[id] = std::max(max_speed, 0.001f);
+        steering_x[id] = 0.0f;
+        steering_y[id] = 0.0f;
+        agent_reported[id] = 0;
+        agent_in_use[id] = 1;
+        return id;
+    }
+
+    /**
+     * Remove an agent.
+     *
+     * @param id The id of the agent.
+     */
+    void remove_agent(int id)
+    {
+        if (id < 0 || id >= (int)agent_in_use.size() || !agent_in_use[id])
+        {
+            return;
+        }
+        agent_in_use[id] = 0;
+        agent_reported[id] = 0;
+        free_agents.push_back(id);
+    }
+
+    /**
+     * Report where an agent is and where it wants to go. Call every frame the agent should be steered.
+     *
+     * @param id The id of the agent.
+     * @param position The position of the agent in pixels.
+     * @param velocity The velocity of the agent in pixels per second.
+     * @param preferred_direction The direction the agent wants to move in, with a length of at most 1.
+     */
+    void set_agent(int id, Vector2 position, Vector2 velocity, Vector2 preferred_direction)
+    {
+        agent_x[id] = position.x;
+        agent_y[id] = position.y;
+        agent_velocity_x[id] = velocity.x;
+        agent_velocity_y[id] = velocity.y;
+        agent_preferred_x[id] = preferred_direction.x;
+        agent_preferred_y[id] = preferred_direction.y;
+        agent_reported[id] = 1;
+    }
+
+    /**
+     * Get the direction an agent should move in, worked out in the last update.
+     * Suitable as input for TopDownMovementComponent.
+     *
+     * @param id The id of the agent.
+     * @return The steering direction, with a length of at most 1.
+     */
+    Vector2 get_steering(int id) const
+    {
+        return {steering_x[id], steering_y[id]};
+    }
+
+    /**
+     * Steer every agent that reported in since the last update.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        active.clear();
+        for (int id = 0; id < (int)agent_in_use.size(); id++)
+        {
+            if (agent_in_use[id] && agent_reported[id])
+            {
+                active.push_back(id);
+                agent_reported[id] = 0;
+            }
+            else
+            {
+                steering_x[id] = 0.0f;
+                steering_y[id] = 0.0f;
+            }
+        }
+
+        int count = (int)active.size();
+        if (count == 0)
+        {
+            return;
+        }
+
+        build_grid();
+        if (count >= parallel_threshold)
+        {
+            workers.parallel_for(
+                count, parallel_threshold / 4, [this](int begin, int end) { steer_range(begin, end); });
+        }
+        else
+        {
+            steer_range(0, count);
+        }
+    }
+
+    /**
+     * Sort the active agents into the grid with a counting sort.
+     * For internal use only.
+     */
+    void build_grid()
+    {
+        int count = (int)active.size();
+        float min_x = FLT_MAX;
+        float min_y = FLT_MAX;
+        float max_x = -FLT_MAX;
+        float max_y = -FLT_MAX;
+        for (int id : active)
+        {
+            min_x = std::min(min_x, agent_x[id]);
+            min_y = std::min(min_y, agent_y[id]);
+            max_x = std::max(max_x, agent_x[id]);
+            max_y = std::max(max_y, agent_y[id]);
+        }
+
+        // Cells at least as large as the neighbor radius mean neighbors are always in the surrounding 3x3 cells.
+        grid_x = min_x;
+        grid_y = min_y;
+        cell_size = std::max(neighbor_radius, 1.0f);
+        grid_width = (int)((max_x - min_x) / cell_size) + 1;
+        grid_height = (int)((max_y - min_y) / cell_size) + 1;
+        while ((long long)grid_width * grid_height > max_grid_cells)
+        {
+            cell_size *= 2.0f;
+            grid_width = (int)((max_x - min_x) / cell_size) + 1;
+            grid_height = (int)((max_y - min_y) / cell_size) + 1;
+        }
+
+        int cell_count = grid_width * grid_height;
+        cell_start.assign(cell_count + 1, 0);
+        active_cells.resize(count);
+        for (int i = 0; i < count; i++)
+        {
+            int id = active[i];
+            int cell = get_cell_x(agent_x[id]) + get_cell_y(agent_y[id]) * grid_width;
+            active_cells[i] = cell;
+            cell_start[cell]++;
+        }
+        // Running totals, so each entry is where its cell ends.
+        for (int cell = 1; cell < cell_count; cell++)
+        {
+            cell_start[cell] += cell_start[cell - 1];
+        }
+        cell_start[cell_count] = count;
+
+        x.resize(count);
+        y.resize(count);
+        velocity_x.resize(count);
+        velocity_y.resize(count);
+        radius.resize(count);
+        sorted_agents.resize(count);
+
+        // Fill each cell from the back, which leaves each entry pointing at where its cell starts.
+        for (int i = count - 1; i >= 0; i--)
+        {
+            int id = active[i];
+            int index = --cell_start[active_cells[i]];
+            x[index] = agent_x[id];
+            y[index] = agent_y[id];
+            velocity_x[index] = agent_velocity_x[id];
+            velocity_y[index] = agent_velocity_y[id];
+            radius[index] = agent_radius[id];
+            sorted_agents[index] = id;
+        }
+    }
+
+    /**
+     * Get the grid column of a position.
+     * For internal use only.
+     *
+     * @param position_x The x position in pixels.
+     * @return The column, clamped to the grid.
+     */
+    int get_cell_x(float position_x) const
+    {
+        return std::clamp((int)((position_x - grid_x) / cell_size), 0, grid_width - 1);
+    }
+
+    /**
+     * Get the grid row of a position.
+     * For internal use only.
+     *
+     * @param position_y The y position in pixels.
+     * @return The row, clamped to the grid.
+     */
+    int get_cell_y(float position_y) const
+    {
+        return std::clamp((int)((position_y - grid_y) / cell_size), 0, grid_height - 1);
+    }
+
+    /**
+     * Work out the steering for a range of the sorted agents.
+     * For internal use only.
+     *
+     * @param begin The first sorted index.
+     * @param end One past the last sorted index.
+     */
+    void steer_range(int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            int cell_x = get_cell_x(x[i]);
+            int cell_y = get_cell_y(y[i]);
+            int first_x = std::max(cell_x - 1, 0);
+            int last_x = std::min(cell_x + 1, grid_width - 1);
+
+            CrowdForces forces;
+            for (int row = std::max(cell_y - 1, 0); row <= std::min(cell_y + 1, grid_height - 1); row++)
+            {
+                int row_start = cell_start[row * grid_width + first_x];
+                int row_end = cell_start[row * grid_width + last_x + 1];
+                accumulate(i, row_start, row_end, forces);
+            }
+
+            int id = sorted_agents[i];
+            float steer_x = agent_preferred_x[id];
+            float steer_y = agent_preferred_y[id];
+            steer_x += forces.separation_x * separation_weight + forces.avoidance_x * avoidance_weight;
+            steer_y += forces.separation_y * separation_weight + forces.avoidance_y * avoidance_weight;
+            if (forces.neighbor_count > 0.0f)
+            {
+                // Match the neighbors' average velocity, relative to top speed.
+                float inverse = 1.0f / (forces.neighbor_count * agent_max_speed[id]);
+                steer_x += (forces.alignment_x * inverse - velocity_x[i] / agent_max_speed[id]) * alignment_weight;
+                steer_y += (forces.alignment_y * inverse - velocity_y[i] / agent_max_speed[id]) * alignment_weight;
+            }
+
+            float length_sq = steer_x * steer_x + steer_y * steer_y;
+            if (length_sq > 1.0f)
+            {
+                float inverse_length = 1.0f / std::sqrt(length_sq);
+                steer_x *= inverse_length;
+                steer_y *= inverse_length;
+            }
+            steering_x[id] = steer_x;
+            steering_y[id] = steer_y;
+        }
+    }
+
+    /**
+     * Add up the forces on a sorted agent from a contiguous run of sorted agents.
+     * Separation pushes away from neighbors closer than both radii plus the personal space. Avoidance looks at when
+     * each neighbor will be closest, and if that is within the time horizon and closer than the combined radius,
+     * pushes away from where the neighbor will be, harder the sooner it is. Head on, it sidesteps instead.
+     * For internal use only.
+     *
+     * @param i The sorted index of the agent.
+     * @param begin The first sorted index of the run.
+     * @param end One past the last sorted index of the run.
+     * @param forces The forces to add to.
+     */
+    void accumulate(int i, int begin, int end, CrowdForces& forces) const
+    {
+        const float epsilon = 1e-6f;
+        const float head_on_distance_sq = 0.01f;
+        const float neighbor_radius_sq = neighbor_radius * neighbor_radius;
+        const float inverse_horizon = 1.0f / time_horizon;
+        const float px = x[i];
+        const float py = y[i];
+        const float pvx = velocity_x[i];
+        const float pvy = velocity_y[i];
+        const float reach = radius[i] + personal_space;
+
+        int j = begin;
+#ifdef GAME_JAM_KIT_SSE2
+        const __m128 eps = _mm_set1_ps(epsilon);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 radius_sq_limit = _mm_set1_ps(neighbor_radius_sq);
+        const __m128 horizon = _mm_set1_ps(time_horizon);
+        const __m128 inv_horizon = _mm_set1_ps(inverse_horizon);
+        const __m128 x4 = _mm_set1_ps(px);
+        const __m128 y4 = _mm_set1_ps(py);
+        const __m128 vx4 = _mm_set1_ps(pvx);
+        const __m128 vy4 = _mm_set1_ps(pvy);
+        const __m128 reach4 = _mm_set1_ps(reach);
+        const __m128 head_on_sq = _mm_set1_ps(head_on_distance_sq);
+        __m128 sep_x = zero, sep_y = zero, align_x = zero, align_y = zero, neighbors = zero;
+        __m128 avoid_x = zero, avoid_y = zero;
+        for (; j + 4 <= end; j += 4)
+        {
+            __m128 dx = _mm_sub_ps(x4, _mm_loadu_ps(&x[j]));
+            __m128 dy = _mm_sub_ps(y4, _mm_loadu_ps(&y[j]));
+            __m128 dist_sq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+            // The agent itself is at distance 0 and is left out.
+            __m128 near = _mm_and_ps(_mm_cmpgt_ps(dist_sq, eps), _mm_cmplt_ps(dist_sq, radius_sq_limit));
+            if (_mm_movemask_ps(near) == 0)
+            {
+                continue;
+            }
+
+            __m128 dist = _mm_sqrt_ps(_mm_max_ps(dist_sq, eps));
+            __m128 r = _mm_add_ps(reach4, _mm_loadu_ps(&radius[j]));
+
+            __m128 overlap = _mm_and_ps(near, _mm_cmplt_ps(dist, r));
+            __m128 weight = _mm_and_ps(overlap, _mm_div_ps(_mm_sub_ps(r, dist), _mm_mul_ps(r, dist)));
+            sep_x = _mm_add_ps(sep_x, _mm_mul_ps(dx, weight));
+            sep_y = _mm_add_ps(sep_y, _mm_mul_ps(dy, weight));
+
+            __m128 nvx = _mm_loadu_ps(&velocity_x[j]);
+            __m128 nvy = _mm_loadu_ps(&velocity_y[j]);
+            align_x = _mm_add_ps(align_x, _mm_and_ps(near, nvx));
+            align_y = _mm_add_ps(align_y, _mm_and_ps(near, nvy));
+            neighbors = _mm_add_ps(neighbors, _mm_and_ps(near, one));
+
+            __m128 dvx = _mm_sub_ps(vx4, nvx);
+            __m128 dvy = _mm_sub_ps(vy4, nvy);
+            __m128 speed_sq = _mm_add_ps(_mm_mul_ps(dvx, dvx), _mm_mul_ps(dvy, dvy));
+            __m128 dot = _mm_add_ps(_mm_mul_ps(dx, dvx), _mm_mul_ps(dy, dvy));
+            __m128 t = _mm_div_ps(_mm_sub_ps(zero, dot), _mm_max_ps(speed_sq, eps));
+            __m128 approaching =
+                _mm_and_ps(_mm_and_ps(near, _mm_cmpgt_ps(speed_sq, eps)),
+                           _mm_and_ps(_mm_cmpgt_ps(t, zero), _mm_cmplt_ps(t, horizon)));
+            __m128 cx = _mm_add_ps(dx, _mm_mul_ps(dvx, t));
+            __m128 cy = _mm_add_ps(dy, _mm_mul_ps(dvy, t));
+            __m128 closest_sq = _mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy));
+            __m128 hit = _mm_and_ps(approaching, _mm_cmplt_ps(closest_sq, _mm_mul_ps(r, r)));
+            __m128 closest = _mm_sqrt_ps(_mm_max_ps(closest_sq, eps));
+            __m128 inverse_speed = _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(speed_sq, eps)));
+
+            // Head on, sidestep to the left of the relative velocity. Both agents see opposite velocities, so they
+            // step to opposite sides.
+            __m128 head_on = _mm_cmplt_ps(closest_sq, head_on_sq);
+            __m128 inverse_closest = _mm_div_ps(one, closest);
+            __m128 dir_x = _mm_or_ps(_mm_and_ps(head_on, _mm_mul_ps(_mm_sub_ps(zero, dvy), inverse_speed)),
+                                     _mm_andnot_ps(head_on, _mm_mul_ps(cx, inverse_closest)));
+            __m128 dir_y = _mm_or_ps(_mm_and_ps(head_on, _mm_mul_ps(dvx, inverse_speed)),
+                                     _mm_andnot_ps(head_on, _mm_mul_ps(cy, inverse_closest)));
+
+            __m128 urgency = _mm_sub_ps(one, _mm_mul_ps(t, inv_horizon));
+            __m128 push = _mm_div_ps(_mm_mul_ps(urgency, _mm_sub_ps(r, closest)), r);
+            push = _mm_and_ps(hit, push);
+            avoid_x = _mm_add_ps(avoid_x, _mm_mul_ps(dir_x, push));
+            avoid_y = _mm_add_ps(avoid_y, _mm_mul_ps(dir_y, push));
+        }
+        forces.separation_x += horizontal_sum(sep_x);
+        forces.separation_y += horizontal_sum(sep_y);
+        forces.alignment_x += horizontal_sum(align_x);
+        forces.alignment_y += horizontal_sum(align_y);
+        forces.neighbor_count += horizontal_sum(neighbors);
+        forces.avoidance_x += horizontal_sum(avoid_x);
+        forces.avoidance_y += horizontal_sum(avoid_y);
+#endif
+        for (; j < end; j++)
+        {
+            float dx = px - x[j];
+            float dy = py - y[j];
+            float dist_sq = dx * dx + dy * dy;
+            if (dist_sq <= epsilon || dist_sq >= neighbor_radius_sq)
+            {
+                continue;
+            }
+
+            float dist = std::sqrt(dist_sq);
+            float r = reach + radius[j];
+            if (dist < r)
+            {
+                float weight = (r - dist) / (r * dist);
+                forces.separation_x += dx * weight;
+                forces.separation_y += dy * weight;
+            }
+
+            forces.alignment_x += velocity_x[j];
+            forces.alignment_y += velocity_y[j];
+            forces.neighbor_count += 1.0f;
+
+            float dvx = pvx - velocity_x[j];
+            float dvy = pvy - velocity_y[j];
+            float speed_sq = dvx * dvx + dvy * dvy;
+            if (speed_sq <= epsilon)
+            {
+                continue;
+            }
+            float t = -(dx * dvx + dy * dvy) / speed_sq;
+            if (t <= 0.0f || t >= time_horizon)
+            {
+                continue;
+            }
+            float cx = dx + dvx * t;
+            float cy = dy + dvy * t;
+            float closest_sq = cx * cx + cy * cy;
+            if (closest_sq >= r * r)
+            {
+                continue;
+            }
+            float closest = std::sqrt(std::max(closest_sq, epsilon));
+            float dir_x = cx / closest;
+            float dir_y = cy / closest;
+            if (closest_sq < head_on_distance_sq)
+            {
+                float inverse_speed = 1.0f / std::sqrt(speed_sq);
+                dir_x = -dvy * inverse_speed;
+                dir_y = dvx * inverse_speed;
+            }
+            float push = (1.0f - t * inverse_horizon) * (r - closest) / r;
+            forces.avoidance_x += dir_x * push;
+            forces.avoidance_y += dir_y * push;
+        }
+    }
+
+#ifdef GAME_JAM_KIT_SSE2
+    /**
+     * Add up the four lanes of a vector.
+     * For internal use only.
+     *
+     * @param v The vector.
+     * @return The sum of its lanes.
+     */
+    static float horizontal_sum(__m128 v)
+    {
+        float lanes[4];
+        _mm_storeu_ps(lanes, v);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+#endif
+};
+
+/**
+ * How often an UpdateLODComponent updates, by distance from the nearest focus point.
+ */
+struct UpdateLODParams
+{
+    // Within near_distance pixels, updates every frame.
+    float near_distance = 400.0f;
+    // Between near_distance and far_distance, updates every mid_interval seconds.
+    float far_distance = 1000.0f;
+    float mid_interval = 0.1f;
+    // Past far_distance, updates every far_interval seconds.
+    float far_interval = 0.5f;
+};
+
+/**
+ * Storage for the updates run by UpdateSchedulerService.
+ */
+struct UpdateSchedule
+{
+    SlotAllocator slots;
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> accumulated;
+    std::vector<UpdateLODParams> params;
+    std::vector<std::function<void(float)>> callbacks;
+    std::vector<uint8_t> flags;
+
+    static constexpr uint8_t in_use = 1 << 0;
+    // Set by the component each frame its game object is active.
+    static constexpr uint8_t reported = 1 << 1;
+    // Set while the game object stays active, so it updates right away when it becomes active again.
+    static constexpr uint8_t running = 1 << 2;
+
+    /**
+     * Add an update, reusing a free slot if there is one.
+     *
+     * @param p How often to update.
+     * @param callback The update to run, given the time since it last ran.
+     * @return The index of the update.
+     */
+    int add(const UpdateLODParams& p, std::function<void(float)> callback)
+    {
+        int index = slots.acquire();
+        if (index == (int)flags.size())
+        {
+            x.push_back(0);
+            y.push_back(0);
+            accumulated.push_back(0);
+            params.emplace_back();
+            callbacks.emplace_back();
+            flags.push_back(0);
+        }
+        accumulated[index] = 0.0f;
+        params[index] = p;
+        callbacks[index] = std::move(callback);
+        flags[index] = in_use;
+        return index;
+    }
+
+    /**
+     * Remove an update and free its slot.
+     *
+     * @param index The index of the update.
+     */
+    void remove(int index)
+    {
+        if (index < 0 || index >= (int)flags.size() || !(flags[index] & in_use))
+        {
+            return;
+        }
+        flags[index] = 0;
+        callbacks[index] = nullptr;
+        slots.release(index);
+    }
+
+    /**
+     * Mark an update as active this frame and set where it is.
+     *
+     * @param index The index of the update.
+     * @param position The position in pixels.
+     */
+    void report(int index, Vector2 position)
+    {
+        x[index] = position.x;
+        y[index] = position.y;
+        flags[index] |= reported;
+    }
+};
+
+/**
+ * Service for running updates less often the further they are from the action.
+ * Updates near a focus point, like a player or camera, run every frame. Further away they run at the intervals in
+ * their UpdateLODParams, given the time since they last ran. Due updates that aren't near run most overdue first,
+ * until the frame's time budget is used up, and the rest wait for a later frame. The cost of a large population
+ * then mostly depends on how many are near the focus points.
+ * With no focus points, every update runs every frame.
+ * Use UpdateLODComponent to add an update to a game object.
+ */
+class UpdateSchedulerService : public Service
+{
+public:
+    std::shared_ptr<UpdateSchedule> schedule = std::make_shared<UpdateSchedule>();
+    std::vector<Vector2> focus_points;
+
+    // Seconds per frame to spend on updates that aren't near a focus point.
+    float time_budget = 0.002f;
+    // Updates this many times overdue run even when the budget is used up, so nothing waits forever.
+    float max_overdue = 3.0f;
+
+    // Scratch buffer of due updates and how overdue they are.
+    std::vector<std::pair<float, int>> due;
+
+    /**
+     * Constructor for UpdateSchedulerService.
+     *
+     * @param time_budget Seconds per frame to spend on updates that aren't near a focus point.
+     */
+    UpdateSchedulerService(float time_budget = 0.002f) : time_budget(time_budget) {}
+
+    /**
+     * Remove every focus point.
+     */
+    void clear_focus_points()
+    {
+        focus_points.clear();
+    }
+
+    /**
+     * Add a focus point. Updates near focus points run every frame.
+     *
+     * @param position The position in pixels.
+     */
+    void add_focus_point(Vector2 position)
+    {
+        focus_points.push_back(position);
+    }
+
+    /**
+     * Run the updates that are due.
+     * Updates must not add or remove other updates.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        auto& s = *schedule;
+        double start = GetTime();
+        due.clear();
+
+        for (int i = 0; i < (int)s.flags.size(); i++)
+        {
+            uint8_t flags = s.flags[i];
+            if (!(flags & UpdateSchedule::in_use))
+            {
+                continue;
+            }
+            if (!(flags & UpdateSchedule::reported))
+            {
+                // Inactive, so the time it was away doesn't count.
+                s.flags[i] &= ~UpdateSchedule::running;
+                s.accumulated[i] = 0.0f;
+                continue;
+            }
+            s.flags[i] = (flags & ~UpdateSchedule::reported) | UpdateSchedule::running;
+            s.accumulated[i] += delta_time;
+
+            float interval = get_interval(i);
+            if (interval <= 0.0f || !(flags & UpdateSchedule::running))
+            {
+                // Near, or just became active.
+                run(i);
+            }
+            else if (s.accumulated[i] >= interval)
+            {
+                due.push_back({s.accumulated[i] / interval, i});
+            }
+        }
+
+        std::sort(due.begin(), due.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+        for (const auto& [overdue, i] : due)
+        {
+            if (GetTime() - start > time_budget && overdue < max_overdue)
+            {
+                break;
+            }
+            run(i);
+        }
+    }
+
+    /**
+     * Get how often an update should run, from its distance to the nearest focus point.
+     * For internal use only.
+     *
+     * @param i The index of the update.
+     * @return The interval in seconds, 0 for every frame.
+     */
+    float get_interval(int i) const
+    {
+        const auto& s = *schedule;
+        if (focus_points.empty())
+        {
+            return 0.0f;
+        }
+
+        float distance_sq = FLT_MAX;
+        for (const auto& point : focus_points)
+        {
+            float dx = s.x[i] - point.x;
+            float dy = s.y[i] - point.y;
+            distance_sq = std::min(distance_sq, dx * dx + dy * dy);
+        }
+
+        const auto& p = s.params[i];
+        if (distance_sq <= p.near_distance * p.near_distance)
+        {
+            return 0.0f;
+        }
+        if (distance_sq <= p.far_distance * p.far_distance)
+        {
+            return p.mid_interval;
+        }
+        return p.far_interval;
+    }
+
+    /**
+     * Run an update with the time since it last ran.
+     * For internal use only.
+     *
+     * @param i The index of the update.
+     */
+    void run(int i)
+    {
+        auto& s = *schedule;
+        float delta_time = s.accumulated[i];
+        s.accumulated[i] = 0.0f;
+        s.callbacks[i](delta_time);
+    }
+};
+
+/**
+ * Storage for the kinematic bodies moved by PathFollowService.
+ */
+struct PathMovers
+{
+    SlotAllocator slots;
+
+    // Waypoints in meters, each mover's back to back.
+    std::vector<float> point_x;
+    std::vector<float> point_y;
+
+    // Movers, indexed by the slot add() returns.
+    std::vector<b2BodyId> bodies;
+    std::vector<int> first_point;
+    std::vector<int> point_count;
+    // Room for this many points at first_point, so a reused slot can reuse them.
+    std::vector<int> point_capacity;
+    std::vector<int> target;
+    std::vector<int> step;
+    // Meters per second.
+    std::vector<float> speed;
+    std::vector<float> velocity_x;
+    std::vector<float> velocity_y;
+    std::vector<uint8_t> flags;
+
+    static constexpr uint8_t in_use = 1 << 0;
+    // Go from the last waypoint back to the first, instead of turning around.
+    static constexpr uint8_t loop = 1 << 1;
+    // Set for the movers whose body is enabled this frame.
+    static constexpr uint8_t moving = 1 << 2;
+
+    /**
+     * Add a mover, reusing a free slot if there is one.
+     *
+     * @param body The kinematic body to move.
+     * @param points The waypoints in meters.
+     * @param meters_per_second The speed to move at.
+     * @param looping True to loop the path, false to go back and forth along it.
+     * @return The slot of the mover.
+     */
+    int add(b2BodyId body, const std::vector<b2Vec2>& points, float meters_per_second, bool looping)
+    {
+        int count = (int)points.size();
+        int index = slots.acquire();
+        if (index == (int)flags.size())
+        {
+            bodies.push_back(b2_nullBodyId);
+            first_point.push_back(0);
+            point_count.push_back(0);
+            point_capacity.push_back(0);
+            target.push_back(0);
+            step.push_back(1);
+            speed.push_back(0);
+            velocity_x.push_back(0);
+            velocity_y.push_back(0);
+            flags.push_back(0);
+        }
+
+        if (count > point_capacity[index])
+        {
+            first_point[index] = (int)point_x.size();
+            point_capacity[index] = count;
+            point_x.resize(point_x.size() + count);
+            point_y.resize(point_y.size() + count);
+        }
+        for (int i = 0; i < count; i++)
+        {
+            point_x[first_point[index] + i] = points[i].x;
+            point_y[first_point[index] + i] = points[i].y;
+        }
+
+        bodies[index] = body;
+        point_count[index] = count;
+        target[index] = 0;
+        step[index] = 1;
+        speed[index] = meters_per_second;
+        velocity_x[index] = 0.0f;
+        velocity_y[index] = 0.0f;
+        flags[index] = in_use | (looping ? loop : 0);
+        return index;
+    }
+
+    /**
+     * Remove a mover and free its slot.
+     *
+     * @param index The slot of the mover.
+     */
+    void remove(int index)
+    {
+        if (index < 0 || index >= (int)flags.size() || !(flags[index] & in_use))
+        {
+            return;
+        }
+        flags[index] = 0;
+        bodies[index] = b2_nullBodyId;
+        slots.release(index);
+    }
+};
+
+/**
+ * Service for moving kinematic bodies along paths of waypoints, like patrolling enemies and moving platforms.
+ * Every mover is advanced in one pass over flat arrays: positions are read from Box2D, the velocities toward each
+ * mover's next waypoint are worked out together, then written back to the bodies. Nothing per mover runs in a game
+ * object's update, so thousands of movers cost little more than the Box2D calls.
+ * Paths go back and forth by default, or loop. Movers whose body is disabled are skipped.
+ * Use PathFollowComponent to move a game object's body.
+ * Depends on PhysicsService.
+ */
+class PathFollowService : public Service
+{
+public:
+    PhysicsService* physics;
+    std::shared_ptr<PathMovers> movers = std::make_shared<PathMovers>();
+
+    // Positions of the movers this frame, in meters.
+    std::vector<float> x;
+    std::vector<float> y;
+
+    void init() override
+    {
+        physics = scene->get_service<PhysicsService>();
+    }
+
+    /**
+     * Move every mover toward its next waypoint.
+     * Runs before game objects update, so they see this frame's velocities.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        auto& m = *movers;
+        int count = (int)m.flags.size();
+        x.resize(count);
+        y.resize(count);
+
+        // Gather positions.
+        for (int i = 0; i < count; i++)
+        {
+            m.flags[i] &= ~PathMovers::moving;
+            if ((m.flags[i] & PathMovers::in_use) && m.point_count[i] > 0 && b2Body_IsValid(m.bodies[i]) &&
+                b2Body_IsEnabled(m.bodies[i]))
+            {
+                b2Vec2 position = b2Body_GetPosition(m.bodies[i]);
+                x[i] = position.x;
+                y[i] = position.y;
+                m.flags[i] |= PathMovers::moving;
+            }
+        }
+
+        steer(delta_time);
+
+        // Write velocities back.
+        for (int i = 0; i < count; i++)
+        {
+            if (m.flags[i] & PathMovers::moving)
+            {
+                b2Body_SetLinearVelocity(m.bodies[i], {m.velocity_x[i], m.velocity_y[i]});
+            }
+        }
+    }
+
+    /**
+     * Advance waypoints and set the velocity of every moving mover.
+     * For internal use only.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void steer(float delta_time)
+    {
+        auto& m = *movers;
+        int count = (int)m.flags.size();
+        for (int i = 0; i < count; i++)
+        {
+            if (!(m.flags[i] & PathMovers::moving))
+            {
+                continue;
+            }
+
+            float step_distance = m.speed[i] * delta_time;
+            int first = m.first_point[i];
+            float dx = m.point_x[first + m.target[i]] - x[i];
+            float dy = m.point_y[first + m.target[i]] - y[i];
+            float distance_sq = dx * dx + dy * dy;
+
+            // Reached the waypoint this frame, head for the next one.
+            if (distance_sq <= step_distance * step_distance && m.point_count[i] > 1)
+            {
+                int next = m.target[i] + m.step[i];
+                if (next < 0 || next >= m.point_count[i])
+                {
+                    if (m.flags[i] & PathMovers::loop)
+                    {
+                        next = next < 0 ? m.point_count[i] - 1 : 0;
+                    }
+                    else
+                    {
+                        m.step[i] = -m.step[i];
+                        next = m.target[i] + m.step[i];
+                    }
+                }
+                m.target[i] = next;
+                dx = m.point_x[first + next] - x[i];
+                dy = m.point_y[first + next] - y[i];
+                distance_sq = dx * dx + dy * dy;
+            }
+
+            float distance = std::sqrt(distance_sq);
+            if (distance <= 0.0f || delta_time <= 0.0f)
+            {
+                m.velocity_x[i] = 0.0f;
+                m.velocity_y[i] = 0.0f;
+                continue;
+            }
+            // Slow down rather than overshoot the end of a single point path.
+            float speed = std::min(m.speed[i], distance / delta_time);
+            m.velocity_x[i] = dx / distance * speed;
+            m.velocity_y[i] = dy / distance * speed;
+        }
+    }
+
+    /**
+     * Add a mover.
+     *
+     * @param body The kinematic body to move.
+     * @param waypoints The waypoints in pixels.
+     * @param speed The speed in pixels per second.
+     * @param loop True to loop the path, false to go back and forth along it.
+     * @return The slot of the mover.
+     */
+    int add_mover(b2BodyId body, const std::vector<Vector2>& waypoints, float speed, bool loop = false)
+    {
+        std::vector<b2Vec2> points;
+        points.reserve(waypoints.size());
+        for (const auto& waypoint : waypoints)
+        {
+            points.push_back(physics->convert_to_meters(waypoint));
+        }
+        return movers->add(body, points, physics->convert_to_meters(speed), loop);
+    }
+
+    /**
+     * Remove a mover. Its body keeps its last velocity.
+     *
+     * @param slot The slot returned by add_mover().
+     */
+    void remove_mover(int slot)
+    {
+        movers->remove(slot);
+    }
+
+    /**
+     * Get the velocity a mover was given this frame.
+     *
+     * @param slot The slot returned by add_mover().
+     * @return The velocity in pixels per second.
+     */
+    Vector2 get_velocity(int slot) const
+    {
+        return physics->convert_to_pixels(b2Vec2{movers->velocity_x[slot], movers->velocity_y[slot]});
+    }
+};
+
+/**
+ * Service for 2D lights that are blocked by the level's walls.
+ * Each light's visibility polygon is computed from the LevelService collision loops, using a uniform grid so only
+ * nearby wall segments are tested. Lights are drawn additively into a reduced resolution light buffer, which is
+ * then stretched over the scene with bilinear filtering and multiplied in.
+ * Call render_lights() outside of any texture mode, then draw_light_map() after drawing the scene.
+ * Depends on LevelService.
+ */
+class LightingService : public Service
+{
+public:
+    LevelService* level;
+    std::vector<Light> lights;
+    Color ambient = {20, 20, 30, 255};
+
+    // Size of the light buffer relative to the level. Lower is faster and softer.
+    float resolution_scale = 0.5f;
+    RenderTexture2D light_buffer;
+
+    // Minimum number of rays per light, spread evenly so the falloff stays round away from walls.
+    int base_rays = 64;
+
+    // Wall segments and the uniform grid indexing them.
+    std::vector<Vector2> segment_starts;
+    std::vector<Vector2> segment_ends;
+    float index_cell_size = 128.0f;
+    int index_width = 0;
+    int index_height = 0;
+    std::vector<std::vector<int>> index_cells;
+
+    // Per light scratch buffers, kept to avoid allocating every frame.
+    std::vector<int> segment_stamps;
+    int stamp = 0;
+    std::vector<int> nearby_segments;
+    std::vector<Vector2> corners;
+    std::vector<float> ray_angles;
+    std::vector<std::vector<Vector2>> polygons;
+
+    /**
+     * Constructor for LightingService.
+     *
+     * @param ambient The light color where no lights reach.
+     * @param resolution_scale The size of the light buffer relative to the level.
+     */
+    LightingService(Color ambient = {20, 20, 30, 255}, float resolution_scale = 0.5f) :
+        ambient(ambient),
+        resolution_scale(resolution_scale)
+    {
+    }
+
+    virtual ~LightingService()
+    {
+        UnloadRenderTexture(light_buffer);
+    }
+
+    void init() override
+    {
+        level = scene->get_service<LevelService>();
+        Vector2 size = level->get_size();
+        light_buffer = LoadRenderTexture((int)(size.x * resolution_scale), (int)(size.y * resolution_scale));
+        SetTextureFilter(light_buffer.texture, TEXTURE_FILTER_BILINEAR);
+        build_segment_index();
+    }
+
+    /**
+     * Add a light.
+     *
+     * @param position The position of the light in pixels.
+     * @param radius The distance the light reaches in pixels.
+     * @param color The color of the light.
+     * @return The index of the light.
+     */
+    int add_light(Vector2 position, float radius = 300.0f, Color color = WHITE)
+    {
+        Light light;
+        light.position = position;
+        light.radius = radius;
+        light.color = color;
+        lights.push_back(light);
+        return (int)lights.size() - 1;
+    }
+
+    /**
+     * Move a light.
+     *
+     * @param index The index of the light.
+     * @param position The position of the light in pixels.
+     */
+    void set_light_position(int index, Vector2 position)
+    {
+        lights[index].position = position;
+    }
+
+    /**
+     * Turn a light on or off.
+     *
+     * @param index The index of the light.
+     * @param active True to turn the light on.
+     */
+    void set_light_active(int index, bool active)
+    {
+        lights[index].active = active;
+    }
+
+    /**
+     * Compute the visibility polygon of every light.
+     *
+     * @param delta_time The time elapsed since the last frame.
+     */
+    void update(float delta_time) override
+    {
+        polygons.resize(lights.size());
+        for (int i = 0; i < (int)lights.size(); i++)
+        {
+            polygons[i].clear();
+            if (lights[i].active)
+            {
+                build_visibility_polygon(lights[i], polygons[i]);
+            }
+        }
+    }
+
+    /**
+     * Draw the lights into the light buffer.
+     * Must be called outside of BeginTextureMode()/EndTextureMode().
+     */
+    void render_lights()
+    {
+        BeginTextureMode(light_buffer);
+        ClearBackground(ambient);
+        BeginBlendMode(BLEND_ADDITIVE);
+        rlPushMatrix();
+        rlScalef(resolution_scale, resolution_scale, 1.0f);
+        for (int i = 0; i < (int)lights.size() && i < (int)polygons.size(); i++)
+        {
+            const auto& light = lights[i];
+            const auto& polygon = polygons[i];
+            if (!light.active || polygon.size() < 2)
+            {
+                continue;
+            }
+
+            // A triangle fan around the light, fading out towards the radius. The polygon goes clockwise on screen,
+            // so each triangle is emitted in reverse to face forward and survive backface culling.
+            rlBegin(RL_TRIANGLES);
+            for (int j = 0; j < (int)polygon.size(); j++)
+            {
+                const Vector2& a = polygon[j];
+                const Vector2& b = polygon[(j + 1) % polygon.size()];
+                rlCheckRenderBatchLimit(3);
+                rlColor4ub(light.color.r, light.color.g, light.color.b, 255);
+                rlVertex2f(light.position.x, light.position.y);
+                set_falloff_color(light, b);
+                rlVertex2f(b.x, b.y);
+                set_falloff_color(light, a);
+                rlVertex2f(a.x, a.y);
+            }
+            rlEnd();
+        }
+        rlPopMatrix();
+        EndBlendMode();
+        EndTextureMode();
+    }
+
+    /**
+     * Multiply the light buffer over everything drawn so far, stretched to the level size.
+     */
+    void draw_light_map()
+    {
+        Vector2 size = level->get_size();
+        BeginBlendMode(BLEND_MULTIPLIED);
+        DrawTexturePro(light_buffer.texture,
+                       {0.0f,
+                        0.0f,
+                        static_cast<float>(light_buffer.texture.width),
+                        static_cast<float>(-light_buffer.texture.height)},
+                       {0.0f, 0.0f, size.x, size.y},
+                       {0.0f, 0.0f},
+                       0.0f,
+                       WHITE);
+        EndBlendMode();
+    }
+
+    /**
+     * Set the vertex color for a point in a light, fading linearly to black at the radius.
+     * For internal use only.
+     *
+     * @param light The light.
+     * @param point The point in pixels.
+     */
+    static void set_falloff_color(const Light& light, Vector2 point)
+    {
+        float dx = point.x - light.position.x;
+        float dy = point.y - light.position.y;
+        float falloff = std::max(0.0f, 1.0f - std::sqrt(dx * dx + dy * dy) / light.radius);
+        rlColor4ub((unsigned char)(light.color.r * falloff),
+                   (unsigned char)(light.color.g * falloff),
+                   (unsigned char)(light.color.b * falloff),
+                   255);
+    }
+
+    /**
+     * Split the level's collision loops into segments and index them in a uniform grid.
+     * For internal use only.
+     */
+    void build_segment_index()
+    {
+        segment_starts.clear();
+        segment_ends.clear();
+        for (const auto& loop : level->collision_loops)
+        {
+            for (int i = 0; i < (int)loop.size(); i++)
+            {
+                segment_starts.push_back(loop[i]);
+                segment_ends.push_back(loop[(i + 1) % loop.size()]);
+            }
+        }
+
+        Vector2 size = level->get_size();
+        index_width = std::max(1, (int)std::ceil(size.x / index_cell_size));
+        index_height = std::max(1, (int)std::ceil(size.y / index_cell_size));
+        index_cells.assign(index_width * index_height, {});
+        for (int i = 0; i < (int)segment_starts.size(); i++)
+        {
+            const Vector2& a = segment_starts[i];
+            const Vector2& b = segment_ends[i];
+            int x0, y0, x1, y1;
+            index_cell_range(
+                std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.x, b.x), std::max(a.y, b.y), x0, y0, x1, y1);
+            for (int y = y0; y <= y1; y++)
+            {
+                for (int x = x0; x <= x1; x++)
+                {
+                    index_cells[y * index_width + x].push_back(i);
+                }
+            }
+        }
+        segment_stamps.assign(segment_starts.size(), 0);
+    }
+
+    /**
+     * Get the range of index cells covering a box, clamped to the grid.
+     * For internal use only.
+     *
+     * @param min_x The left of the box in pixels.
+     * @param min_y The top of the box in pixels.
+     * @param max_x The right of the box in pixels.
+     * @param max_y The bottom of the box in pixels.
+     * @param x0 The first cell column.
+     * @param y0 The first cell row.
+     * @param x1 The last cell column.
+     * @param y1 The last cell row.
+     */
+    void index_cell_range(float min_x, float min_y, float max_x, float max_y, int& x0, int& y0, int& x1, int& y1) const
+    {
+        x0 = std::max(0, std::min(index_width - 1, (int)std::floor(min_x / index_cell_size)));
+        y0 = std::max(0, std::min(index_height - 1, (int)std::floor(min_y / index_cell_size)));
+        x1 = std::max(0, std::min(index_width - 1, (int)std::floor(max_x / index_cell_size)));
+        y1 = std::max(0, std::min(index_height - 1, (int)std::floor(max_y / index_cell_size)));
+    }
+
+    /**
+     * Compute the area a light can see, as points around the light ordered by angle.
+     * Rays are cast at every nearby segment endpoint, just either side of it, and at evenly spaced angles.
+     * For internal use only.
+     *
+     * @param light The light.
+     * @param polygon The points of the visibility polygon.
+     */
+    void build_visibility_polygon(const Light& light, std::vector<Vector2>& polygon)
+    {
+        // Gather the segments near the light once, using stamps to skip segments already seen in another cell.
+        stamp++;
+        nearby_segments.clear();
+        int x0, y0, x1, y1;
+        index_cell_range(light.position.x - light.radius,
+                         light.position.y - light.radius,
+                         light.position.x + light.radius,
+                         light.position.y + light.radius,
+                         x0,
+                         y0,
+                         x1,
+                         y1);
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                for (int segment : index_cells[y * index_width + x])
+                {
+                    if (segment_stamps[segment] != stamp)
+                    {
+                        segment_stamps[segment] = stamp;
+                        nearby_segments.push_back(segment);
+                    }
+                }
+            }
+        }
+
+        ray_angles.clear();
+        for (int i = 0; i < base_rays; i++)
+        {
+            ray_angles.push_back(i * 2.0f * PI / base_rays - PI);
+        }
+        // Segments of a loop share their corners, so gather the corners once each before casting rays at them.
+        const float radius_sq = light.radius * light.radius;
+        corners.clear();
+        for (int segment : nearby_segments)
+        {
+            for (const Vector2& point : {segment_starts[segment], segment_ends[segment]})
+            {
+                float dx = point.x - light.position.x;
+                float dy = point.y - light.position.y;
+                if (dx * dx + dy * dy <= radius_sq)
+                {
+                    corners.push_back(point);
+                }
+            }
+        }
+        std::sort(corners.begin(),
+                  corners.end(),
+                  [](const Vector2& a, const Vector2& b) { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+        corners.erase(std::unique(corners.begin(),
+                                  corners.end(),
+                                  [](const Vector2& a, const Vector2& b) { return a.x == b.x && a.y == b.y; }),
+                      corners.end());
+        for (const Vector2& corner : corners)
+        {
+            float angle = std::atan2(corner.y - light.position.y, corner.x - light.position.x);
+            ray_angles.push_back(angle - 0.0001f);
+            ray_angles.push_back(angle);
+            ray_angles.push_back(angle + 0.0001f);
+        }
+        std::sort(ray_angles.begin(), ray_angles.end());
+
+        polygon.reserve(ray_angles.size());
+        for (float angle : ray_angles)
+        {
+            Vector2 direction = {std::cos(angle), std::sin(angle)};
+            float closest = light.radius;
+            for (int segment : nearby_segments)
+            {
+                float t =
+                    ray_segment_distance(light.position, direction, segment_starts[segment], segment_ends[segment]);
+                if (t < closest)
+                {
+                    closest = t;
+                }
             }
+            polygon.push_back({light.position.x + direction.x * closest, light.position.y + direction.y * closest});
+        }
+    }
+
+    /**
+     * Find the distance along a ray to a segment.
+     * For internal use only.
+     *
+     * @param origin The start of the ray.
+     * @param direction The unit direction of the ray.
+     * @param a The start of the segment.
+     * @param b The end of the segment.
+     * @return The distance to the segment, or FLT_MAX if the ray misses.
+     */
+    static float ray_segment_distance(Vector2 origin, Vector2 direction, Vector2 a, Vector2 b)
+    {
+        Vector2 edge = {b.x - a.x, b.y - a.y};
+        float denominator = direction.x * edge.y - direction.y * edge.x;
+        if (std::fabs(denominator) < 1e-8f)
+        {
+            return FLT_MAX;
+        }
+        Vector2 to_a = {a.x - origin.x, a.y - origin.y};
+        float t = (to_a.x * edge.y - to_a.y * edge.x) / denominator;
+        float u = (to_a.x * direction.y - to_a.y * direction.x) / denominator;
+        if (t < 0.0f || u < 0.0f || u > 1.0f)
+        {
+            return FLT_MAX;
+        }
+        return t;
+    }
+};
+
+/**
+ * Service for split screen games that share one world.
+ * The level and every game object are drawn once into a world sized render target, then each view copies the part
+ * of it its camera sees into a rectangle of the screen. Adding views costs one textured quad each instead of drawing
+ * the whole scene again. Views do not support camera rotation.
+ */
+class SplitScreenService : public Service
+{
+public:
+    RenderTargetManager* render_targets;
+    int world_target = -1;
+    Rectangle world_bounds = {0, 0, 0, 0};
+
+    virtual ~SplitScreenService()
+    {
+        // Managers outlive scenes, so the manager is still around here.
+        if (world_target >= 0)
+        {
+            render_targets->destroy_target(world_target);
+        }
+    }
+
+    void init() override
+    {
+        render_targets = scene->game->get_manager<RenderTargetManager>();
+        Vector2 size = scene->get_service<LevelService>()->get_size();
+        set_world_bounds({0.0f, 0.0f, size.x, size.y});
+    }
+
+    /**
+     * Set the part of the world that is drawn. Defaults to the level.
+     *
+     * @param bounds The bounds of the world in pixels.
+     */
+    void set_world_bounds(Rectangle bounds)
+    {
+        world_bounds = bounds;
+        if (world_target < 0)
+        {
+            world_target = render_targets->create_target((int)bounds.width, (int)bounds.height);
+        }
+        else
+        {
+            render_targets->resize_target(world_target, (int)bounds.width, (int)bounds.height);
+        }
+    }
+
+    /**
+     * Begin drawing the world. The scene should be drawn between begin_world() and end_world() in world
+     * coordinates, without a camera.
+     *
+     * @param clear_color The color to clear the world with.
+     */
+    void begin_world(Color clear_color = WHITE)
+    {
+        render_targets->begin_target(world_target);
+        ClearBackground(clear_color);
+        rlTranslatef(-world_bounds.x, -world_bounds.y, 0.0f);
+    }
+
+    /**
+     * End drawing the world.
+     */
+    void end_world()
+    {
+        render_targets->end_target(world_target);
+    }
+
+    /**
+     * Draw part of the world into a rectangle of the screen.
+     * Parts of the view outside the world bounds are left undrawn.
+     *
+     * @param view The part of the world to show, in pixels. See CameraObject::get_view_rect().
+     * @param viewport The rectangle of the screen to draw into.
+     */
+    void draw_view(Rectangle view, Rectangle viewport)
+    {
+        if (view.width <= 0.0f || view.height <= 0.0f)
+        {
+            return;
+        }
+
+        // Clip the view to the world so the texture isn't sampled outside its edges.
+        float x0 = std::max(view.x, world_bounds.x);
+        float y0 = std::max(view.y, world_bounds.y);
+        float x1 = std::min(view.x + view.width, world_bounds.x + world_bounds.width);
+        float y1 = std::min(view.y + view.height, world_bounds.y + world_bounds.height);
+        if (x1 <= x0 || y1 <= y0)
+        {
+            return;
+        }
+
+        float scale_x = viewport.width / view.width;
+        float scale_y = viewport.height / view.height;
+        Rectangle region = {x0 - world_bounds.x, y0 - world_bounds.y, x1 - x0, y1 - y0};
+        Rectangle dest = {viewport.x + (x0 - view.x) * scale_x,
+                          viewport.y + (y0 - view.y) * scale_y,
+                          (x1 - x0) * scale_x,
+                          (y1 - y0) * scale_y};
+        render_targets->draw_target_region(world_target, region, dest);
+    }
+
+    /**
+     * Return the world texture to the RenderTargetManager's pool, for when the scene is left.
+     */
+    void release_texture()
+    {
+        render_targets->release_texture(world_target);
+    }
+};
+
+/**
+ * The base class for widgets drawn by the UILayerService.
+ * Widgets are only redrawn when they are marked dirty, so setters should call mark_dirty() when something visible
+ * changes.
+ */
+class UIWidget
+{
+public:
+    Rectangle bounds = {0, 0, 0, 0};
+    bool is_visible = true;
+    bool is_dirty = true;
+
+    // Where the widget was last drawn, so that area is cleared when it moves or hides.
+    Rectangle drawn_bounds = {0, 0, 0, 0};
+
+    UIWidget() = default;
+    virtual ~UIWidget() = default;
+
+    /**
+     * Draw the widget within its bounds.
+     * Called inside the UI layer's render texture, only when the widget or one overlapping it changed.
+     */
+    virtual void draw() {}
+
+    /**
+     * Mark the widget as needing to be redrawn.
+     */
+    void mark_dirty()
+    {
+        is_dirty = true;
+    }
+
+    /**
+     * Set the bounds of the widget.
+     *
+     * @param new_bounds The new bounds in UI layer pixels.
+     */
+    void set_bounds(Rectangle new_bounds)
+    {
+        if (new_bounds.x != bounds.x || new_bounds.y != bounds.y || new_bounds.width != bounds.width ||
+            new_bounds.height != bounds.height)
+        {
+            bounds = new_bounds;
+            mark_dirty();
+        }
+    }
+
+    /**
+     * Show or hide the widget.
+     *
+     * @param visible True to show the widget.
+     */
+    void set_visible(bool visible)
+    {
+        if (visible != is_visible)
+        {
+            is_visible = visible;
+            mark_dirty();
+        }
+    }
+};
+
+/**
+ * A filled rectangle.
+ */
+class UIPanel : public UIWidget
+{
+public:
+    Color color = WHITE;
+
+    /**
+     * Constructor for UIPanel.
+     *
+     * @param bounds The rectangle to fill in UI layer pixels.
+     * @param color The color to fill with.
+     */
+    UIPanel(Rectangle bounds, Color color) : color(color)
+    {
+        this->bounds = bounds;
+    }
+
+    void draw() override
+    {
+        DrawRectangleRec(bounds, color);
+    }
+
+    /**
+     * Set the color of the panel.
+     *
+     * @param new_color The color to fill with.
+     */
+    void set_color(Color new_color)
+    {
+        if (new_color.r != color.r || new_color.g != color.g || new_color.b != color.b || new_color.a != color.a)
+        {
+            color = new_color;
+            mark_dirty();
+        }
+    }
+};
+
+/**
+ * A line of text. Its bounds follow the size of the text.
+ */
+class UILabel : public UIWidget
+{
+public:
+    TextLayout text;
+    Vector2 position = {0, 0};
+    Color color = WHITE;
+
+    /**
+     * Constructor for UILabel.
+     *
+     * @param font The font to draw with.
+     * @param font_size The size of the font.
+     * @param position The top left of the text in UI layer pixels.
+     * @param color The color of the text.
+     * @param shader The shader to draw with, for SDF fonts.
+     */
+    UILabel(Font font, float font_size, Vector2 position, Color color = WHITE, Shader shader = {0}) :
+        text(font, "", font_size),
+        position(position),
+        color(color)
+    {
+        text.shader = shader;
+    }
+
+    void draw() override
+    {
+        text.draw(position, color);
+    }
+
+    /**
+     * Set the text. Only redraws if it changed.
+     *
+     * @param new_text The text to show.
+     */
+    void set_text(const std::string& new_text)
+    {
+        text.set_text(new_text);
+        update_bounds();
+    }
+
+    /**
+     * Set the text from a printf style format and numbers. Only formats and redraws when the numbers change.
+     *
+     * @param format The format string. Must stay alive, string literals are best.
+     * @param values The numbers to format.
+     */
+    template <typename... TArgs>
+    void set_format(const char* format, TArgs... values)
+    {
+        text.set_format(format, values...);
+        update_bounds();
+    }
+
+    /**
+     * Set the position of the text.
+     *
+     * @param new_position The top left of the text in UI layer pixels.
+     */
+    void set_position(Vector2 new_position)
+    {
+        if (new_position.x != position.x || new_position.y != position.y)
+        {
+            position = new_position;
+            text.dirty = true;
+            update_bounds();
+        }
+    }
 
-            // Helper to remove an undirected edge from the set as we consume it
-            auto erase_edge = [&](ldtk::IntPoint p0, ldtk::IntPoint p1) { edges.erase(make_edge(p0, p1)); };
+    /**
+     * Lay the text out again and mark the label dirty if it changed.
+     * For internal use only.
+     */
+    void update_bounds()
+    {
+        if (text.dirty)
+        {
+            Vector2 size = text.get_size();
+            bounds = {position.x, position.y, size.x, size.y};
+            mark_dirty();
+        }
+    }
+};
 
-            // Walk loops
-            std::vector<std::vector<ldtk::IntPoint>> loops;
+/**
+ * Service for a retained mode UI layer.
+ * Widgets are drawn into a cached render texture and only the areas around widgets that changed are redrawn, so a
+ * HUD that isn't changing costs one textured quad per frame. Call draw_ui() after the rest of the scene is drawn.
+ */
+class UILayerService : public Service
+{
+public:
+    RenderTargetManager* render_targets;
+    int ui_target = -1;
+    std::vector<std::unique_ptr<UIWidget>> widgets;
 
-            while (!edges.empty())
-            {
-                // pick an arbitrary remaining edge
-                Edge startE = *edges.begin();
-                ldtk::IntPoint start = startE.a;
-                ldtk::IntPoint cur = startE.b;
-                ldtk::IntPoint prev = start;
+    // The size widgets are laid out in. Zero follows the screen size.
+    Vector2 size = {0, 0};
+    Vector2 current_size = {0, 0};
 
-                std::vector<ldtk::IntPoint> poly;
-                poly.push_back(start);
-                poly.push_back(cur);
-                erase_edge(start, cur);
+    /**
+     * Constructor for UILayerService.
+     *
+     * @param size The size widgets are laid out in, stretched to the screen when drawn. Zero to use the screen size.
+     */
+    UILayerService(Vector2 size = {0, 0}) : size(size) {}
 
-                while (!(cur == start))
-                {
-                    // choose next neighbor that is not prev and still has an edge remaining
-                    const auto& nbs = adj[cur];
-                    ldtk::IntPoint next = prev; // fallback
+    virtual ~UILayerService()
+    {
+        // Managers outlive scenes, so the manager is still around here.
+        if (ui_target >= 0)
+        {
+            render_targets->destroy_target(ui_target);
+        }
+    }
 
-                    bool found = false;
-                    for (const ldtk::IntPoint& cand : nbs)
-                    {
-                        if (cand == prev)
-                            continue;
-                        if (edges.find(make_edge(cur, cand)) != edges.end())
-                        {
-                            next = cand;
-                            found = true;
-                            break;
-                        }
-                    }
+    void init() override
+    {
+        render_targets = scene->game->get_manager<RenderTargetManager>();
+        current_size = get_layer_size();
+        // Fixed resolution so the UI is never drawn at a lower resolution when frames run long.
+        ui_target = render_targets->create_target((int)current_size.x, (int)current_size.y, false, true);
+    }
 
-                    if (!found)
-                    {
-                        // Open chain (should be rare for tile boundaries unless the boundary touches the map edge)
-                        break;
-                    }
+    /**
+     * Create a widget and add it to the layer. Widgets are drawn in the order they are added.
+     *
+     * @param args The arguments to forward to the widget constructor.
+     * @return A pointer to the added widget.
+     */
+    template <typename T, typename... TArgs>
+    T* add_widget(TArgs&&... args)
+    {
+        static_assert(std::is_base_of<UIWidget, T>::value, "T must derive from UIWidget");
+        auto widget = std::make_unique<T>(std::forward<TArgs>(args)...);
+        T* widget_ptr = widget.get();
+        widgets.push_back(std::move(widget));
+        return widget_ptr;
+    }
 
-                    prev = cur;
-                    cur = next;
-                    poly.push_back(cur);
-                    erase_edge(prev, cur);
+    /**
+     * Get the size widgets are laid out in.
+     *
+     * @return The size in pixels.
+     */
+    Vector2 get_layer_size() const
+    {
+        if (size.x > 0.0f && size.y > 0.0f)
+        {
+            return size;
+        }
+        return {(float)GetScreenWidth(), (float)GetScreenHeight()};
+    }
 
-                    // safety guard to avoid infinite loops on bad topology
-                    if (poly.size() > 100000)
-                        break;
-                }
+    /**
+     * Redraw the parts of the layer that changed, then draw the layer over the screen.
+     */
+    void draw_ui()
+    {
+        Vector2 layer_size = get_layer_size();
+        bool redraw_all = layer_size.x != current_size.x || layer_size.y != current_size.y ||
+                          render_targets->targets[ui_target].texture.id == 0;
+        if (layer_size.x != current_size.x || layer_size.y != current_size.y)
+        {
+            current_size = layer_size;
+            render_targets->resize_target(ui_target, (int)layer_size.x, (int)layer_size.y);
+        }
 
-                // If closed, last vertex == start; Box2D chains usually want NOT duplicated end vertex.
-                if (!poly.empty() && poly.back() == poly.front())
-                {
-                    poly.pop_back();
-                }
+        // The area to redraw covers where dirty widgets were and where they are now.
+        Rectangle region = {0, 0, 0, 0};
+        bool has_region = false;
+        auto add_to_region = [&](Rectangle rect)
+        {
+            if (rect.width <= 0.0f || rect.height <= 0.0f)
+            {
+                return;
+            }
+            if (!has_region)
+            {
+                region = rect;
+                has_region = true;
+                return;
+            }
+            float x0 = std::min(region.x, rect.x);
+            float y0 = std::min(region.y, rect.y);
+            float x1 = std::max(region.x + region.width, rect.x + rect.width);
+            float y1 = std::max(region.y + region.height, rect.y + rect.height);
+            region = {x0, y0, x1 - x0, y1 - y0};
+        };
 
-                // Only keep valid chains
-                if (poly.size() >= 3)
+        if (redraw_all)
+        {
+            add_to_region({0, 0, layer_size.x, layer_size.y});
+        }
+        else
+        {
+            for (auto& widget : widgets)
+            {
+                if (widget->is_dirty)
                 {
-                    // If we're not solid on the right, then we wrapped the wrong way.
-                    if (!loop_has_solid_on_right(poly, layer))
+                    add_to_region(widget->drawn_bounds);
+                    if (widget->is_visible)
                     {
-                        std::reverse(poly.begin(), poly.end());
+                        add_to_region(widget->bounds);
                     }
-
-                    // Not really necessary but here we reduce the number of points on a line to just the ends.
-                    // std::vector<ldtk::IntPoint> reduced;
-                    // reduced.push_back(poly[0]);
-                    // b2Vec2 original_normal = {0, 0};
-                    // for (int i = 1; i < poly.size(); i++)
-                    // {
-                    //     auto first = poly[i - 1];
-                    //     auto second = poly[i];
-                    //     float length = sqrt((second.x - first.x) * (second.x - first.x) +
-                    //                         (second.y - first.y) * (second.y - first.y));
-                    //     b2Vec2 normal = {(second.x - first.x) / length, (second.y - first.y) / length};
-                    //     if (length == 0)
-                    //     {
-                    //         normal = {0, 0};
-                    //     }
-                    //     if (i == 1)
-                    //     {
-                    //         original_normal = normal;
-                    //     }
-
-                    //     if (normal != original_normal)
-                    //     {
-                    //         reduced.push_back(first);
-                    //         original_normal = normal;
-                    //     }
-                    // }
-                    // reduced.push_back(poly.back());
-                    // loops.push_back(std::move(reduced));
-
-                    loops.push_back(std::move(poly));
                 }
             }
+        }
 
-            b2BodyDef bd = b2DefaultBodyDef();
-            bd.type = b2_staticBody;
-            bd.position = {0, 0};
-            assert(b2World_IsValid(physics->world));
-            b2BodyId layer_body = b2CreateBody(physics->world, &bd);
+        if (has_region)
+        {
+            redraw(region);
+        }
 
-            for (auto& loop : loops)
-            {
-                std::vector<b2Vec2> verts;
-                verts.reserve(loop.size());
+        // The layer holds premultiplied colors, see redraw().
+        BeginBlendMode(BLEND_ALPHA_PREMULTIPLY);
+        render_targets->draw_target(ui_target, {0, 0, (float)GetScreenWidth(), (float)GetScreenHeight()});
+        EndBlendMode();
+    }
 
-                for (auto& p : loop)
-                {
-                    float xpx = p.x * layer.getCellSize() * scale;
-                    float ypx = p.y * layer.getCellSize() * scale;
-                    verts.push_back(physics->convert_to_meters({xpx, ypx}));
-                }
+    /**
+     * Return the layer's texture to the RenderTargetManager's pool, for when the scene is left.
+     * Everything is redrawn the next time the layer is drawn.
+     */
+    void release_texture()
+    {
+        render_targets->release_texture(ui_target);
+    }
 
-                std::vector<b2SurfaceMaterial> mats;
-                for (int i = 0; i < verts.size(); i++)
-                {
-                    b2SurfaceMaterial mat = b2DefaultSurfaceMaterial();
-                    mat.friction = 0.1f;
-                    mat.restitution = 0.1f;
-                    mats.push_back(mat);
-                }
+    /**
+     * Clear and redraw the widgets in part of the layer.
+     * For internal use only.
+     *
+     * @param region The area to redraw in UI layer pixels.
+     */
+    void redraw(Rectangle region)
+    {
+        // Whole pixels, grown outwards so antialiased edges are included.
+        int x0 = std::max(0, (int)std::floor(region.x) - 1);
+        int y0 = std::max(0, (int)std::floor(region.y) - 1);
+        int x1 = std::min((int)current_size.x, (int)std::ceil(region.x + region.width) + 1);
+        int y1 = std::min((int)current_size.y, (int)std::ceil(region.y + region.height) + 1);
+        if (x1 <= x0 || y1 <= y0)
+        {
+            return;
+        }
+        Rectangle clip = {(float)x0, (float)y0, (float)(x1 - x0), (float)(y1 - y0)};
 
-                b2ChainDef cd = b2DefaultChainDef();
-                cd.points = verts.data();
-                cd.count = (int)verts.size();
-                cd.materials = mats.data();
-                cd.materialCount = (int)mats.size();
-                cd.isLoop = true;
-                b2CreateChain(layer_body, &cd);
+        render_targets->begin_target(ui_target);
+        BeginScissorMode(x0, y0, x1 - x0, y1 - y0);
+        ClearBackground(BLANK);
 
-                layer_bodies.push_back(layer_body);
+        // Blend color as usual but add up alpha, so the texture holds premultiplied colors with the right coverage
+        // and can be drawn over the scene without darkening translucent widgets.
+        rlSetBlendFactorsSeparate(
+            RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE, RL_ONE_MINUS_SRC_ALPHA, RL_FUNC_ADD, RL_FUNC_ADD);
+        BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+        for (auto& widget : widgets)
+        {
+            if (widget->is_visible && CheckCollisionRecs(widget->bounds, clip))
+            {
+                widget->draw();
+            }
+            if (CheckCollisionRecs(widget->bounds, clip) || CheckCollisionRecs(widget->drawn_bounds, clip))
+            {
+                widget->drawn_bounds = widget->is_visible ? widget->bounds : Rectangle{0, 0, 0, 0};
+                widget->is_dirty = false;
             }
         }
+        EndBlendMode();
+
+        EndScissorMode();
+        render_targets->end_target(ui_target);
     }
+};
+
+/**
+ * Contiguous storage for game objects of one type created together.
+ * Game objects handed out by the pool share ownership of it, so the block is freed once the last one is released.
+ */
+template <typename T>
+class GameObjectPool
+{
+public:
+    T* data = nullptr;
+    int capacity = 0;
+    int count = 0;
 
     /**
-     * Draw the level.
-     * Draws all the layer renderers.
+     * Constructor for GameObjectPool.
+     *
+     * @param capacity The number of game objects to allocate space for.
      */
-    void draw() override
+    GameObjectPool(int capacity) : capacity(capacity)
     {
-        // Draw renderers in reverse.
-        for (int i = (int)renderers.size() - 1; i >= 0; i--)
+        if (capacity > 0)
         {
-            const auto& layer_renderer = renderers[i];
-            if (!layer_renderer.visible)
-            {
-                continue;
-            }
-            const auto& renderer = layer_renderer.renderer;
-            Rectangle src = {0,
-                             0,
-                             static_cast<float>(renderer.texture.width),
-                             -static_cast<float>(renderer.texture.height)};
-            Rectangle dest = {0,
-                              0,
-                              static_cast<float>(renderer.texture.width) * scale,
-                              static_cast<float>(renderer.texture.height) * scale};
-            DrawTexturePro(renderer.texture, src, dest, {0}, .0f, WHITE);
+            data = std::allocator<T>().allocate(capacity);
+        }
+    }
+
+    ~GameObjectPool()
+    {
+        for (int i = 0; i < count; i++)
+        {
+            data[i].~T();
+        }
+        if (data)
+        {
+            std::allocator<T>().deallocate(data, capacity);
         }
     }
 
+    GameObjectPool(const GameObjectPool&) = delete;
+    GameObjectPool& operator=(const GameObjectPool&) = delete;
+
     /**
-     * Draw a specific layer by its IID.
+     * Construct a game object in the next free slot.
      *
-     * @param layer_id The IID of the layer.
+     * @param args The arguments to forward to the game object constructor.
+     * @return A pointer to the game object, or nullptr if the pool is full.
      */
-    void draw_layer(ldtk::IID layer_id)
+    template <typename... TArgs>
+    T* emplace(TArgs&&... args)
     {
-        for (const auto& layer_renderer : renderers)
+        if (count >= capacity)
         {
-            if (layer_renderer.layer_iid == layer_id)
-            {
-                const auto& renderer = layer_renderer.renderer;
-                Rectangle src = {0,
-                                 0,
-                                 static_cast<float>(renderer.texture.width),
-                                 -static_cast<float>(renderer.texture.height)};
-                Rectangle dest = {0,
-                                  0,
-                                  static_cast<float>(renderer.texture.width) * scale,
-                                  static_cast<float>(renderer.texture.height) * scale};
-                DrawTexturePro(renderer.texture, src, dest, {0}, .0f, WHITE);
-                return;
-            }
+            return nullptr;
         }
+        T* object = new (data + count) T(std::forward<TArgs>(args)...);
+        count++;
+        return object;
     }
+};
+
+/**
+ * A batch of game objects of one type spawned from LDtk entities.
+ * Passed to the factories registered with EntityFactoryService.
+ */
+template <typename T>
+class SpawnBatch
+{
+public:
+    Scene* scene;
+    LevelService* level;
+    std::shared_ptr<GameObjectPool<T>> pool;
+    std::vector<std::tuple<std::type_index, Service*>> services;
 
     /**
-     * Draw a specific layer by its name.
+     * Constructor for SpawnBatch.
      *
-     * @param layer_name The name of the layer.
+     * @param scene The scene to add game objects to.
+     * @param level The level the entities come from.
+     * @param capacity The number of game objects expected in the batch.
      */
-    void draw_layer(std::string layer_name)
+    SpawnBatch(Scene* scene, LevelService* level, int capacity) :
+        scene(scene),
+        level(level),
+        pool(std::make_shared<GameObjectPool<T>>(capacity))
     {
-        const auto& level = get_level();
-        const auto& layer = level.getLayer(layer_name);
-        draw_layer(layer.iid);
     }
 
     /**
-     * Check if a cell in the layer is solid.
-     * Used for collision generation.
+     * Get a service from the scene, looked up once per batch.
+     * Pass the result to game object constructors instead of having each object look it up in init().
      *
-     * @param layer The LDtk layer.
-     * @param x The x coordinate of the cell.
-     * @param y The y coordinate of the cell.
-     * @param size The size of the layer in cells.
+     * @return A pointer to the service.
      */
-    bool is_solid(const ldtk::Layer& layer, int x, int y, const ldtk::IntPoint& size)
+    template <typename S>
+    S* get_service()
     {
-        if (x < 0 || y < 0 || x >= size.x || y >= size.y)
-        {
-            return false;
-        }
-
-        std::string name = layer.getIntGridVal(x, y).name;
-        if (std::find(collision_names.begin(), collision_names.end(), name) != collision_names.end())
+        for (auto& service : services)
         {
-            return true;
+            if (std::get<0>(service) == std::type_index(typeid(S)))
+            {
+                return static_cast<S*>(std::get<1>(service));
+            }
         }
-        return false;
-    };
+        S* service = scene->get_service<S>();
+        services.push_back({std::type_index(typeid(S)), service});
+        return service;
+    }
 
     /**
-     * Check if there is solid on the right side of a loop of corners.
-     * Used to determine loop winding.
+     * Create a game object from the batch pool and add it to the scene.
      *
-     * @param loop_corners The corners of the loop.
-     * @param layer The LDtk layer.
-     * @return True if there is solid on the right side of the loop, false otherwise.
+     * @param args The arguments to forward to the game object constructor.
+     * @return A pointer to the added game object.
      */
-    bool loop_has_solid_on_right(const std::vector<ldtk::IntPoint>& loop_corners, const ldtk::Layer& layer)
+    template <typename... TArgs>
+    std::shared_ptr<T> spawn(TArgs&&... args)
     {
-        const int cell_size = layer.getCellSize();
-
-        // Pick an edge with non-zero length.
-        int n = (int)loop_corners.size();
-        for (int i = 0; i < n; ++i)
+        std::shared_ptr<T> new_object;
+        T* pooled = pool->emplace(std::forward<TArgs>(args)...);
+        if (pooled)
         {
-            ldtk::IntPoint a = loop_corners[i];
-            ldtk::IntPoint b = loop_corners[(i + 1) % n];
-            int dx = b.x - a.x;
-            int dy = b.y - a.y;
-            if (dx == 0 && dy == 0)
-                continue;
-
-            // Convert corner coords to scaled pixel coords.
-            float ax = a.x * cell_size * scale;
-            float ay = a.y * cell_size * scale;
-            float bx = b.x * cell_size * scale;
-            float by = b.y * cell_size * scale;
-
-            // Edge direction.
-            float ex = bx - ax;
-            float ey = by - ay;
-            float len = std::sqrt(ex * ex + ey * ey);
-            if (len < 1e-4f)
-            {
-                continue;
-            }
-            ex /= len;
-            ey /= len;
-
-            // Right normal = (-ey, ex)
-            float rx = -ey;
-            float ry = ex;
-
-            // Midpoint of the edge.
-            float mx = 0.5f * (ax + bx);
-            float my = 0.5f * (ay + by);
-
-            // Sample a point slightly to the right, a quarter cell away.
-            float eps = 0.25f * cell_size * scale;
-            float sx = mx + rx * eps;
-            float sy = my + ry * eps;
+            // Shares ownership of the pool rather than owning the object.
+            new_object = std::shared_ptr<T>(pool, pooled);
+        }
+        else
+        {
+            // A factory spawned more than one object for an entity.
+            new_object = std::make_shared<T>(std::forward<TArgs>(args)...);
+        }
+        scene->add_game_object(new_object);
+        return new_object;
+    }
+};
 
-            // Map sample pixel to grid cell.
-            int gx = (int)std::floor(sx / (cell_size * scale));
-            int gy = (int)std::floor(sy / (cell_size * scale));
+/**
+ * Service for creating game objects from the entities in an LDtk level.
+ * Register a factory per entity identifier, then call spawn_entities() from the scene's init().
+ * Depends on LevelService.
+ */
+class EntityFactoryService : public Service
+{
+public:
+    LevelService* level;
 
-            return is_solid(layer, gx, gy, layer.getGridSize());
-        }
+    // Factories by entity identifier. Each one receives every matching entity at once.
+    std::vector<std::tuple<std::string, std::function<void(const std::vector<const ldtk::Entity*>&)>>> factories;
 
-        // Fallback: if degenerate, say false
-        return false;
+    void init() override
+    {
+        level = scene->get_service<LevelService>();
     }
 
     /**
-     * Set the visibility of a layer by its IID.
+     * Register a factory for an LDtk entity identifier.
      *
-     * @param layer_id The IID of the layer.
-     * @param visible True to make the layer visible, false to hide it.
+     * @param identifier The name of the entity in LDtk.
+     * @param factory The function called for each entity, given the batch to spawn into and the entity.
      */
-    void set_layer_visibility(ldtk::IID layer_id, bool visible)
+    template <typename T>
+    void register_factory(const std::string& identifier,
+                          std::function<void(SpawnBatch<T>&, const ldtk::Entity&)> factory)
     {
-        for (auto& layer_renderer : renderers)
-        {
-            if (layer_renderer.layer_iid == layer_id)
-            {
-                layer_renderer.visible = visible;
-                return;
-            }
-        }
+        static_assert(std::is_base_of<GameObject, T>::value, "T must derive from GameObject");
+        factories.push_back({identifier,
+                             [this, factory](const std::vector<const ldtk::Entity*>& entities)
+                             {
+                                 SpawnBatch<T> batch(scene, level, (int)entities.size());
+                                 for (auto entity : entities)
+                                 {
+                                     factory(batch, *entity);
+                                 }
+                             }});
     }
 
     /**
-     * Set the visibility of a layer by its name.
-     *
-     * @param layer_name The name of the layer.
-     * @param visible True to make the layer visible, false to hide it.
+     * Create game objects for every entity in the level with a registered factory.
+     * Game objects are added to the scene but not initialized, so call this from the scene's init().
      */
-    void set_layer_visibility(std::string layer_name, bool visible)
+    void spawn_entities()
     {
-        const auto& level = get_level();
-        const auto& layer = level.getLayer(layer_name);
-        for (auto& layer_renderer : renderers)
+        std::unordered_map<std::string, int> factory_indices;
+        factory_indices.reserve(factories.size());
+        for (int i = 0; i < (int)factories.size(); i++)
         {
-            if (layer_renderer.layer_iid == layer.iid)
+            factory_indices[std::get<0>(factories[i])] = i;
+        }
+
+        // Sort entities into batches in a single pass.
+        std::vector<std::vector<const ldtk::Entity*>> batches(factories.size());
+        int total = 0;
+        for (auto entity : level->get_entities())
+        {
+            auto it = factory_indices.find(entity->getName());
+            if (it == factory_indices.end())
             {
-                layer_renderer.visible = visible;
-                return;
+                continue;
+            }
+            batches[it->second].push_back(entity);
+            total++;
+        }
+
+        scene->game_objects.reserve(scene->game_objects.size() + total);
+        for (int i = 0; i < (int)factories.size(); i++)
+        {
+            if (!batches[i].empty())
+            {
+                std::get<1>(factories[i])(batches[i]);
             }
         }
     }
+};
+
+/**
+ * A level tracked by the WorldStreamingService.
+ */
+struct StreamedLevel
+{
+    const ldtk::Level* level = nullptr;
+
+    // The level bounds in world pixels.
+    Rectangle bounds = {0, 0, 0, 0};
+
+    // Collision loops for each tileset layer, built on the worker thread.
+    std::vector<std::vector<std::vector<ldtk::IntPoint>>> layer_loops;
+    std::future<void> build_job;
+    bool is_building = false;
+    bool is_built = false;
+
+    // Render textures, collision bodies, and game objects that exist while the level is loaded.
+    std::vector<LayerRenderer> renderers;
+    std::vector<b2BodyId> bodies;
+    std::vector<std::shared_ptr<GameObject>> game_objects;
+    bool is_loaded = false;
+};
+
+/**
+ * Service for streaming the levels of a whole LDtk world around one or more focus areas, usually cameras.
+ * Levels near a focus area are loaded with their textures, collision bodies, and game objects. Their neighbours
+ * have their collision built ahead of time on a worker thread, and levels that move far away are unloaded.
+ * Depends on TextureService and PhysicsService.
+ */
+class WorldStreamingService : public Service
+{
+public:
+    ldtk::Project project;
+    std::string project_file;
+    std::string world_name;
+    std::vector<std::string> collision_names;
+    float scale = 1.0f;
+    PhysicsService* physics;
+    TextureService* texture_service;
 
-    /**
-     * Get the LDtk world.
-     *
-     * @return A reference to the LDtk world.
-     */
-    const ldtk::World& get_world()
-    {
-        return project.getWorld();
-    }
+    std::vector<StreamedLevel> levels;
+    std::unordered_map<const ldtk::Level*, int> level_indices;
+
+    // Focus areas in world pixels. Levels overlapping these, plus the load margin, are loaded.
+    std::vector<Rectangle> focus_areas;
+
+    // Distance in pixels around the focus areas where levels are loaded.
+    float load_margin = 128.0f;
+
+    // Distance in pixels around the focus areas where loaded levels are kept. Larger than load_margin so levels
+    // on the boundary don't load and unload every frame.
+    float unload_margin = 512.0f;
+
+    // The most levels that are uploaded to the GPU and physics world in one frame.
+    // Levels overlapping a focus area are always loaded immediately.
+    int max_loads_per_frame = 1;
+
+    // Called when a level is loaded. Add game objects for the level's entities to the vector and they will be
+    // added to the scene, initialized, and removed again when the level unloads.
+    std::function<void(const ldtk::Level& level, Vector2 offset, std::vector<std::shared_ptr<GameObject>>& objects)>
+        on_level_loaded;
+
+    // Called just before a level is unloaded.
+    std::function<void(const ldtk::Level& level)> on_level_unloaded;
+
+    // Declared last so the worker is joined before the levels it writes to are destroyed.
+    ThreadPool worker{1};
 
     /**
-     * Get the LDtk level.
+     * Constructor for WorldStreamingService.
      *
-     * @return A reference to the LDtk level.
+     * @param project_file The path to the LDtk project file.
+     * @param collision_names The names of the IntGrid values to create collision bodies for.
+     * @param scale The scale factor for the world.
+     * @param world_name The name of the world in the project, empty for the default world.
      */
-    const ldtk::Level& get_level()
+    WorldStreamingService(std::string project_file,
+                          std::vector<std::string> collision_names,
+                          float scale = 1.0f,
+                          std::string world_name = "") :
+        project_file(project_file),
+        world_name(world_name),
+        collision_names(collision_names),
+        scale(scale)
     {
-        const auto& world = project.getWorld();
-        return world.getLevel(level_name);
     }
 
-    /**
-     * Get the level size in pixels.
-     *
-     * @return A Vector2 containing the size of the level.
-     */
-    Vector2 get_size()
+    virtual ~WorldStreamingService()
     {
-        const auto& level = get_level();
-        return {level.size.x * scale, level.size.y * scale};
+        for (int i = 0; i < (int)levels.size(); i++)
+        {
+            if (levels[i].is_building)
+            {
+                levels[i].build_job.wait();
+            }
+            // The scene is being destroyed, so only release what the service owns.
+            for (auto& layer_renderer : levels[i].renderers)
+            {
+                UnloadRenderTexture(layer_renderer.renderer);
+            }
+            for (auto& body : levels[i].bodies)
+            {
+                if (b2Body_IsValid(body))
+                {
+                    b2DestroyBody(body);
+                }
+            }
+        }
     }
 
     /**
-     * Get a layer by its name.
-     *
-     * @param name The name of the layer.
-     * @return A reference to the LDtk layer.
+     * Initialize the streaming service.
+     * Loads the LDtk project. Levels are loaded on update once focus areas are set.
      */
-    const ldtk::Layer& get_layer_by_name(const std::string& name)
+    void init() override
     {
-        const auto& level = get_level();
-        return level.getLayer(name);
+        if (!FileExists(project_file.c_str()))
+        {
+            TraceLog(LOG_FATAL, "LDtk file not found: %s", project_file.c_str());
+        }
+        project.loadFromFile(project_file);
+
+        physics = scene->get_service<PhysicsService>();
+        texture_service = scene->get_service<TextureService>();
+
+        const auto& world = project.getWorld(world_name);
+        const auto& all_levels = world.allLevels();
+        levels.resize(all_levels.size());
+        level_indices.reserve(all_levels.size());
+        for (int i = 0; i < (int)all_levels.size(); i++)
+        {
+            const auto& level = all_levels[i];
+            levels[i].level = &level;
+            levels[i].bounds = {level.position.x * scale,
+                                level.position.y * scale,
+                                level.size.x * scale,
+                                level.size.y * scale};
+            level_indices[&level] = i;
+        }
     }
 
     /**
-     * Get all entities across all layers in the level.
+     * Stream levels in and out around the focus areas.
      *
-     * @return A vector of LDtk entities.
+     * @param delta_time The time elapsed since the last frame.
      */
-    std::vector<const ldtk::Entity*> get_entities()
+    void update(float delta_time) override
     {
-        if (!is_init)
+        // Pick up finished worker jobs.
+        for (auto& streamed : levels)
         {
-            TraceLog(LOG_ERROR, "LDtk project not loaded.");
-            return {};
+            if (streamed.is_building &&
+                streamed.build_job.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            {
+                streamed.is_building = false;
+                streamed.is_built = true;
+            }
         }
-        const auto& level = get_level();
-        const auto& layers = level.allLayers();
 
-        std::vector<const ldtk::Entity*> entities;
-
-        for (const auto& layer : layers)
+        std::vector<int> wanted;
+        std::vector<char> is_prefetched(levels.size(), 0);
+        for (int i = 0; i < (int)levels.size(); i++)
         {
-            const auto& layer_entities = layer.allEntities();
+            auto& streamed = levels[i];
+            bool is_near = overlaps_focus(streamed.bounds, load_margin);
+            if (streamed.is_loaded && !overlaps_focus(streamed.bounds, unload_margin))
+            {
+                unload_level(i);
+            }
+            if (!is_near)
+            {
+                continue;
+            }
+            wanted.push_back(i);
 
-            entities.reserve(entities.size() + layer_entities.size());
-            for (const auto& entity : layer_entities)
+            // Build neighbours ahead of time so walking into them doesn't hitch.
+            for (auto dir : {ldtk::Dir::North, ldtk::Dir::East, ldtk::Dir::South, ldtk::Dir::West})
             {
-                entities.push_back(&entity);
+                for (const auto* neighbour : streamed.level->getNeighbours(dir))
+                {
+                    auto it = level_indices.find(neighbour);
+                    if (it != level_indices.end())
+                    {
+                        is_prefetched[it->second] = 1;
+                    }
+                }
             }
         }
 
-        return entities;
-    }
-
-    /**
-     * Get all entities across all layers in the level with the given name.
-     *
-     * @param name The name of the entities to get.
-     * @return A vector of LDtk entities.
-     */
-    std::vector<const ldtk::Entity*> get_entities_by_name(const std::string& name)
-    {
-        if (!is_init)
+        for (int i : wanted)
         {
-            TraceLog(LOG_ERROR, "LDtk project not loaded.");
-            return {};
+            is_prefetched[i] = 1;
         }
-        const auto& level = get_level();
-        const auto& layers = level.allLayers();
 
-        std::vector<const ldtk::Entity*> entities;
+        for (int i = 0; i < (int)levels.size(); i++)
+        {
+            auto& streamed = levels[i];
+            if (is_prefetched[i])
+            {
+                if (!streamed.is_built && !streamed.is_building)
+                {
+                    start_build(i);
+                }
+            }
+            else if (!streamed.is_loaded && streamed.is_built)
+            {
+                // Far away and not loaded, so the prebuilt collision data is no longer worth keeping.
+                streamed.layer_loops.clear();
+                streamed.layer_loops.shrink_to_fit();
+                streamed.is_built = false;
+            }
+        }
 
-        for (const auto& layer : layers)
+        int loads = 0;
+        for (int i : wanted)
         {
-            const auto& layer_entities = layer.getEntitiesByName(name);
+            auto& streamed = levels[i];
+            if (streamed.is_loaded)
+            {
+                continue;
+            }
 
-            entities.reserve(entities.size() + layer_entities.size());
-            for (const auto& entity : layer_entities)
+            // Levels under a focus area can't wait a frame, the player would fall through them.
+            bool is_critical = overlaps_focus(streamed.bounds, 0.0f);
+            if (!is_critical && (loads >= max_loads_per_frame || !streamed.is_built))
+            {
+                continue;
+            }
+            if (streamed.is_building)
             {
-                entities.push_back(&entity.get());
+                streamed.build_job.wait();
+                streamed.is_building = false;
+                streamed.is_built = true;
             }
+            load_level(i);
+            loads++;
         }
-
-        return entities;
     }
 
     /**
-     * Get all entities across all layers in the level with the given tag.
-     *
-     * @param tag The tag of the entities to get.
-     * @return A vector of LDtk entities.
+     * Draw all loaded levels.
      */
-    std::vector<const ldtk::Entity*> get_entities_by_tag(const std::string& tag)
+    void draw() override
     {
-        if (!is_init)
-        {
-            TraceLog(LOG_ERROR, "LDtk project not loaded.");
-            return {};
-        }
-        const auto& level = get_level();
-        const auto& layers = level.allLayers();
-
-        std::vector<const ldtk::Entity*> entities;
-
-        for (const auto& layer : layers)
+        for (const auto& streamed : levels)
         {
-            const auto& layer_entities = layer.getEntitiesByTag(tag);
-
-            entities.reserve(entities.size() + layer_entities.size());
-            for (const auto& entity : layer_entities)
+            if (!streamed.is_loaded)
+            {
+                continue;
+            }
+            // Draw renderers in reverse.
+            for (int i = (int)streamed.renderers.size() - 1; i >= 0; i--)
             {
-                entities.push_back(&entity.get());
+                const auto& layer_renderer = streamed.renderers[i];
+                if (!layer_renderer.visible)
+                {
+                    continue;
+                }
+                const auto& renderer = layer_renderer.renderer;
+                Rectangle src = {0,
+                                 0,
+                                 static_cast<float>(renderer.texture.width),
+                                 -static_cast<float>(renderer.texture.height)};
+                DrawTexturePro(renderer.texture, src, streamed.bounds, {0}, .0f, WHITE);
             }
         }
+    }
 
-        return entities;
+    /**
+     * Set a single focus area.
+     *
+     * @param area The focus area in world pixels.
+     */
+    void set_focus(Rectangle area)
+    {
+        focus_areas.assign(1, area);
     }
 
     /**
-     * Get the first entity across all layers in the level with the given name.
+     * Set a single focus area from a center and size, e.g. a camera target and view size.
      *
-     * @param name The name of the entity to get.
-     * @return A pointer to the LDtk entity, or nullptr if not found.
+     * @param center The center of the area in world pixels.
+     * @param size The size of the area in pixels.
      */
-    const ldtk::Entity* get_entity_by_name(const std::string& name)
+    void set_focus(Vector2 center, Vector2 size)
     {
-        auto entities = get_entities_by_name(name);
-        if (entities.empty())
-        {
-            return nullptr;
-        }
+        set_focus(Rectangle{center.x - size.x / 2.0f, center.y - size.y / 2.0f, size.x, size.y});
+    }
 
-        return entities[0];
+    /**
+     * Set multiple focus areas, e.g. one per split screen camera.
+     *
+     * @param areas The focus areas in world pixels.
+     */
+    void set_focus(const std::vector<Rectangle>& areas)
+    {
+        focus_areas = areas;
     }
 
     /**
-     * Get the first entity across all layers in the level with the given tag.
+     * Get the level containing a point.
      *
-     * @param tag The tag of the entity to get.
-     * @return A pointer to the LDtk entity, or nullptr if not found.
+     * @param pixels The point in world pixels.
+     * @return A pointer to the LDtk level, or nullptr if no level contains the point.
      */
-    const ldtk::Entity* get_entity_by_tag(const std::string& tag)
+    const ldtk::Level* get_level_at(Vector2 pixels) const
     {
-        auto entities = get_entities_by_tag(tag);
-        if (entities.empty())
+        for (const auto& streamed : levels)
         {
-            return nullptr;
+            const auto& b = streamed.bounds;
+            if (pixels.x >= b.x && pixels.y >= b.y && pixels.x < b.x + b.width && pixels.y < b.y + b.height)
+            {
+                return streamed.level;
+            }
         }
-
-        return entities[0];
+        return nullptr;
     }
 
     /**
-     * Convert a grid point to pixels.
+     * Check if a level is currently loaded.
      *
-     * @param point The grid point to convert.
-     * @return A Vector2 containing the point in pixels.
+     * @param level The LDtk level.
+     * @return True if the level is loaded, false otherwise.
      */
-    Vector2 convert_to_pixels(const ldtk::IntPoint& point) const
+    bool is_level_loaded(const ldtk::Level& level) const
     {
-        return {point.x * scale, point.y * scale};
+        auto it = level_indices.find(&level);
+        return it != level_indices.end() && levels[it->second].is_loaded;
     }
 
     /**
-     * Convert a cell point to pixels.
+     * Get the offset of a level in world pixels.
+     * Add this to converted entity positions to place them in the world.
      *
-     * @param cell_point The cell point to convert.
-     * @param layer The LDtk layer the cell point is in.
+     * @param level The LDtk level.
+     * @return The top left of the level in world pixels.
      */
-    Vector2 convert_cells_to_pixels(const ldtk::IntPoint& cell_point, const ldtk::Layer& layer) const
+    Vector2 get_level_offset(const ldtk::Level& level) const
     {
-        float cell_size = static_cast<float>(layer.getCellSize());
-        return {cell_point.x * cell_size * scale, cell_point.y * cell_size * scale};
+        return {level.position.x * scale, level.position.y * scale};
     }
 
     /**
-     * Convert a grid point to meters.
+     * Convert a level-local grid point to world pixels.
      *
+     * @param level The LDtk level the point is in.
      * @param point The grid point to convert.
-     * @return A b2Vec2 containing the point in meters.
+     * @return A Vector2 containing the point in world pixels.
      */
-    b2Vec2 convert_to_meters(const ldtk::IntPoint& point) const
+    Vector2 convert_to_pixels(const ldtk::Level& level, const ldtk::IntPoint& point) const
     {
-        return physics->convert_to_meters(convert_to_pixels(point));
+        return get_level_offset(level) + Vector2{point.x * scale, point.y * scale};
     }
 
     /**
-     * Convert pixels to a grid point.
+     * Check if a rectangle overlaps any focus area grown by a margin.
+     * For internal use only.
      *
-     * @param pixels The pixel position to convert.
-     * @return An IntPoint containing the point in grid coordinates.
+     * @param bounds The rectangle in world pixels.
+     * @param margin The margin in pixels.
+     * @return True if they overlap, false otherwise.
      */
-    ldtk::IntPoint convert_to_grid(const Vector2& pixels) const
+    bool overlaps_focus(const Rectangle& bounds, float margin) const
     {
-        return {static_cast<int>(pixels.x / scale), static_cast<int>(pixels.y / scale)};
+        for (const auto& area : focus_areas)
+        {
+            Rectangle grown = {
+                area.x - margin, area.y - margin, area.width + margin * 2.0f, area.height + margin * 2.0f};
+            if (CheckCollisionRecs(bounds, grown))
+            {
+                return true;
+            }
+        }
+        return false;
     }
 
     /**
-     * Convert meters to a grid point.
+     * Build a level's collision loops on the worker thread.
+     * For internal use only.
      *
-     * @param meters The meter position to convert.
-     * @return An IntPoint containing the point in grid coordinates.
+     * @param index The index of the level.
      */
-    ldtk::IntPoint convert_to_grid(const b2Vec2& meters) const
+    void start_build(int index)
     {
-        auto pixels = physics->convert_to_pixels(meters);
-        return {static_cast<int>(pixels.x / scale), static_cast<int>(pixels.y / scale)};
+        auto& streamed = levels[index];
+        streamed.is_building = true;
+        streamed.layer_loops.clear();
+        // Only the worker touches layer_loops until the job is finished. The project is read only after init.
+        streamed.build_job = worker.submit(
+            [this, index]()
+            {
+                auto& target = levels[index];
+                for (const auto& layer : target.level->allLayers())
+                {
+                    if (layer.hasTileset())
+                    {
+                        target.layer_loops.push_back(build_collision_loops(layer, collision_names));
+                    }
+                }
+            });
     }
 
     /**
-     * Get the position of an entity in pixels.
+     * Create a built level's textures, bodies, and game objects.
+     * Textures and bodies must be created on the main thread.
+     * For internal use only.
      *
-     * @param entity The entity to get the position of.
-     * @return A Vector2 containing the position of the entity in pixels.
+     * @param index The index of the level.
      */
-    Vector2 get_entity_position(ldtk::Entity* entity)
+    void load_level(int index)
     {
-        return convert_to_pixels(entity->getPosition());
+        auto& streamed = levels[index];
+        const auto& level = *streamed.level;
+        Vector2 offset = get_level_offset(level);
+        auto directory = std::string(GetDirectoryPath(project_file.c_str()));
+
+        int layer_index = 0;
+        for (const auto& layer : level.allLayers())
+        {
+            if (!layer.hasTileset())
+            {
+                continue;
+            }
+
+            auto tileset_file = directory + "/" + layer.getTileset().path;
+            if (!FileExists(tileset_file.c_str()))
+            {
+                TraceLog(LOG_FATAL, "Tileset file not found: %s", tileset_file.c_str());
+            }
+            Texture2D texture = texture_service->get_texture(tileset_file);
+
+            LayerRenderer layer_renderer;
+            layer_renderer.renderer = LoadRenderTexture(level.size.x, level.size.y);
+            layer_renderer.layer_iid = layer.iid;
+            BeginTextureMode(layer_renderer.renderer);
+            ClearBackground({0, 0, 0, 0});
+            draw_layer_tiles(layer, texture);
+            EndTextureMode();
+            streamed.renderers.push_back(layer_renderer);
+
+            streamed.bodies.push_back(
+                create_collision_body(physics, streamed.layer_loops[layer_index], layer.getCellSize() * scale, offset));
+            layer_index++;
+        }
+        streamed.is_loaded = true;
+
+        if (on_level_loaded)
+        {
+            on_level_loaded(level, offset, streamed.game_objects);
+            for (auto& game_object : streamed.game_objects)
+            {
+                scene->add_game_object(game_object);
+                game_object->init_object();
+            }
+        }
     }
 
     /**
-     * Get the size of an entity in pixels.
+     * Release a level's textures, bodies, and game objects.
+     * For internal use only.
      *
-     * @param entity The entity to get the size of.
-     * @return A Vector2 containing the size of the entity in pixels.
+     * @param index The index of the level.
      */
-    Vector2 get_entity_size(ldtk::Entity* entity)
+    void unload_level(int index)
     {
-        return convert_to_pixels(entity->getSize());
+        auto& streamed = levels[index];
+        if (!streamed.is_loaded)
+        {
+            return;
+        }
+        if (on_level_unloaded)
+        {
+            on_level_unloaded(*streamed.level);
+        }
+
+        scene->remove_game_objects(streamed.game_objects);
+        streamed.game_objects.clear();
+
+        for (auto& layer_renderer : streamed.renderers)
+        {
+            UnloadRenderTexture(layer_renderer.renderer);
+        }
+        streamed.renderers.clear();
+
+        for (auto& body : streamed.bodies)
+        {
+            if (b2Body_IsValid(body))
+            {
+                b2DestroyBody(body);
+            }
+        }
+        streamed.bodies.clear();
+        streamed.is_loaded = false;
     }
 };
@@ -28,6 +28,7 @@ struct RayContextClosest
     RayHit closest;
     b2BodyId ignore_body = b2_nullBodyId;
     b2Vec2 translation;
+    bool ignore_static = false;
 };
 
 /**
@@ -51,6 +52,10 @@ static float raycast_closest_callback(b2ShapeId shape_id, b2Vec2 point, b2Vec2 n
         // Continue searching.
         return 1.0f;
     }
+    if (ctx->ignore_static && b2Body_GetType(hit_body) == b2_staticBody)
+    {
+        return 1.0f;
+    }
 
     if (fraction < ctx->closest.fraction)
     {
@@ -85,6 +90,33 @@ RayHit raycast_closest(b2WorldId world, b2BodyId ignore_body, b2Vec2 origin, b2V
     return ctx.closest;
 }
 
+/**
+ * Sweep a circle and return the closest hit.
+ * Like a raycast with thickness, useful for fast moving projectiles.
+ *
+ * @param world The world to cast the circle in.
+ * @param ignore_body The body to ignore.
+ * @param center The starting center of the circle.
+ * @param radius The radius of the circle.
+ * @param translation The distance and direction to sweep the circle.
+ * @param ignore_static True to skip static bodies, e.g. when level walls are handled separately.
+ * @return Information about the closest hit.
+ */
+RayHit circle_cast_closest(
+    b2WorldId world, b2BodyId ignore_body, b2Vec2 center, float radius, b2Vec2 translation, bool ignore_static = false)
+{
+    RayContextClosest ctx;
+    ctx.ignore_body = ignore_body;
+    ctx.translation = translation;
+    ctx.ignore_static = ignore_static;
+
+    b2ShapeProxy proxy = b2MakeProxy(&center, 1, radius);
+    b2QueryFilter filter = b2DefaultQueryFilter();
+    b2World_CastShape(world, &proxy, translation, filter, raycast_closest_callback, &ctx);
+
+    return ctx.closest;
+}
+
 /**
  * The raycast context struct used for passing data during a raycast call.
  * For internal use only.
@@ -0,0 +1,176 @@
+#pragma once
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GAME_JAM_KIT_SSE2 1
+#endif
+
+/**
+ * Small loops over float arrays, vectorized with SSE2 where available.
+ * Every function has a plain scalar fallback so web and ARM builds behave the same.
+ */
+
+/**
+ * Add a scaled array to another, dst[i] += src[i] * scale.
+ *
+ * @param dst The array to add to.
+ * @param src The array to scale and add.
+ * @param scale The scale factor.
+ * @param count The number of elements.
+ */
+inline void simd_add_scaled(float* dst, const float* src, float scale, int count)
+{
+    int i = 0;
+#ifdef GAME_JAM_KIT_SSE2
+    const __m128 s = _mm_set1_ps(scale);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 d = _mm_loadu_ps(dst + i);
+        __m128 v = _mm_loadu_ps(src + i);
+        _mm_storeu_ps(dst + i, _mm_add_ps(d, _mm_mul_ps(v, s)));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        dst[i] += src[i] * scale;
+    }
+}
+
+/**
+ * Add a value to every element of an array, dst[i] += value.
+ *
+ * @param dst The array to add to.
+ * @param value The value to add.
+ * @param count The number of elements.
+ */
+inline void simd_add(float* dst, float value, int count)
+{
+    int i = 0;
+#ifdef GAME_JAM_KIT_SSE2
+    const __m128 v = _mm_set1_ps(value);
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), v));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        dst[i] += value;
+    }
+}
+
+/**
+ * Multiply every element of an array by a value, dst[i] *= value.
+ *
+ * @param dst The array to scale.
+ * @param value The scale factor.
+ * @param count The number of elements.
+ */
+inline void simd_scale(float* dst, float value, int count)
+{
+    int i = 0;
+#ifdef GAME_JAM_KIT_SSE2
+    const __m128 v = _mm_set1_ps(value);
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), v));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        dst[i] *= value;
+    }
+}
+
+/**
+ * Move points by their velocities, x[i] += vx[i] * dt and y[i] += vy[i] * dt.
+ *
+ * @param x The x positions.
+ * @param y The y positions.
+ * @param vx The x velocities.
+ * @param vy The y velocities.
+ * @param dt The time step.
+ * @param count The number of points.
+ */
+inline void simd_integrate(float* x, float* y, const float* vx, const float* vy, float dt, int count)
+{
+    simd_add_scaled(x, vx, dt, count);
+    simd_add_scaled(y, vy, dt, count);
+}
+
+/**
+ * Slow velocities down by linear drag, v[i] *= max(0, 1 - drag[i] * dt).
+ *
+ * @param v The velocities.
+ * @param drag The per-element drag coefficients, per second.
+ * @param dt The time step.
+ * @param count The number of elements.
+ */
+inline void simd_damp(float* v, const float* drag, float dt, int count)
+{
+    int i = 0;
+#ifdef GAME_JAM_KIT_SSE2
+    const __m128 t = _mm_set1_ps(dt);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 factor = _mm_max_ps(zero, _mm_sub_ps(one, _mm_mul_ps(_mm_loadu_ps(drag + i), t)));
+        _mm_storeu_ps(v + i, _mm_mul_ps(_mm_loadu_ps(v + i), factor));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        float factor = 1.0f - drag[i] * dt;
+        v[i] *= factor > 0.0f ? factor : 0.0f;
+    }
+}
+
+/**
+ * Multiply two arrays, out[i] = a[i] * b[i].
+ *
+ * @param out The result array. May be the same as a or b.
+ * @param a The first array.
+ * @param b The second array.
+ * @param count The number of elements.
+ */
+inline void simd_multiply(float* out, const float* a, const float* b, int count)
+{
+    int i = 0;
+#ifdef GAME_JAM_KIT_SSE2
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        out[i] = a[i] * b[i];
+    }
+}
+
+/**
+ * Interpolate between two arrays, out[i] = a[i] + (b[i] - a[i]) * t[i].
+ *
+ * @param out The result array. May be the same as any input.
+ * @param a The values at t = 0.
+ * @param b The values at t = 1.
+ * @param t The per-element interpolation factors.
+ * @param count The number of elements.
+ */
+inline void simd_lerp(float* out, const float* a, const float* b, const float* t, int count)
+{
+    int i = 0;
+#ifdef GAME_JAM_KIT_SSE2
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 va = _mm_loadu_ps(a + i);
+        __m128 vb = _mm_loadu_ps(b + i);
+        _mm_storeu_ps(out + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), _mm_loadu_ps(t + i))));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        out[i] = a[i] + (b[i] - a[i]) * t[i];
+    }
+}
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <deque>
+#include <new>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * A vector that keeps its first N elements inside the object and only allocates when it grows past them.
+ * For the short lists of children that containers like MultiComponent hold, which would otherwise pay for a heap
+ * block, or a hash node per element, to store two or three things.
+ * Elements are contiguous either way. Not copyable or movable, it lives inside the object that owns it.
+ */
+template <typename T, int N>
+class SmallVector
+{
+public:
+    alignas(T) unsigned char inline_storage[sizeof(T) * N];
+    T* elements = reinterpret_cast<T*>(inline_storage);
+    int count = 0;
+    int capacity = N;
+
+    SmallVector() = default;
+
+    ~SmallVector()
+    {
+        clear();
+        if (elements != reinterpret_cast<T*>(inline_storage))
+        {
+            ::operator delete(elements);
+        }
+    }
+
+    SmallVector(const SmallVector&) = delete;
+    SmallVector& operator=(const SmallVector&) = delete;
+
+    /**
+     * Construct an element in place at the end.
+     *
+     * @param args The arguments to forward to the element constructor.
+     * @return A reference to the new element.
+     */
+    template <typename... TArgs>
+    T& emplace_back(TArgs&&... args)
+    {
+        if (count == capacity)
+        {
+            grow(capacity * 2);
+        }
+        T* element = new (elements + count) T(std::forward<TArgs>(args)...);
+        count++;
+        return *element;
+    }
+
+    /**
+     * Remove an element, moving the elements after it down to keep the order.
+     *
+     * @param index The index of the element.
+     */
+    void erase(int index)
+    {
+        for (int i = index; i < count - 1; i++)
+        {
+            elements[i] = std::move(elements[i + 1]);
+        }
+        count--;
+        elements[count].~T();
+    }
+
+    /**
+     * Remove every element. Keeps any memory that was allocated.
+     */
+    void clear()
+    {
+        for (int i = 0; i < count; i++)
+        {
+            elements[i].~T();
+        }
+        count = 0;
+    }
+
+    int size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    T& operator[](int index)
+    {
+        return elements[index];
+    }
+
+    const T& operator[](int index) const
+    {
+        return elements[index];
+    }
+
+    T* begin()
+    {
+        return elements;
+    }
+
+    T* end()
+    {
+        return elements + count;
+    }
+
+    const T* begin() const
+    {
+        return elements;
+    }
+
+    const T* end() const
+    {
+        return elements + count;
+    }
+
+    /**
+     * Move the elements to a larger heap block.
+     * For internal use only.
+     *
+     * @param new_capacity The number of elements to make room for.
+     */
+    void grow(int new_capacity)
+    {
+        T* new_elements = static_cast<T*>(::operator new(sizeof(T) * new_capacity));
+        for (int i = 0; i < count; i++)
+        {
+            new (new_elements + i) T(std::move(elements[i]));
+            elements[i].~T();
+        }
+        if (elements != reinterpret_cast<T*>(inline_storage))
+        {
+            ::operator delete(elements);
+        }
+        elements = new_elements;
+        capacity = new_capacity;
+    }
+};
+
+/**
+ * A string stored once in a global table, so names compare as integers.
+ * Looking up a name that was never interned doesn't add it to the table, so failed lookups don't allocate.
+ * The table is not thread safe, intern names on the main thread.
+ */
+class InternedName
+{
+public:
+    int id = -1;
+
+    InternedName() = default;
+
+    /**
+     * Constructor for InternedName. Adds the name to the table if it isn't there yet.
+     *
+     * @param name The name to intern.
+     */
+    explicit InternedName(std::string_view name) : id(intern(name)) {}
+
+    /**
+     * Get the interned string.
+     *
+     * @return The string, or an empty string for a default constructed name.
+     */
+    const std::string& str() const
+    {
+        static const std::string empty;
+        return id < 0 ? empty : get_table().names[id];
+    }
+
+    bool operator==(const InternedName& other) const
+    {
+        return id == other.id;
+    }
+
+    bool operator!=(const InternedName& other) const
+    {
+        return id != other.id;
+    }
+
+    /**
+     * Find a name that was interned before, without adding it.
+     *
+     * @param name The name to look for.
+     * @return The name, or a default constructed name with id -1 if it was never interned.
+     */
+    static InternedName find(std::string_view name)
+    {
+        InternedName result;
+        auto& table = get_table();
+        auto it = table.ids.find(name);
+        if (it != table.ids.end())
+        {
+            result.id = it->second;
+        }
+        return result;
+    }
+
+    /**
+     * The strings and their ids.
+     * The strings live in a deque so the views used as keys stay valid as it grows.
+     * For internal use only.
+     */
+    struct Table
+    {
+        std::deque<std::string> names;
+        std::unordered_map<std::string_view, int> ids;
+    };
+
+    /**
+     * Get the global table.
+     * For internal use only.
+     *
+     * @return The table.
+     */
+    static Table& get_table()
+    {
+        static Table table;
+        return table;
+    }
+
+    /**
+     * Get the id for a name, adding it to the table if needed.
+     * For internal use only.
+     *
+     * @param name The name to intern.
+     * @return The id of the name.
+     */
+    static int intern(std::string_view name)
+    {
+        auto& table = get_table();
+        auto it = table.ids.find(name);
+        if (it != table.ids.end())
+        {
+            return it->second;
+        }
+        int new_id = (int)table.names.size();
+        table.names.emplace_back(name);
+        table.ids.emplace(table.names.back(), new_id);
+        return new_id;
+    }
+};
@@ -0,0 +1,349 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <raylib.h>
+#include <rlgl.h>
+
+#include "engine/glyph_cache.h"
+
+/**
+ * A laid out glyph, relative to the text's position.
+ */
+struct GlyphQuad
+{
+    Rectangle dest;
+    float u0, v0, u1, v1;
+};
+
+/**
+ * Text that is laid out once and drawn from cached glyph quads.
+ * The UTF-8 walk, glyph lookups and measuring only happen when the text, font, size or spacing change. Drawing is
+ * a single batch of quads with no per character work.
+ */
+class TextLayout
+{
+public:
+    Font font = {0};
+    std::string text;
+    float font_size = 20.0f;
+    float spacing = 1.0f;
+    float line_spacing = 2.0f;
+
+    // The shader to draw with, for SDF fonts. Id 0 draws without a shader.
+    Shader shader = {0};
+
+    // Glyphs come from here instead of the font when set. Glyphs that aren't in the cache yet are left out until
+    // they arrive, and the shelves the text uses are kept from being evicted while it is drawn.
+    GlyphCache* glyph_cache = nullptr;
+    int glyph_cache_version = -1;
+    int glyph_cache_eviction_version = -1;
+    bool missing_glyphs = false;
+    std::vector<int> glyph_shelves;
+
+    std::vector<GlyphQuad> quads;
+    Vector2 size = {0, 0};
+    bool dirty = true;
+
+    // The last values passed to set_format(), to skip formatting when they haven't changed.
+    const char* last_format = nullptr;
+    std::vector<double> last_values;
+
+    TextLayout() = default;
+
+    /**
+     * Constructor for TextLayout.
+     *
+     * @param font The font to lay out with.
+     * @param text The text to lay out.
+     * @param font_size The size of the font.
+     * @param spacing The extra space between characters.
+     */
+    TextLayout(Font font, const std::string& text, float font_size = 20.0f, float spacing = 1.0f) :
+        font(font),
+        text(text),
+        font_size(font_size),
+        spacing(spacing)
+    {
+    }
+
+    /**
+     * Set the text. Does nothing if it hasn't changed.
+     *
+     * @param new_text The text to lay out.
+     */
+    void set_text(const std::string& new_text)
+    {
+        // The text no longer comes from the last format, so the next set_format() has to format again.
+        last_format = nullptr;
+        if (new_text != text)
+        {
+            text = new_text;
+            dirty = true;
+        }
+    }
+
+    /**
+     * Set the text from a printf style format and numbers, for counters in HUDs.
+     * The text is only formatted and laid out again when one of the numbers changes, so this is cheap to call
+     * every frame.
+     *
+     * @param format The format string. Must stay alive, string literals are best.
+     * @param values The numbers to format.
+     */
+    template <typename... TArgs>
+    void set_format(const char* format, TArgs... values)
+    {
+        static_assert((std::is_arithmetic<TArgs>::value && ...), "set_format only takes numbers");
+        std::array<double, sizeof...(TArgs)> current = {static_cast<double>(values)...};
+        if (format == last_format && last_values.size() == current.size() &&
+            std::equal(last_values.begin(), last_values.end(), current.begin()))
+        {
+            return;
+        }
+
+        char buffer[512];
+        // The trailing 0 is ignored. It keeps a call with no values from warning about a non-literal format.
+        std::snprintf(buffer, sizeof(buffer), format, values..., 0);
+        set_text(buffer);
+        // After set_text(), which clears the last format.
+        last_format = format;
+        last_values.assign(current.begin(), current.end());
+    }
+
+    /**
+     * Set the font. Does nothing if it hasn't changed.
+     *
+     * @param new_font The font to lay out with.
+     */
+    void set_font(const Font& new_font)
+    {
+        if (new_font.texture.id != font.texture.id || new_font.glyphs != font.glyphs)
+        {
+            font = new_font;
+            dirty = true;
+        }
+    }
+
+    /**
+     * Take glyphs from a glyph cache instead of the font. Does nothing if it hasn't changed.
+     *
+     * @param cache The glyph cache, or nullptr to use the font.
+     */
+    void set_glyph_cache(GlyphCache* cache)
+    {
+        if (cache != glyph_cache)
+        {
+            glyph_cache = cache;
+            dirty = true;
+        }
+    }
+
+    /**
+     * Set the font size. Does nothing if it hasn't changed.
+     *
+     * @param new_size The size of the font.
+     */
+    void set_font_size(float new_size)
+    {
+        if (new_size != font_size)
+        {
+            font_size = new_size;
+            dirty = true;
+        }
+    }
+
+    /**
+     * Set the extra space between characters. Does nothing if it hasn't changed.
+     *
+     * @param new_spacing The spacing in pixels.
+     */
+    void set_spacing(float new_spacing)
+    {
+        if (new_spacing != spacing)
+        {
+            spacing = new_spacing;
+            dirty = true;
+        }
+    }
+
+    /**
+     * Get the size of the laid out text.
+     *
+     * @return The size in pixels.
+     */
+    Vector2 get_size()
+    {
+        update_layout();
+        return size;
+    }
+
+    /**
+     * Lay out the glyph quads if anything changed since the last layout.
+     * Matches the placement of DrawTextEx.
+     */
+    void update_layout()
+    {
+        if (glyph_cache)
+        {
+            // Text with missing glyphs waits for new ones, complete text only cares if its glyphs moved.
+            bool changed = missing_glyphs ? glyph_cache->version != glyph_cache_version
+                                          : glyph_cache->eviction_version != glyph_cache_eviction_version;
+            dirty = dirty || changed;
+        }
+        if (!dirty)
+        {
+            return;
+        }
+        dirty = false;
+        quads.clear();
+        size = {0, 0};
+        missing_glyphs = false;
+        glyph_shelves.clear();
+        if (text.empty() || (!glyph_cache && (font.glyphs == nullptr || font.baseSize == 0)))
+        {
+            return;
+        }
+
+        const Texture2D& texture = glyph_cache ? glyph_cache->texture : font.texture;
+        float scale = font_size / (glyph_cache ? glyph_cache->font_size : font.baseSize);
+        float padding = (float)(glyph_cache ? glyph_cache->padding : font.glyphPadding);
+        float texture_width = (float)texture.width;
+        float texture_height = (float)texture.height;
+        float offset_x = 0.0f;
+        float offset_y = 0.0f;
+        int lines = 1;
+
+        for (int i = 0; i < (int)text.size();)
+        {
+            int codepoint_size = 0;
+            int codepoint = GetCodepointNext(&text[i], &codepoint_size);
+            i += codepoint_size;
+
+            if (codepoint == '\n')
+            {
+                size.x = std::max(size.x, offset_x - spacing);
+                offset_x = 0.0f;
+                offset_y += font_size + line_spacing;
+                lines++;
+                continue;
+            }
+
+            int glyph_offset_x, glyph_offset_y, advance_x;
+            Rectangle rec;
+            if (glyph_cache)
+            {
+                const CachedGlyph* glyph = glyph_cache->get(codepoint);
+                if (glyph == nullptr)
+                {
+                    missing_glyphs = true;
+                    continue;
+                }
+                glyph_offset_x = glyph->offset_x;
+                glyph_offset_y = glyph->offset_y;
+                advance_x = glyph->advance_x;
+                rec = glyph->rec;
+                if (glyph->shelf >= 0 &&
+                    std::find(glyph_shelves.begin(), glyph_shelves.end(), glyph->shelf) == glyph_shelves.end())
+                {
+                    glyph_shelves.push_back(glyph->shelf);
+                }
+            }
+            else
+            {
+                int index = GetGlyphIndex(font, codepoint);
+                glyph_offset_x = font.glyphs[index].offsetX;
+                glyph_offset_y = font.glyphs[index].offsetY;
+                advance_x = font.glyphs[index].advanceX;
+                rec = font.recs[index];
+            }
+
+            if (codepoint != ' ' && codepoint != '\t' && rec.width > 0.0f)
+            {
+                GlyphQuad quad;
+                quad.dest = {offset_x + (glyph_offset_x - padding) * scale,
+                             offset_y + (glyph_offset_y - padding) * scale,
+                             (rec.width + 2.0f * padding) * scale,
+                             (rec.height + 2.0f * padding) * scale};
+                quad.u0 = (rec.x - padding) / texture_width;
+                quad.v0 = (rec.y - padding) / texture_height;
+                quad.u1 = (rec.x + rec.width + padding) / texture_width;
+                quad.v1 = (rec.y + rec.height + padding) / texture_height;
+                quads.push_back(quad);
+            }
+
+            float advance = advance_x == 0 ? rec.width : (float)advance_x;
+            offset_x += advance * scale + spacing;
+        }
+
+        size.x = std::max(size.x, offset_x - spacing);
+        size.y = lines * font_size + (lines - 1) * line_spacing;
+        if (glyph_cache)
+        {
+            glyph_cache_version = glyph_cache->version;
+            glyph_cache_eviction_version = glyph_cache->eviction_version;
+        }
+    }
+
+    /**
+     * Draw the text.
+     *
+     * @param position The top left of the text in pixels.
+     * @param color The color of the text.
+     */
+    void draw(Vector2 position, Color color = WHITE)
+    {
+        update_layout();
+        if (quads.empty())
+        {
+            return;
+        }
+
+        if (glyph_cache)
+        {
+            for (int shelf : glyph_shelves)
+            {
+                glyph_cache->touch_shelf(shelf);
+            }
+        }
+
+        if (shader.id != 0)
+        {
+            BeginShaderMode(shader);
+        }
+
+        rlSetTexture(glyph_cache ? glyph_cache->texture.id : font.texture.id);
+        rlBegin(RL_QUADS);
+        rlColor4ub(color.r, color.g, color.b, color.a);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+        for (const auto& quad : quads)
+        {
+            float x0 = position.x + quad.dest.x;
+            float y0 = position.y + quad.dest.y;
+            float x1 = x0 + quad.dest.width;
+            float y1 = y0 + quad.dest.height;
+
+            rlCheckRenderBatchLimit(4);
+            rlTexCoord2f(quad.u0, quad.v0);
+            rlVertex2f(x0, y0);
+            rlTexCoord2f(quad.u0, quad.v1);
+            rlVertex2f(x0, y1);
+            rlTexCoord2f(quad.u1, quad.v1);
+            rlVertex2f(x1, y1);
+            rlTexCoord2f(quad.u1, quad.v0);
+            rlVertex2f(x1, y0);
+        }
+        rlEnd();
+        rlSetTexture(0);
+
+        if (shader.id != 0)
+        {
+            EndShaderMode();
+        }
+    }
+};
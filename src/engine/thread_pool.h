@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A small pool of worker threads for background jobs.
+ * A pool with zero threads runs every job inline on the calling thread, which is what web builds without
+ * pthread support fall back to.
+ */
+class ThreadPool
+{
+public:
+    std::vector<std::thread> workers;
+    std::deque<std::packaged_task<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable job_available;
+    bool stopping = false;
+
+    /**
+     * Constructor for ThreadPool.
+     *
+     * @param thread_count The number of worker threads to start. Zero runs jobs inline.
+     */
+    ThreadPool(int thread_count = 1)
+    {
+#ifdef __EMSCRIPTEN__
+        // Web builds are not compiled with pthreads.
+        thread_count = 0;
+#endif
+        for (int i = 0; i < thread_count; i++)
+        {
+            workers.emplace_back([this]() { worker_loop(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        job_available.notify_all();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Get the number of threads available to parallel work, including the calling thread.
+     *
+     * @return The number of threads.
+     */
+    int get_thread_count() const
+    {
+        return (int)workers.size() + 1;
+    }
+
+    /**
+     * Queue a job to run on a worker thread.
+     *
+     * @param job The job to run.
+     * @return A future that becomes ready when the job has finished.
+     */
+    std::future<void> submit(std::function<void()> job)
+    {
+        std::packaged_task<void()> task(std::move(job));
+        auto future = task.get_future();
+        if (workers.empty())
+        {
+            task();
+            return future;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(task));
+        }
+        job_available.notify_one();
+        return future;
+    }
+
+    /**
+     * Split the range [0, count) into chunks and run them across the workers and the calling thread.
+     * Returns once every chunk has finished.
+     *
+     * @param count The number of items to process.
+     * @param min_chunk The smallest number of items worth sending to a thread.
+     * @param fn The function to run for each chunk, given the begin and end indices.
+     */
+    void parallel_for(int count, int min_chunk, const std::function<void(int, int)>& fn)
+    {
+        if (count <= 0)
+        {
+            return;
+        }
+        int chunks = std::min(get_thread_count(), std::max(1, count / std::max(1, min_chunk)));
+        if (chunks <= 1)
+        {
+            fn(0, count);
+            return;
+        }
+
+        int chunk_size = (count + chunks - 1) / chunks;
+        std::vector<std::future<void>> pending;
+        pending.reserve(chunks - 1);
+        for (int begin = chunk_size; begin < count; begin += chunk_size)
+        {
+            int end = std::min(count, begin + chunk_size);
+            pending.push_back(submit([&fn, begin, end]() { fn(begin, end); }));
+        }
+
+        // The calling thread takes the first chunk instead of waiting idle.
+        fn(0, std::min(count, chunk_size));
+        for (auto& future : pending)
+        {
+            future.wait();
+        }
+    }
+
+    /**
+     * The loop each worker thread runs until the pool is destroyed.
+     * For internal use only.
+     */
+    void worker_loop()
+    {
+        while (true)
+        {
+            std::packaged_task<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                job_available.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty())
+                {
+                    return;
+                }
+                task = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            task();
+        }
+    }
+};
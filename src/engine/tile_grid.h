@@ -0,0 +1,334 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <raylib.h>
+
+/**
+ * The result of a raycast against a tile grid.
+ */
+struct TileHit
+{
+    bool hit = false;
+    float fraction = 1.0f;
+    float distance = 0.0f;
+    Vector2 point = {0, 0};
+    Vector2 normal = {0, 0};
+    int x = -1;
+    int y = -1;
+};
+
+/**
+ * A grid of solid and empty cells for fast collision queries without a physics engine.
+ * Queries take pixel coordinates. Cells outside the grid are empty.
+ */
+class TileGrid
+{
+public:
+    int width = 0;
+    int height = 0;
+    float cell_size = 1.0f;
+    Vector2 origin = {0, 0};
+    std::vector<uint8_t> cells;
+
+    /**
+     * Resize the grid and clear every cell.
+     *
+     * @param width The width of the grid in cells.
+     * @param height The height of the grid in cells.
+     * @param cell_size The size of a cell in pixels.
+     * @param origin The top left of the grid in pixels.
+     */
+    void resize(int width, int height, float cell_size, Vector2 origin = {0, 0})
+    {
+        this->width = width;
+        this->height = height;
+        this->cell_size = cell_size;
+        this->origin = origin;
+        cells.assign(width * height, 0);
+    }
+
+    /**
+     * Set whether a cell is solid.
+     *
+     * @param x The x coordinate of the cell.
+     * @param y The y coordinate of the cell.
+     * @param solid True to make the cell solid.
+     */
+    void set_solid(int x, int y, bool solid)
+    {
+        if (x < 0 || y < 0 || x >= width || y >= height)
+        {
+            return;
+        }
+        cells[y * width + x] = solid ? 1 : 0;
+    }
+
+    /**
+     * Check if a cell is solid.
+     *
+     * @param x The x coordinate of the cell.
+     * @param y The y coordinate of the cell.
+     * @return True if the cell is solid, false otherwise.
+     */
+    bool is_solid(int x, int y) const
+    {
+        if (x < 0 || y < 0 || x >= width || y >= height)
+        {
+            return false;
+        }
+        return cells[y * width + x] != 0;
+    }
+
+    /**
+     * Get the cell containing a pixel.
+     *
+     * @param pixels The point in pixels.
+     * @param x The x coordinate of the cell.
+     * @param y The y coordinate of the cell.
+     */
+    void cell_at(Vector2 pixels, int& x, int& y) const
+    {
+        x = (int)std::floor((pixels.x - origin.x) / cell_size);
+        y = (int)std::floor((pixels.y - origin.y) / cell_size);
+    }
+
+    /**
+     * Check if the cell containing a pixel is solid.
+     *
+     * @param pixels The point in pixels.
+     * @return True if the point is inside a solid cell, false otherwise.
+     */
+    bool is_solid_at(Vector2 pixels) const
+    {
+        int x, y;
+        cell_at(pixels, x, y);
+        return is_solid(x, y);
+    }
+
+    /**
+     * Check if a rectangle overlaps any solid cell.
+     * Touching the edge of a cell does not count as overlapping it.
+     *
+     * @param rect The rectangle in pixels.
+     * @return True if the rectangle overlaps a solid cell, false otherwise.
+     */
+    bool overlaps(Rectangle rect) const
+    {
+        int x0 = (int)std::floor((rect.x - origin.x) / cell_size);
+        int y0 = (int)std::floor((rect.y - origin.y) / cell_size);
+        int x1 = (int)std::ceil((rect.x + rect.width - origin.x) / cell_size) - 1;
+        int y1 = (int)std::ceil((rect.y + rect.height - origin.y) / cell_size) - 1;
+        x0 = x0 < 0 ? 0 : x0;
+        y0 = y0 < 0 ? 0 : y0;
+        x1 = x1 >= width ? width - 1 : x1;
+        y1 = y1 >= height ? height - 1 : y1;
+        for (int y = y0; y <= y1; y++)
+        {
+            const uint8_t* row = cells.data() + y * width;
+            for (int x = x0; x <= x1; x++)
+            {
+                if (row[x])
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Find how far a rectangle can move along the x axis before it runs into a solid cell.
+     *
+     * @param rect The rectangle in pixels. Should not already overlap a solid cell.
+     * @param dx The distance to move in pixels.
+     * @return The distance the rectangle can move, between 0 and dx.
+     */
+    float sweep_x(Rectangle rect, float dx) const
+    {
+        return sweep(rect.x - origin.x, rect.width, rect.y - origin.y, rect.height, dx, false);
+    }
+
+    /**
+     * Find how far a rectangle can move along the y axis before it runs into a solid cell.
+     *
+     * @param rect The rectangle in pixels. Should not already overlap a solid cell.
+     * @param dy The distance to move in pixels.
+     * @return The distance the rectangle can move, between 0 and dy.
+     */
+    float sweep_y(Rectangle rect, float dy) const
+    {
+        return sweep(rect.y - origin.y, rect.height, rect.x - origin.x, rect.width, dy, true);
+    }
+
+    /**
+     * Sweep a rectangle along one axis, checking each line of cells its leading edge enters.
+     * For internal use only.
+     *
+     * @param start The position of the rectangle on the moving axis, relative to the grid origin.
+     * @param length The size of the rectangle on the moving axis.
+     * @param cross_start The position of the rectangle on the other axis, relative to the grid origin.
+     * @param cross_length The size of the rectangle on the other axis.
+     * @param delta The distance to move.
+     * @param vertical True to move along the y axis, false for the x axis.
+     * @return The distance the rectangle can move.
+     */
+    float sweep(float start, float length, float cross_start, float cross_length, float delta, bool vertical) const
+    {
+        // Keeps edges lying exactly on a cell boundary from counting as inside the next cell.
+        constexpr float epsilon = 1e-4f;
+        if (delta == 0.0f)
+        {
+            return 0.0f;
+        }
+
+        int lines = vertical ? height : width;
+        int cross_lines = vertical ? width : height;
+        int c0 = std::max(0, (int)std::floor(cross_start / cell_size));
+        int c1 = std::min(cross_lines - 1, (int)std::ceil((cross_start + cross_length) / cell_size) - 1);
+        if (c0 > c1)
+        {
+            return delta;
+        }
+
+        auto line_is_solid = [&](int line)
+        {
+            if (line < 0 || line >= lines)
+            {
+                return false;
+            }
+            for (int c = c0; c <= c1; c++)
+            {
+                if (vertical ? cells[line * width + c] : cells[c * width + line])
+                {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        if (delta > 0.0f)
+        {
+            float edge = (start + length) / cell_size;
+            int first = (int)std::ceil(edge - epsilon);
+            int last = (int)std::ceil(edge + delta / cell_size) - 1;
+            for (int line = first; line <= last; line++)
+            {
+                if (line_is_solid(line))
+                {
+                    return std::max(0.0f, line * cell_size - (start + length));
+                }
+            }
+        }
+        else
+        {
+            float edge = start / cell_size;
+            int first = (int)std::floor(edge + epsilon) - 1;
+            int last = (int)std::floor(edge + delta / cell_size);
+            for (int line = first; line >= last; line--)
+            {
+                if (line_is_solid(line))
+                {
+                    return std::min(0.0f, (line + 1) * cell_size - start);
+                }
+            }
+        }
+        return delta;
+    }
+
+    /**
+     * Cast a ray through the grid and return the first solid cell it enters.
+     * Walks the cells along the ray one at a time (Amanatides and Woo), so the cost is proportional to the
+     * number of cells crossed.
+     *
+     * @param start The starting point of the ray in pixels.
+     * @param translation The direction and length of the ray in pixels.
+     * @return Information about the hit.
+     */
+    TileHit raycast(Vector2 start, Vector2 translation) const
+    {
+        TileHit result;
+        int x, y;
+        cell_at(start, x, y);
+        if (is_solid(x, y))
+        {
+            // Started inside a solid cell.
+            result.hit = true;
+            result.fraction = 0.0f;
+            result.point = start;
+            result.x = x;
+            result.y = y;
+            return result;
+        }
+
+        float length = std::sqrt(translation.x * translation.x + translation.y * translation.y);
+        if (length <= 0.0f || cells.empty())
+        {
+            return result;
+        }
+
+        int step_x = translation.x > 0.0f ? 1 : (translation.x < 0.0f ? -1 : 0);
+        int step_y = translation.y > 0.0f ? 1 : (translation.y < 0.0f ? -1 : 0);
+
+        // The fraction of the ray needed to cross one cell on each axis.
+        float delta_x = step_x != 0 ? cell_size / std::fabs(translation.x) : INFINITY;
+        float delta_y = step_y != 0 ? cell_size / std::fabs(translation.y) : INFINITY;
+
+        // The fraction of the ray where it crosses the first cell boundary on each axis.
+        float local_x = start.x - origin.x - x * cell_size;
+        float local_y = start.y - origin.y - y * cell_size;
+        float next_x = step_x > 0   ? (cell_size - local_x) / translation.x
+                       : step_x < 0 ? local_x / -translation.x
+                                    : INFINITY;
+        float next_y = step_y > 0   ? (cell_size - local_y) / translation.y
+                       : step_y < 0 ? local_y / -translation.y
+                                    : INFINITY;
+
+        while (true)
+        {
+            float fraction;
+            Vector2 normal;
+            if (next_x < next_y)
+            {
+                fraction = next_x;
+                x += step_x;
+                next_x += delta_x;
+                normal = {(float)-step_x, 0.0f};
+            }
+            else
+            {
+                fraction = next_y;
+                y += step_y;
+                next_y += delta_y;
+                normal = {0.0f, (float)-step_y};
+            }
+
+            if (fraction > 1.0f)
+            {
+                return result;
+            }
+
+            // Once the ray has left the grid and is moving away it can't hit anything else.
+            if ((x < 0 && step_x <= 0) || (y < 0 && step_y <= 0) || (x >= width && step_x >= 0) ||
+                (y >= height && step_y >= 0))
+            {
+                return result;
+            }
+
+            if (is_solid(x, y))
+            {
+                result.hit = true;
+                result.fraction = fraction;
+                result.distance = length * fraction;
+                result.point = {start.x + translation.x * fraction, start.y + translation.y * fraction};
+                result.normal = normal;
+                result.x = x;
+                result.y = y;
+                return result;
+            }
+        }
+    }
+};
@@ -22,12 +22,15 @@ int main(int argc, char** argv)
     // Initialize the window
     game.add_manager<WindowManager>(1280, 720, "Game Jam Kit");
     auto font_manager = game.add_manager<FontManager>();
+    game.add_manager<RenderTargetManager>();
+    game.add_manager<MusicManager>();
+    game.add_manager<InputManager>();
     game.init();
 
     // Game::init initializes all managers, so we can load fonts now.
-    font_manager->load_font("Roboto", "assets/fonts/Roboto.ttf", 64);
+    // Roboto is drawn at several sizes, so it uses one SDF atlas for all of them.
+    font_manager->load_sdf_font("Roboto", "assets/fonts/Roboto.ttf", 48, "assets/fonts/Roboto.sdf");
     font_manager->load_font("Tiny5", "assets/fonts/Tiny5.ttf", 64);
-    font_manager->set_texture_filter("Roboto", TEXTURE_FILTER_BILINEAR);
 
     game.add_scene<TitleScreen>("title");
     game.add_scene<FightingScene>("fighting");
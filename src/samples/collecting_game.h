@@ -15,20 +15,19 @@ class CollectingCharacter : public GameObject
 public:
     CharacterParams p;
     PhysicsService* physics;
+    InputManager* input;
     LevelService* level;
     BodyComponent* body;
     PlatformerMovementComponent* movement;
     AnimationController* animation;
-    MultiComponent<SoundComponent>* sounds;
-    SoundComponent* jump_sound;
-    SoundComponent* die_sound;
+    MultiComponent<PositionalSoundComponent>* sounds;
+    PositionalSoundComponent* jump_sound;
+    PositionalSoundComponent* die_sound;
     int score = 0;
 
     bool grounded = false;
     bool on_wall_left = false;
     bool on_wall_right = false;
-    float coyote_timer = 0.0f;
-    float jump_buffer_timer = 0.0f;
     int gamepad = 0;
     int player_number = 1;
     float width = 24.0f;
@@ -45,6 +44,7 @@ public:
 
     void init() override
     {
+        input = scene->game->get_manager<InputManager>();
 
         // Grab the physics service.
         // All get_service calls should be done in init(). get_service is not quick and this also allows us to test
@@ -91,9 +91,10 @@ public:
         level = scene->get_service<LevelService>();
 
         // TODO: Is only allowing one component per type really as cool an idea as I thought?
-        sounds = add_component<MultiComponent<SoundComponent>>();
-        jump_sound = sounds->add_component("jump", "assets/sounds/jump.wav");
-        die_sound = sounds->add_component("die", "assets/sounds/die.wav");
+        // Sounds play from the character, so players mostly hear what happens near their own camera.
+        sounds = add_component<MultiComponent<PositionalSoundComponent>>();
+        jump_sound = sounds->add_component("jump", "assets/sounds/jump.wav", body);
+        die_sound = sounds->add_component("die", "assets/sounds/die.wav", body);
 
         // Setup animations.
         animation = add_component<AnimationController>(body);
@@ -130,26 +131,9 @@ public:
     void update(float delta_time) override
     {
         // Get input and route to movement component.
-        float deadzone = 0.1f;
-
-        const bool jump_pressed =
-            IsKeyPressed(KEY_W) || IsGamepadButtonPressed(gamepad, GAMEPAD_BUTTON_RIGHT_FACE_DOWN);
-        const bool jump_held = IsKeyDown(KEY_W) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_RIGHT_FACE_DOWN);
-
-        float move_x = 0.0f;
-        move_x = GetGamepadAxisMovement(gamepad, GAMEPAD_AXIS_LEFT_X);
-        if (fabsf(move_x) < deadzone)
-        {
-            move_x = 0.0f;
-        }
-        if (IsKeyDown(KEY_D) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_LEFT_FACE_RIGHT))
-        {
-            move_x = 1.0f;
-        }
-        else if (IsKeyDown(KEY_A) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_LEFT_FACE_LEFT))
-        {
-            move_x = -1.0f;
-        }
+        const bool jump_pressed = input->is_action_pressed("jump", gamepad);
+        const bool jump_held = input->is_action_down("jump", gamepad);
+        float move_x = input->get_action_value("move_right", gamepad) - input->get_action_value("move_left", gamepad);
 
         movement->set_input(move_x, jump_pressed, jump_held);
 
@@ -186,30 +170,39 @@ enum EnemyType
 };
 
 /**
- * An enemy.
+ * An enemy that patrols back and forth along a path.
  */
 class Enemy : public GameObject
 {
 public:
-    Vector2 start;
-    Vector2 end;
+    std::vector<Vector2> path;
     PhysicsService* physics;
     BodyComponent* body;
+    PathFollowComponent* path_follow;
     AnimationController* animation;
     EnemyType type;
     float radius = 12.0f;
+    float speed = 50.0f;
 
-    Enemy(EnemyType type, Vector2 start, Vector2 end) : type(type), start(start), end(end) {}
+    Enemy(EnemyType type, std::vector<Vector2> path, PhysicsService* physics = nullptr) :
+        type(type),
+        path(std::move(path)),
+        physics(physics)
+    {
+    }
     void init_object() override
     {
-        physics = scene->get_service<PhysicsService>();
+        if (!physics)
+        {
+            physics = scene->get_service<PhysicsService>();
+        }
 
         body = add_component<BodyComponent>(
             [=](BodyComponent& b)
             {
                 b2BodyDef body_def = b2DefaultBodyDef();
                 body_def.type = b2_kinematicBody;
-                body_def.position = physics->convert_to_meters(start);
+                body_def.position = physics->convert_to_meters(path[0]);
                 body_def.userData = this;
                 b.id = b2CreateBody(physics->world, &body_def);
 
@@ -225,6 +218,9 @@ public:
                 b2CreateCircleShape(b.id, &circle_shape_def, &circle_shape);
             });
 
+        // PathFollowService moves the body along with every other enemy.
+        path_follow = add_component<PathFollowComponent>(body, path, speed);
+
         animation = add_component<AnimationController>(body);
         if (type == Bat)
         {
@@ -251,31 +247,10 @@ public:
         animation->play("move");
 
         GameObject::init_object();
-
-        // Start moving towards end position.
-        Vector2 to_end = end - body->get_position_pixels();
-        to_end = Vector2Normalize(to_end);
-        body->set_velocity(to_end * 50.0f);
     }
 
     void update(float delta_time) override
     {
-        b2Circle circle_shape = {body->get_position_meters(), physics->convert_to_meters(radius * 2.0f)};
-        if (b2PointInCircle(physics->convert_to_meters(end), &circle_shape))
-        {
-            // Move towards start position.
-            Vector2 to_start = start - body->get_position_pixels();
-            to_start = Vector2Normalize(to_start);
-            body->set_velocity(to_start * 50.0f);
-        }
-        else if (b2PointInCircle(physics->convert_to_meters(start), &circle_shape))
-        {
-            // Move towards end position.
-            Vector2 to_end = end - body->get_position_pixels();
-            to_end = Vector2Normalize(to_end);
-            body->set_velocity(to_end * 50.0f);
-        }
-
         // Check for collisions.
         auto sensor_contacts = body->get_sensor_overlaps();
         for (auto contact_body_id : sensor_contacts)
@@ -290,29 +265,33 @@ public:
         }
 
         // Flip based on velocity.
-        Vector2 velocity = body->get_velocity_pixels();
-        animation->flip_x = velocity.x > 0.0f;
+        animation->flip_x = path_follow->get_velocity().x > 0.0f;
     }
 };
 
 /**
  * A collectible coin.
+ * Levels have a lot of coins, so their components are stored inline.
  */
-class Coin : public GameObject
+class Coin : public StaticObject<BodyComponent, AnimationController, PositionalSoundComponent, ParticleEmitterComponent>
 {
 public:
     Vector2 position;
     PhysicsService* physics;
     BodyComponent* body;
     AnimationController* animation;
-    SoundComponent* collect_sound;
+    PositionalSoundComponent* collect_sound;
+    ParticleEmitterComponent* sparkle;
 
-    Coin(Vector2 position) : position(position) {}
+    Coin(Vector2 position, PhysicsService* physics = nullptr) : position(position), physics(physics) {}
     void init() override
     {
-        physics = scene->get_service<PhysicsService>();
+        if (!physics)
+        {
+            physics = scene->get_service<PhysicsService>();
+        }
 
-        body = add_component<BodyComponent>(
+        body = emplace_component<BodyComponent>(
             [=](BodyComponent& b)
             {
                 b2BodyDef body_def = b2DefaultBodyDef();
@@ -333,14 +312,29 @@ public:
                 b2CreateCircleShape(b.id, &circle_shape_def, &circle_shape);
             });
 
-        animation = add_component<AnimationController>(body);
+        animation = emplace_component<AnimationController>(body);
         animation->add_animation("spin",
                                  std::vector<std::string>{"assets/pixel_platformer/items/coin_1.png",
                                                           "assets/pixel_platformer/items/coin_2.png"},
                                  5.0f);
         animation->play("spin");
 
-        collect_sound = add_component<SoundComponent>("assets/sounds/coin.wav");
+        collect_sound = emplace_component<PositionalSoundComponent>("assets/sounds/coin.wav");
+        collect_sound->set_position(position);
+
+        ParticleParams sparkle_params;
+        sparkle_params.lifetime_min = 0.3f;
+        sparkle_params.lifetime_max = 0.6f;
+        sparkle_params.speed_min = 40.0f;
+        sparkle_params.speed_max = 120.0f;
+        sparkle_params.gravity = {0.0f, 300.0f};
+        sparkle_params.size_start = 6.0f;
+        sparkle_params.size_end = 0.0f;
+        sparkle_params.color_start = GOLD;
+        sparkle_params.color_end = ColorAlpha(YELLOW, 0.0f);
+        sparkle =
+            emplace_component<ParticleEmitterComponent>("assets/pixel_platformer/items/coin_1.png", sparkle_params);
+        sparkle->set_position(position);
     }
 
     void update(float delta_time) override
@@ -353,6 +347,7 @@ public:
             {
                 // Collected by character.
                 collect_sound->play();
+                sparkle->burst(16);
 
                 // Disable the coin.
                 is_active = false;
@@ -378,7 +373,14 @@ public:
     std::vector<std::shared_ptr<CollectingCharacter>> characters;
     LevelService* level;
     PhysicsService* physics;
+    EntityFactoryService* entity_factory;
+    SplitScreenService* split_screen;
+    AudioListenerService* audio_listener;
+    UILayerService* ui;
     std::vector<std::shared_ptr<SplitCamera>> cameras;
+    std::vector<UILabel*> score_labels;
+    UIPanel* vertical_split;
+    UIPanel* horizontal_split;
     Vector2 screen_size;
     float scale = 2.5f;
 
@@ -386,13 +388,36 @@ public:
     {
         // TextureService and SoundService are needed by other components and game objects.
         add_service<TextureService>();
-        add_service<SoundService>();
+        // The sounds decode in the background while the level loads.
+        std::vector<std::string> sound_files = {
+            "assets/sounds/jump.wav", "assets/sounds/die.wav", "assets/sounds/coin.wav"};
+        add_service<SoundService>(sound_files, "assets/sounds/sounds.pcm");
+        // Timers used by the characters for cooldowns and delays.
+        add_service<TimerService>();
 
         // PhysicsService is used by LevelService and must be added first.
         physics = add_service<PhysicsService>();
         // Setup LDtk level. Checkout the file in LDtk editor to see how it's built.
         std::vector<std::string> collision_names = {"walls", "clouds", "trees"};
         level = add_service<LevelService>("assets/levels/collecting.ldtk", "Level", collision_names);
+
+        // Moves every enemy along its path in one pass.
+        add_service<PathFollowService>();
+
+        // AudioListenerService attenuates sounds by their distance to the cameras.
+        audio_listener = add_service<AudioListenerService>();
+
+        // ParticleService draws the coin pickup sparkles.
+        add_service<ParticleService>();
+
+        // EntityFactoryService creates the enemies and coins from the level's entities.
+        entity_factory = add_service<EntityFactoryService>();
+
+        // SplitScreenService draws the world once and shares it between the cameras.
+        split_screen = add_service<SplitScreenService>();
+
+        // The scores and split lines only redraw when they change.
+        ui = add_service<UILayerService>();
     }
 
     void init() override
@@ -403,7 +428,7 @@ public:
         const auto& entities_layer = level->get_layer_by_name("Entities");
 
         // Create player characters at the "Start" entities.
-        auto player_entities = level->get_entities_by_name("Start");
+        const auto& player_entities = level->get_entities_by_name("Start");
 
         for (int i = 0; i < player_entities.size() && i < 4; i++)
         {
@@ -418,49 +443,36 @@ public:
         }
 
         // Create enemies at the each enemy entity.
-        auto bat_entities = level->get_entities_by_name("Bat");
-        for (auto& bat_entity : bat_entities)
-        {
-            auto start_point = bat_entity->getPosition();
-            Vector2 start_position = level->convert_to_pixels(start_point);
-            ldtk::IntPoint end_point = bat_entity->getField<ldtk::IntPoint>("end").value();
-            // Annoyingly, Point fields in LDtk are in cell coordinates rather than pixel coordinates, and the cell
-            // size is dependent on the layer.
-            Vector2 end_position = level->convert_cells_to_pixels(end_point, entities_layer);
-            auto enemy = add_game_object<Enemy>(EnemyType::Bat, start_position, end_position);
-            enemy->add_tag("enemy");
-        }
-
-        auto drill_entities = level->get_entities_by_name("DrillHead");
-        for (auto& drill_entity : drill_entities)
+        auto spawn_enemy = [&](EnemyType type)
         {
-            auto start_point = drill_entity->getPosition();
-            Vector2 start_position = level->convert_to_pixels(start_point);
-            ldtk::IntPoint end_point = drill_entity->getField<ldtk::IntPoint>("end").value();
-            Vector2 end_position = level->convert_cells_to_pixels(end_point, entities_layer);
-            auto enemy = add_game_object<Enemy>(EnemyType::DrillHead, start_position, end_position);
-            enemy->add_tag("enemy");
-        }
-
-        auto block_entities = level->get_entities_by_name("BlockHead");
-        for (auto& block_entity : block_entities)
-        {
-            auto start_point = block_entity->getPosition();
-            Vector2 start_position = level->convert_to_pixels(start_point);
-            ldtk::IntPoint end_point = block_entity->getField<ldtk::IntPoint>("end").value();
-            Vector2 end_position = level->convert_cells_to_pixels(end_point, entities_layer);
-            auto enemy = add_game_object<Enemy>(EnemyType::BlockHead, start_position, end_position);
-            enemy->add_tag("enemy");
-        }
+            return [this, type, &entities_layer](SpawnBatch<Enemy>& batch, const ldtk::Entity& entity)
+            {
+                Vector2 start_position = level->convert_to_pixels(entity.getPosition());
+                ldtk::IntPoint end_point = entity.getField<ldtk::IntPoint>("end").value();
+                // Annoyingly, Point fields in LDtk are in cell coordinates rather than pixel coordinates, and the
+                // cell size is dependent on the layer.
+                Vector2 end_position = level->convert_cells_to_pixels(end_point, entities_layer);
+                // These enemies patrol between two points. For longer paths, use a Point array field with
+                // level->get_entity_path().
+                std::vector<Vector2> path = {start_position, end_position};
+                auto enemy = batch.spawn(type, path, batch.get_service<PhysicsService>());
+                enemy->add_tag("enemy");
+            };
+        };
+        entity_factory->register_factory<Enemy>("Bat", spawn_enemy(EnemyType::Bat));
+        entity_factory->register_factory<Enemy>("DrillHead", spawn_enemy(EnemyType::DrillHead));
+        entity_factory->register_factory<Enemy>("BlockHead", spawn_enemy(EnemyType::BlockHead));
 
         // Create coins at the "Coin" entities.
-        auto coin_entities = level->get_entities_by_name("Coin");
-        for (auto& coin_entity : coin_entities)
-        {
-            Vector2 coin_position = level->convert_to_pixels(coin_entity->getPosition());
-            auto coin = add_game_object<Coin>(coin_position);
-            coin->add_tag("coin");
-        }
+        entity_factory->register_factory<Coin>(
+            "Coin",
+            [this](SpawnBatch<Coin>& batch, const ldtk::Entity& entity)
+            {
+                Vector2 coin_position = level->convert_to_pixels(entity.getPosition());
+                auto coin = batch.spawn(coin_position, batch.get_service<PhysicsService>());
+                coin->add_tag("coin");
+            });
+        entity_factory->spawn_entities();
 
         // Setup cameras.
         screen_size =
@@ -469,15 +481,37 @@ public:
         {
             auto cam = add_game_object<SplitCamera>(screen_size / scale, level->get_size());
             cameras.push_back(cam);
+            audio_listener->add_listener(cam->target);
+            auto score_label = ui->add_widget<UILabel>(font_manager->get_font("Tiny5"), 40.0f, Vector2{0, 0}, BLACK);
+            score_labels.push_back(score_label);
+        }
+        vertical_split = ui->add_widget<UIPanel>(Rectangle{0, 0, 0, 0}, GRAY);
+        horizontal_split = ui->add_widget<UIPanel>(Rectangle{0, 0, 0, 0}, GRAY);
+        layout_ui();
+    }
+
+    /**
+     * Place the scores in the corner of each view and the split lines between them.
+     */
+    void layout_ui()
+    {
+        Vector2 view_size = screen_size / 2.0f;
+        for (int i = 0; i < score_labels.size(); i++)
+        {
+            Vector2 view_position = {(i % 2) * view_size.x, (i / 2) * view_size.y};
+            score_labels[i]->set_position(view_position + Vector2{20.0f, 20.0f});
         }
+        vertical_split->set_bounds({view_size.x - 2.0f, 0.0f, 4.0f, screen_size.y});
+        horizontal_split->set_bounds({0.0f, view_size.y - 2.0f, screen_size.x, 4.0f});
     }
 
     void update(float delta_time) override
     {
-        // Set the camera target to follow each character.
+        // Set the camera target to follow each character, and listen from each camera.
         for (int i = 0; i < cameras.size(); i++)
         {
             cameras[i]->target = characters[i]->body->get_position_pixels();
+            audio_listener->set_listener_position(i, cameras[i]->camera.target);
         }
 
         auto new_screen_size = Vector2{static_cast<float>(GetScreenWidth()), static_cast<float>(GetScreenHeight())};
@@ -489,89 +523,55 @@ public:
             float screen_scale = window_manager->get_width() / screen_size.x;
             for (auto camera : cameras)
             {
-                camera->size = screen_size / scale * screen_scale;
-                camera->camera.offset = {camera->size.x / 2.0f, camera->size.y / 2.0f};
-                UnloadRenderTexture(camera->renderer);
-                camera->renderer = LoadRenderTexture((int)camera->size.x, (int)camera->size.y);
+                camera->set_size(screen_size / scale * screen_scale);
             }
+            layout_ui();
+        }
+
+        // Only formatted and redrawn when a score changes.
+        for (int i = 0; i < score_labels.size(); i++)
+        {
+            score_labels[i]->set_format("Score: %d", characters[i]->score);
         }
 
         // Trigger scene change on Enter key or gamepad start button.
-        if (IsKeyPressed(KEY_ENTER) || IsGamepadButtonPressed(0, GAMEPAD_BUTTON_MIDDLE_RIGHT))
+        if (game->get_manager<InputManager>()->is_action_pressed("start"))
         {
             game->go_to_scene_next();
         }
     }
 
+    void on_exit() override
+    {
+        // Hand the textures back so the next scene can reuse them.
+        split_screen->release_texture();
+        ui->release_texture();
+    }
+
     /**
      * We override draw_scene instead of draw to control when Scene::draw_scene is called.
-     * This allows us to draw the scene inside the camera's Begin/End block and render the camera to a texture.
+     * This allows us to draw the scene once into a shared texture and show part of it for each camera.
      */
     void draw_scene() override
     {
-        // The scene needs to be rendered once per camera.
-        for (auto camera : cameras)
-        {
-            camera->draw_begin();
-            Scene::draw_scene();
-            // physics->draw_debug();
-            // camera->draw_debug();
-            camera->draw_end();
-        }
+        // The scene is drawn once for all cameras.
+        split_screen->begin_world();
+        Scene::draw_scene();
+        // physics->draw_debug();
+        split_screen->end_world();
 
         // Draw the cameras.
         ClearBackground(MAGENTA);
 
-        // Draw each camera's texture side by side.
+        // Draw each camera's view in a quarter of the screen.
+        Vector2 view_size = screen_size / 2.0f;
         for (int i = 0; i < cameras.size(); i++)
         {
-            if (i == 0)
-            {
-                cameras[i]->draw_texture_pro(0, 0, screen_size.x / 2.0f, screen_size.y / 2.0f);
-                DrawTextEx(font_manager->get_font("Tiny5"),
-                           TextFormat("Score: %d", characters[0]->score),
-                           Vector2{20.0f, 20.0f},
-                           40.0f,
-                           2.0f,
-                           BLACK);
-            }
-            else if (i == 1)
-            {
-                cameras[i]->draw_texture_pro(screen_size.x / 2.0f, 0, screen_size.x / 2.0f, screen_size.y / 2.0f);
-                DrawTextEx(font_manager->get_font("Tiny5"),
-                           TextFormat("Score: %d", characters[1]->score),
-                           Vector2{screen_size.x / 2.0f + 20.0f, 20.0f},
-                           40.0f,
-                           2.0f,
-                           BLACK);
-            }
-            else if (i == 2)
-            {
-                cameras[i]->draw_texture_pro(0, screen_size.y / 2.0f, screen_size.x / 2.0f, screen_size.y / 2.0f);
-                DrawTextEx(font_manager->get_font("Tiny5"),
-                           TextFormat("Score: %d", characters[2]->score),
-                           Vector2{20.0f, screen_size.y / 2.0f + 20.0f},
-                           40.0f,
-                           2.0f,
-                           BLACK);
-            }
-            else if (i == 3)
-            {
-                cameras[i]->draw_texture_pro(screen_size.x / 2.0f,
-                                             screen_size.y / 2.0f,
-                                             screen_size.x / 2.0f,
-                                             screen_size.y / 2.0f);
-                DrawTextEx(font_manager->get_font("Tiny5"),
-                           TextFormat("Score: %d", characters[3]->score),
-                           Vector2{screen_size.x / 2.0f + 20.0f, screen_size.y / 2.0f + 20.0f},
-                           40.0f,
-                           2.0f,
-                           BLACK);
-            }
+            Vector2 view_position = {(i % 2) * view_size.x, (i / 2) * view_size.y};
+            cameras[i]->draw_view(split_screen, view_position.x, view_position.y, view_size.x, view_size.y);
         }
 
-        // Draw split lines.
-        DrawLineEx(Vector2{screen_size.x / 2.0f, 0}, Vector2{screen_size.x / 2.0f, screen_size.y}, 4.0f, GRAY);
-        DrawLineEx(Vector2{0, screen_size.y / 2.0f}, Vector2{screen_size.x, screen_size.y / 2.0f}, 4.0f, GRAY);
+        // Draw the scores and split lines on top.
+        ui->draw_ui();
     }
 };
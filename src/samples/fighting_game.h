@@ -17,6 +17,9 @@ class FightingCharacter : public GameObject
 public:
     CharacterParams p;
     PhysicsService* physics;
+    TimerService* timers;
+    std::shared_ptr<bool> timers_alive;
+    InputManager* input;
     LevelService* level;
     BodyComponent* body;
     PlatformerMovementComponent* movement;
@@ -29,18 +32,14 @@ public:
     bool grounded = false;
     bool on_wall_left = false;
     bool on_wall_right = false;
-    float coyote_timer = 0.0f;
-    float jump_buffer_timer = 0.0f;
     int gamepad = 0;
     int player_number = 1;
     float width = 24.0f;
     float height = 40.0f;
-    bool fall_through = false;
-    float fall_through_timer = 0.0f;
+    TimerHandle fall_through_timer;
     float fall_through_duration = 0.2f;
-    float attack_display_timer = 0.0f;
+    TimerHandle attack_display_timer;
     float attack_display_duration = 0.1f;
-    bool attack = false;
 
     FightingCharacter(CharacterParams p, int player_number = 1) :
         p(p),
@@ -51,8 +50,21 @@ public:
     {
     }
 
+    ~FightingCharacter()
+    {
+        // The timer service is destroyed first when the whole scene goes.
+        if (timers_alive && *timers_alive)
+        {
+            timers->cancel(fall_through_timer);
+            timers->cancel(attack_display_timer);
+        }
+    }
+
     void init() override
     {
+        input = scene->game->get_manager<InputManager>();
+        timers = scene->get_service<TimerService>();
+        timers_alive = timers->alive;
 
         // Grab the physics service.
         // All get_service calls should be done in init(). get_service is not quick and this also allows us to test
@@ -201,26 +213,9 @@ public:
     void update(float delta_time) override
     {
         // Get input and route to movement component.
-        float deadzone = 0.1f;
-
-        const bool jump_pressed =
-            IsKeyPressed(KEY_W) || IsGamepadButtonPressed(gamepad, GAMEPAD_BUTTON_RIGHT_FACE_DOWN);
-        const bool jump_held = IsKeyDown(KEY_W) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_RIGHT_FACE_DOWN);
-
-        float move_x = 0.0f;
-        move_x = GetGamepadAxisMovement(gamepad, GAMEPAD_AXIS_LEFT_X);
-        if (fabsf(move_x) < deadzone)
-        {
-            move_x = 0.0f;
-        }
-        if (IsKeyDown(KEY_D) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_LEFT_FACE_RIGHT))
-        {
-            move_x = 1.0f;
-        }
-        else if (IsKeyDown(KEY_A) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_LEFT_FACE_LEFT))
-        {
-            move_x = -1.0f;
-        }
+        const bool jump_pressed = input->is_action_pressed("jump", gamepad);
+        const bool jump_held = input->is_action_down("jump", gamepad);
+        float move_x = input->get_action_value("move_right", gamepad) - input->get_action_value("move_left", gamepad);
 
         movement->set_input(move_x, jump_pressed, jump_held);
 
@@ -261,27 +256,18 @@ public:
         }
 
         // Custom one-way platform fall-through logic.
-        float move_y = GetGamepadAxisMovement(gamepad, GAMEPAD_AXIS_LEFT_Y);
-        if (IsKeyPressed(KEY_S) || IsGamepadButtonPressed(gamepad, GAMEPAD_BUTTON_LEFT_FACE_DOWN) || move_y > 0.5f)
-        {
-            fall_through = true;
-            fall_through_timer = fall_through_duration;
-        }
-
-        if (fall_through_timer > 0.0f)
+        float move_y = input->get_axis(gamepad, GAMEPAD_AXIS_LEFT_Y);
+        if (input->is_action_pressed("move_down", gamepad) || move_y > 0.5f)
         {
-            fall_through_timer = std::max(0.0f, fall_through_timer - delta_time);
-            if (fall_through_timer == 0.0f)
-            {
-                fall_through = false;
-            }
+            timers->cancel(fall_through_timer);
+            fall_through_timer = timers->schedule(fall_through_duration);
         }
 
         // Attack logic.
-        if (IsKeyPressed(KEY_SPACE) || IsGamepadButtonPressed(gamepad, GAMEPAD_BUTTON_RIGHT_FACE_RIGHT))
+        if (input->is_action_pressed("attack", gamepad))
         {
-            attack = true;
-            attack_display_timer = attack_display_duration;
+            timers->cancel(attack_display_timer);
+            attack_display_timer = timers->schedule(attack_display_duration);
             Vector2 position = body->get_position_pixels();
             position.x += (width / 2.0f + 8.0f) * (animation->flip_x ? -1.0f : 1.0f);
             auto bodies = physics->circle_overlap(position, 8.0f, body->id);
@@ -294,15 +280,6 @@ public:
             }
         }
 
-        if (attack_display_timer > 0.0f)
-        {
-            attack_display_timer = std::max(0.0f, attack_display_timer - delta_time);
-            if (attack_display_timer == 0.0f)
-            {
-                attack = false;
-            }
-        }
-
         // Death and respawn logic.
         if (body->get_position_pixels().y > level->get_size().y + 200.0f)
         {
@@ -316,7 +293,7 @@ public:
     void draw() override
     {
         // Draw attack indicator.
-        if (attack)
+        if (timers->is_pending(attack_display_timer))
         {
             Vector2 position = body->get_position_pixels();
             position.x += (width / 2.0f + 8.0f) * (animation->flip_x ? -1.0f : 1.0f);
@@ -360,7 +337,8 @@ public:
             return false;
         }
 
-        if (fall_through)
+        // Fall through platforms for a moment after pressing down.
+        if (timers->is_pending(fall_through_timer))
         {
             for (auto& platform : platforms)
             {
@@ -383,7 +361,8 @@ public:
 class FightingScene : public Scene
 {
 public:
-    RenderTexture2D renderer;
+    RenderTargetManager* render_targets;
+    int render_target = -1;
     Rectangle render_rect;
     std::vector<std::shared_ptr<StaticBox>> platforms;
     std::vector<std::shared_ptr<FightingCharacter>> characters;
@@ -395,7 +374,12 @@ public:
     {
         // TextureService and SoundService are needed by other components and game objects.
         add_service<TextureService>();
-        add_service<SoundService>();
+        // The sounds decode in the background while the level loads.
+        std::vector<std::string> sound_files = {
+            "assets/sounds/jump.wav", "assets/sounds/hit.wav", "assets/sounds/die.wav"};
+        add_service<SoundService>(sound_files, "assets/sounds/sounds.pcm");
+        // Timers used by the characters for cooldowns and delays.
+        add_service<TimerService>();
 
         // PhysicsService is used by LevelService and must be added first.
         physics = add_service<PhysicsService>();
@@ -409,7 +393,7 @@ public:
         auto window_manager = game->get_manager<WindowManager>();
 
         // Find one-way platform entities in the level and create StaticBox game objects for them.
-        auto platform_entities = level->get_entities_by_name("One_way_platform");
+        const auto& platform_entities = level->get_entities_by_name("One_way_platform");
         for (auto& platform_entity : platform_entities)
         {
             Vector2 position = level->convert_to_pixels(platform_entity->getPosition());
@@ -424,7 +408,7 @@ public:
         b2World_SetPreSolveCallback(physics->world, PreSolveStatic, this);
 
         // Create player characters at the "Start" entities.
-        auto player_entities = level->get_entities_by_name("Start");
+        const auto& player_entities = level->get_entities_by_name("Start");
 
         for (int i = 0; i < player_entities.size() && i < 4; i++)
         {
@@ -451,7 +435,9 @@ public:
         // Disable the background layer from drawing. We'll draw it manually in draw_scene().
         level->set_layer_visibility("Background", false);
 
-        renderer = LoadRenderTexture((int)level->get_size().x, (int)level->get_size().y);
+        // The level is pixel art, so keep it at full resolution and scale it up by whole numbers.
+        render_targets = game->get_manager<RenderTargetManager>();
+        render_target = render_targets->create_target((int)level->get_size().x, (int)level->get_size().y, true);
     }
 
     void update(float delta_time) override
@@ -498,12 +484,23 @@ public:
         render_rect = Rectangle{pos.x, pos.y, render_size.x, render_size.y};
 
         // Trigger scene change on Enter key or gamepad start button.
-        if (IsKeyPressed(KEY_ENTER) || IsGamepadButtonPressed(0, GAMEPAD_BUTTON_MIDDLE_RIGHT))
+        if (game->get_manager<InputManager>()->is_action_pressed("start"))
         {
             game->go_to_scene_next();
         }
     }
 
+    /**
+     * Give the render texture back to the RenderTargetManager when leaving the scene.
+     */
+    void on_exit() override
+    {
+        if (render_target >= 0)
+        {
+            render_targets->release_texture(render_target);
+        }
+    }
+
     /**
      * We override draw_scene instead of draw to control when Scene::draw_scene is called.
      * This allows us to draw the scene inside the camera's Begin/End block and render the camera to a texture.
@@ -511,7 +508,7 @@ public:
     void draw_scene() override
     {
         // Draw to render texture.
-        BeginTextureMode(renderer);
+        render_targets->begin_target(render_target);
         ClearBackground(MAGENTA);
 
         // Draw the background layer outside of the camera.
@@ -524,16 +521,10 @@ public:
         // camera->draw_debug();
         camera->draw_end();
 
-        EndTextureMode();
+        render_targets->end_target(render_target);
 
         // Draw centered.
-        DrawTexturePro(
-            renderer.texture,
-            Rectangle{0, 0, static_cast<float>(renderer.texture.width), -static_cast<float>(renderer.texture.height)},
-            render_rect,
-            Vector2{0.0f, 0.0f},
-            0.0f,
-            WHITE);
+        render_targets->draw_target(render_target, render_rect);
     }
 
     /**
@@ -7,16 +7,27 @@ class TitleScreen : public Scene
 public:
     Font font;
     std::string title = "Game Jam Kit";
+    TextLayout title_text;
+    TextLayout subtitle_text;
+
     void init() override
     {
         auto font_manager = game->get_manager<FontManager>();
         font = font_manager->get_font("Roboto");
+
+        // Lay the text out once, it never changes.
+        title_text = TextLayout(font, title, 64);
+        subtitle_text = TextLayout(font, "Press Start or Enter to Switch Scenes", 32);
+
+        // Roboto is an SDF font, so both sizes come from the same atlas.
+        title_text.shader = font_manager->get_shader("Roboto");
+        subtitle_text.shader = font_manager->get_shader("Roboto");
     }
 
     void update(float delta_time) override
     {
         // Trigger scene change on Enter key or gamepad start button.
-        if (IsKeyPressed(KEY_ENTER) || IsGamepadButtonPressed(0, GAMEPAD_BUTTON_MIDDLE_RIGHT))
+        if (game->get_manager<InputManager>()->is_action_pressed("start"))
         {
             game->go_to_scene_next();
         }
@@ -26,23 +37,11 @@ public:
     {
         auto width = GetScreenWidth();
         auto height = GetScreenHeight();
-        auto title_text_size = MeasureTextEx(font, title.c_str(), 64, 0);
-
-        std::string subtitle = "Press Start or Enter to Switch Scenes";
-        auto subtitle_text_size = MeasureTextEx(font, subtitle.c_str(), 32, 0);
+        auto title_text_size = title_text.get_size();
+        auto subtitle_text_size = subtitle_text.get_size();
 
         ClearBackground(SKYBLUE);
-        DrawTextEx(font,
-                   title.c_str(),
-                   {(width - title_text_size.x) / 2, (height - title_text_size.y - 100) / 2},
-                   64,
-                   1,
-                   WHITE);
-        DrawTextEx(font,
-                   subtitle.c_str(),
-                   {(width - subtitle_text_size.x) / 2, (height - subtitle_text_size.y + 100) / 2},
-                   32,
-                   1,
-                   WHITE);
+        title_text.draw({(width - title_text_size.x) / 2, (height - title_text_size.y - 100) / 2}, WHITE);
+        subtitle_text.draw({(width - subtitle_text_size.x) / 2, (height - subtitle_text_size.y + 100) / 2}, WHITE);
     }
 };
\ No newline at end of file
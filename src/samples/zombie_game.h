@@ -1,101 +1,20 @@
 /**
  * Demonstration of a top down shooter game.
- * Shows how to draw lights using custom blend modes.
+ * Shows how to draw lights that are blocked by walls with LightingService.
  */
 
 #pragma once
 
 #include "engine/prefabs/includes.h"
-#include "rlgl.h"
-
-// Custom Blend Modes for lights. See https://www.raylib.com/examples/shapes/loader.html?name=shapes_top_down_lights
-#define RLGL_SRC_ALPHA 0x0302
-#define RLGL_MIN 0x8007
 
 class ZombieScene;
 
 /**
- * A bullet fired by a character.
+ * Published when a zombie is shot.
  */
-class Bullet : public GameObject
+struct ZombieKilled
 {
-public:
-    PhysicsService* physics;
-    BodyComponent* body;
-    SpriteComponent* sprite;
-    SoundComponent* hit_sound;
-    float speed = 800.0f; // pixels per second
-
-    void init() override
-    {
-        physics = scene->get_service<PhysicsService>();
-
-        body = add_component<BodyComponent>(
-            [=](BodyComponent& b)
-            {
-                b2BodyDef body_def = b2DefaultBodyDef();
-                body_def.type = b2_dynamicBody;
-                body_def.isBullet = true;
-                // Start off-screen.
-                body_def.position = physics->convert_to_meters(Vector2{-1000.0f, -1000.0f});
-                body_def.userData = this;
-                b.id = b2CreateBody(physics->world, &body_def);
-
-                b2SurfaceMaterial body_material = b2DefaultSurfaceMaterial();
-                body_material.restitution = 0.0f;
-                body_material.friction = 0.0f;
-
-                b2ShapeDef circle_shape_def = b2DefaultShapeDef();
-                circle_shape_def.density = 0.25f;
-                circle_shape_def.material = body_material;
-
-                b2Circle circle_shape = {b2Vec2_zero, physics->convert_to_meters(8.0f)};
-                b2CreateCircleShape(b.id, &circle_shape_def, &circle_shape);
-            });
-
-        sprite = add_component<SpriteComponent>("assets/zombie_shooter/bullet.png", body);
-
-        hit_sound = add_component<SoundComponent>("assets/sounds/hit.wav");
-    }
-
-    void update(float delta_time) override
-    {
-        auto contacts = body->get_contacts();
-        for (const auto& contact : contacts)
-        {
-            // Deactivate the bullet if we hit anything.
-            is_active = false;
-            // Move it off-screen.
-            body->set_position(Vector2{-1000.0f, -1000.0f});
-            body->set_velocity(Vector2{0.0f, 0.0f});
-
-            GameObject* other = static_cast<GameObject*>(b2Body_GetUserData(contact));
-            if (other)
-            {
-                if (other->has_tag("zombie"))
-                {
-                    hit_sound->play();
-
-                    // Hit a zombie, deactivate it too.
-                    other->is_active = false;
-                    // Move it off-screen.
-                    auto zombie_body = other->get_component<BodyComponent>();
-                    if (zombie_body)
-                    {
-                        zombie_body->set_position(Vector2{-1000.0f, -1000.0f});
-                        zombie_body->set_velocity(Vector2{0.0f, 0.0f});
-                        zombie_body->disable();
-                    }
-                    auto zombie_sprite = other->get_component<SpriteComponent>();
-                    if (zombie_sprite)
-                    {
-                        zombie_sprite->set_position(Vector2{-1000.0f, -1000.0f});
-                    }
-                }
-                break;
-            }
-        }
-    }
+    Vector2 position;
 };
 
 /**
@@ -107,21 +26,30 @@ public:
     Vector2 position = {0, 0};
     BodyComponent* body;
     PhysicsService* physics;
+    InputManager* input;
     SpriteComponent* sprite;
     TopDownMovementComponent* movement;
     MultiComponent<SoundComponent>* sounds;
     SoundComponent* shoot_sound;
-    std::vector<std::shared_ptr<Bullet>> bullets;
+    ProjectileService* projectiles;
+    float bullet_speed = 800.0f; // pixels per second
     int player_num = 0;
     int health = 10;
-    float contact_timer = 1.0f;
+    TimerService* timers;
+    std::shared_ptr<bool> timers_alive;
+    TimerHandle contact_timer;
     float contact_cooldown = 0.3f;
 
-    TopDownCharacter(Vector2 position, std::vector<std::shared_ptr<Bullet>> bullets, int player_num = 0) :
-        position(position),
-        bullets(std::move(bullets)),
-        player_num(player_num)
+    TopDownCharacter(Vector2 position, int player_num = 0) : position(position), player_num(player_num) {}
+
+    ~TopDownCharacter()
     {
+        // The damage callback captures this, so it can't fire after we're gone.
+        // The timer service is destroyed first when the whole scene goes.
+        if (timers_alive && *timers_alive)
+        {
+            timers->cancel(contact_timer);
+        }
     }
 
     void init() override
@@ -130,6 +58,10 @@ public:
         // All get_service calls should be done in init(). get_service is not quick and this also allows us to test
         // that all services exist during init time.
         physics = scene->get_service<PhysicsService>();
+        projectiles = scene->get_service<ProjectileService>();
+        timers = scene->get_service<TimerService>();
+        timers_alive = timers->alive;
+        input = scene->game->get_manager<InputManager>();
 
         body = add_component<BodyComponent>(
             [=](BodyComponent& b)
@@ -170,27 +102,9 @@ public:
 
     void update(float delta_time) override
     {
-        Vector2 move = {0.0f, 0.0f};
-
-        move = {GetGamepadAxisMovement(player_num, GAMEPAD_AXIS_LEFT_X),
-                GetGamepadAxisMovement(player_num, GAMEPAD_AXIS_LEFT_Y)};
-
-        if (IsKeyDown(KEY_W) || IsGamepadButtonDown(player_num, GAMEPAD_BUTTON_LEFT_FACE_UP))
-        {
-            move.y -= 1.0f;
-        }
-        if (IsKeyDown(KEY_S) || IsGamepadButtonDown(player_num, GAMEPAD_BUTTON_LEFT_FACE_DOWN))
-        {
-            move.y += 1.0f;
-        }
-        if (IsKeyDown(KEY_A) || IsGamepadButtonDown(player_num, GAMEPAD_BUTTON_LEFT_FACE_LEFT))
-        {
-            move.x -= 1.0f;
-        }
-        if (IsKeyDown(KEY_D) || IsGamepadButtonDown(player_num, GAMEPAD_BUTTON_LEFT_FACE_RIGHT))
-        {
-            move.x += 1.0f;
-        }
+        Vector2 move = {
+            input->get_action_value("move_right", player_num) - input->get_action_value("move_left", player_num),
+            input->get_action_value("move_down", player_num) - input->get_action_value("move_up", player_num)};
 
         movement->set_input(move.x, move.y);
 
@@ -199,64 +113,56 @@ public:
         sprite->set_rotation(movement->facing_dir);
 
         // Shooting
-        if (IsKeyPressed(KEY_SPACE) || IsGamepadButtonPressed(player_num, GAMEPAD_BUTTON_RIGHT_FACE_RIGHT))
+        if (input->is_action_pressed("attack", player_num))
         {
-            // Find an inactive bullet from the pool.
-            for (auto& bullet : bullets)
-            {
-                if (!bullet->is_active)
-                {
-                    // Play shoot sound.
-                    shoot_sound->play();
-
-                    // Activate and position the bullet.
-                    Vector2 char_pos = body->get_position_pixels();
-                    Vector2 shoot_dir = {std::cos(movement->facing_dir * DEG2RAD),
-                                         std::sin(movement->facing_dir * DEG2RAD)};
-                    Vector2 bullet_start_pos = {char_pos.x + shoot_dir.x * 48.0f, char_pos.y + shoot_dir.y * 48.0f};
-                    bullet->body->set_position(bullet_start_pos);
-
-                    bullet->body->set_rotation(movement->facing_dir + 90.0f);
-
-                    // Set bullet velocity.
-                    Vector2 velocity = {shoot_dir.x * bullet->speed, shoot_dir.y * bullet->speed};
-                    bullet->body->set_velocity(velocity);
-                    bullet->is_active = true;
-                    break;
-                }
-            }
+            // Play shoot sound.
+            shoot_sound->play();
+
+            // Fire a bullet from in front of the character.
+            Vector2 char_pos = body->get_position_pixels();
+            Vector2 shoot_dir = {std::cos(movement->facing_dir * DEG2RAD), std::sin(movement->facing_dir * DEG2RAD)};
+            Vector2 bullet_start_pos = {char_pos.x + shoot_dir.x * 48.0f, char_pos.y + shoot_dir.y * 48.0f};
+            Vector2 velocity = {shoot_dir.x * bullet_speed, shoot_dir.y * bullet_speed};
+            projectiles->spawn(bullet_start_pos, velocity, 8.0f, 3.0f, body->id, this);
         }
 
         // Damage.
+        bool touching_zombie = false;
         auto contacts = body->get_contacts();
         for (const auto& contact : contacts)
         {
             GameObject* other = static_cast<GameObject*>(b2Body_GetUserData(contact));
-            if (other)
+            if (other && other->has_tag("zombie"))
             {
-                if (other->has_tag("zombie"))
-                {
-                    // When we are in contact with a zombie long enough, take 1 damage.
-                    if (contact_timer > 0.0f)
-                    {
-                        contact_timer -= delta_time;
-                    }
-                    if (contact_timer <= 0.0f)
-                    {
-                        health -= 1;
-                        contact_timer = contact_cooldown;
-                        if (health <= 0)
-                        {
-                            // Deactivate character.
-                            is_active = false;
-                            // Move off-screen.
-                            body->set_position(Vector2{-1000.0f, -1000.0f});
-                            body->set_velocity(Vector2{0.0f, 0.0f});
-                        }
-                    }
-                }
+                touching_zombie = true;
             }
         }
+
+        // When we are in contact with a zombie long enough, take 1 damage.
+        if (!touching_zombie)
+        {
+            timers->cancel(contact_timer);
+        }
+        else if (!timers->is_pending(contact_timer))
+        {
+            contact_timer = timers->schedule(contact_cooldown, [this]() { take_damage(); });
+        }
+    }
+
+    /**
+     * Take 1 damage, and deactivate the character when out of health.
+     */
+    void take_damage()
+    {
+        health -= 1;
+        if (health <= 0)
+        {
+            // Deactivate character.
+            is_active = false;
+            // Move off-screen.
+            body->set_position(Vector2{-1000.0f, -1000.0f});
+            body->set_velocity(Vector2{0.0f, 0.0f});
+        }
     }
 };
 
@@ -268,9 +174,12 @@ class Zombie : public GameObject
 public:
     BodyComponent* body;
     PhysicsService* physics;
+    CrowdService* crowd;
+    int agent = -1;
     SpriteComponent* sprite;
     TopDownMovementComponent* movement;
     std::vector<std::shared_ptr<TopDownCharacter>> players;
+    Vector2 chase_direction = {0, 0};
 
     Zombie(std::vector<std::shared_ptr<TopDownCharacter>> players) : players(std::move(players)) {}
 
@@ -278,6 +187,7 @@ public:
     {
         // Grab the physics service.
         physics = scene->get_service<PhysicsService>();
+        crowd = scene->get_service<CrowdService>();
 
         body = add_component<BodyComponent>(
             [=](BodyComponent& b)
@@ -308,11 +218,22 @@ public:
         mp.max_speed = 100.0f;
         movement = add_component<TopDownMovementComponent>(mp);
 
+        // The crowd keeps zombies from piling up on each other.
+        agent = crowd->add_agent(16.0f, mp.max_speed);
+
         // Setup sprite.
         sprite = add_component<SpriteComponent>("assets/zombie_shooter/zombie.png");
+
+        // Zombies far from every player pick who to chase less often.
+        add_component<UpdateLODComponent>([this](float delta_time) { choose_target(delta_time); }, body);
     }
 
-    void update(float delta_time) override
+    /**
+     * Pick the closest player to chase.
+     *
+     * @param delta_time The time since a target was last picked.
+     */
+    void choose_target(float delta_time)
     {
         // Find the closest player and move towards them.
         Vector2 closest_player_pos = {0, 0};
@@ -337,12 +258,32 @@ public:
             to_closest.x /= to_closest_len;
             to_closest.y /= to_closest_len;
         }
-        movement->set_input(to_closest.x, to_closest.y);
+        chase_direction = to_closest;
+    }
+
+    void update(float delta_time) override
+    {
+        // Steer around the other zombies on the way.
+        crowd->set_agent(agent, body->get_position_pixels(), body->get_velocity_pixels(), chase_direction);
+        Vector2 steering = crowd->get_steering(agent);
+        movement->set_input(steering.x, steering.y);
 
         // Update sprite position and rotation.
         sprite->set_position(body->get_position_pixels());
         sprite->set_rotation(movement->facing_dir);
     }
+
+    /**
+     * Deactivate the zombie and move it off-screen, returning it to the spawner's pool.
+     */
+    void die()
+    {
+        is_active = false;
+        body->set_position(Vector2{-1000.0f, -1000.0f});
+        body->set_velocity(Vector2{0.0f, 0.0f});
+        body->disable();
+        sprite->set_position(Vector2{-1000.0f, -1000.0f});
+    }
 };
 
 /**
@@ -351,7 +292,10 @@ public:
 class Spawner : public GameObject
 {
 public:
-    float spawn_timer = 0.0f;
+    TimerService* timers;
+    std::shared_ptr<bool> timers_alive;
+    TimerHandle first_spawn_timer;
+    TimerHandle spawn_timer;
     float spawn_interval = 1.0f; // Spawn a zombie every 1 second
     std::vector<std::shared_ptr<Zombie>> zombie_pool;
     Vector2 position = {0, 0};
@@ -364,27 +308,48 @@ public:
     {
     }
 
-    void update(float delta_time) override
+    ~Spawner()
     {
-        spawn_timer -= delta_time;
-        if (spawn_timer <= 0.0f)
+        // The spawn callbacks capture this, so they can't fire after we're gone.
+        // The timer service is destroyed first when the whole scene goes.
+        if (timers_alive && *timers_alive)
         {
-            spawn_timer = spawn_interval;
+            timers->cancel(first_spawn_timer);
+            timers->cancel(spawn_timer);
+        }
+    }
 
-            // Spawn a zombie at a random position within the spawner area
-            float x = position.x + static_cast<float>(GetRandomValue(0, static_cast<int>(size.x)));
-            float y = position.y + static_cast<float>(GetRandomValue(0, static_cast<int>(size.y)));
-            Vector2 spawn_pos = {x, y};
+    void init() override
+    {
+        timers = scene->get_service<TimerService>();
+        timers_alive = timers->alive;
+        // The first zombie comes right away, once everything is initialized.
+        first_spawn_timer = timers->schedule(0.0f, [this]() { spawn(); });
+        spawn_timer = timers->schedule_repeating(spawn_interval, [this]() { spawn(); });
+    }
+
+    /**
+     * Spawn a zombie from the pool at a random position within the spawner area.
+     */
+    void spawn()
+    {
+        if (!is_active)
+        {
+            return;
+        }
+
+        float x = position.x + static_cast<float>(GetRandomValue(0, static_cast<int>(size.x)));
+        float y = position.y + static_cast<float>(GetRandomValue(0, static_cast<int>(size.y)));
+        Vector2 spawn_pos = {x, y};
 
-            for (auto& zombie : zombie_pool)
+        for (auto& zombie : zombie_pool)
+        {
+            if (!zombie->is_active)
             {
-                if (!zombie->is_active)
-                {
-                    zombie->body->set_position(spawn_pos);
-                    zombie->is_active = true;
-                    zombie->body->enable();
-                    return;
-                }
+                zombie->body->set_position(spawn_pos);
+                zombie->is_active = true;
+                zombie->body->enable();
+                return;
             }
         }
     }
@@ -399,10 +364,17 @@ public:
     FontManager* font_manager;
     PhysicsService* physics;
     LevelService* level;
-    RenderTexture2D renderer;
-    RenderTexture2D light_map;
-    Texture2D light_texture;
-    std::vector<std::shared_ptr<Bullet>> bullets;
+    EventService* events;
+    ProjectileService* projectiles;
+    ParticleService* particles;
+    UpdateSchedulerService* scheduler;
+    ParticleParams spark_params;
+    LightingService* lighting;
+    RenderTargetManager* render_targets;
+    int render_target = -1;
+    Sound hit_sound;
+    UILayerService* ui;
+    UILabel* health_label;
     std::vector<std::shared_ptr<TopDownCharacter>> characters;
     std::vector<std::shared_ptr<Zombie>> zombies;
 
@@ -410,13 +382,37 @@ public:
     {
         // TextureService and SoundService are needed by other components and game objects.
         add_service<TextureService>();
-        add_service<SoundService>();
+        // The sounds decode in the background while the level loads.
+        std::vector<std::string> sound_files = {"assets/sounds/shoot.wav", "assets/sounds/hit.wav"};
+        add_service<SoundService>(sound_files, "assets/sounds/sounds.pcm");
+        // Timers used by the characters for cooldowns and delays.
+        add_service<TimerService>();
+        // Bullet hits are delivered as events.
+        events = add_service<EventService>();
 
         // Set gravity to zero for top-down game.
         physics = add_service<PhysicsService>(b2Vec2_zero);
+
+        // Spreads the zombies out so they don't stack up into one big physics pile.
+        add_service<CrowdService>();
+
+        // Zombies far from the players think less often.
+        scheduler = add_service<UpdateSchedulerService>();
         std::vector<std::string> collision_names = {"walls", "obstacles"};
         level = add_service<LevelService>("assets/levels/top_down.ldtk", "Level", collision_names);
 
+        // Bullets collide with the level's tile grid and the zombies' bodies.
+        projectiles = add_service<ProjectileService>("assets/zombie_shooter/bullet.png");
+
+        // Sparks where bullets hit.
+        particles = add_service<ParticleService>();
+
+        // Each player carries a light that is blocked by the level's walls.
+        lighting = add_service<LightingService>(Color{10, 10, 15, 255});
+
+        // The HUD only redraws when someone's health changes.
+        ui = add_service<UILayerService>();
+
         // Grab the font manager.
         font_manager = game->get_manager<FontManager>();
     }
@@ -425,24 +421,50 @@ public:
     {
         const auto& entities_layer = level->get_layer_by_name("Entities");
 
-        // Prepare a pool of bullets.
-        // It is unwise to call init during update loops, so we create all bullets here and deactivate them.
-        for (int i = 0; i < 100; i++)
+        // Handle bullets hitting zombies.
+        hit_sound = get_service<SoundService>()->get_sound("assets/sounds/hit.wav");
+        spark_params.lifetime_min = 0.1f;
+        spark_params.lifetime_max = 0.3f;
+        spark_params.speed_min = 100.0f;
+        spark_params.speed_max = 300.0f;
+        spark_params.spread = 120.0f;
+        spark_params.drag = 4.0f;
+        spark_params.size_start = 12.0f;
+        spark_params.size_end = 2.0f;
+        spark_params.color_start = YELLOW;
+        spark_params.color_end = ColorAlpha(ORANGE, 0.0f);
+        // Zombies die right away, so they can't hurt anyone after being shot.
+        projectiles->on_hit = [this](const ProjectileHit& hit)
         {
-            auto bullet = add_game_object<Bullet>();
-            // When is_active is false, update and draw are skipped.
-            bullet->is_active = false;
-            bullets.push_back(bullet);
-        }
+            // A zombie can be hit by more than one bullet in a frame, only the first one counts.
+            if (hit.object && hit.object->is_active && hit.object->has_tag("zombie"))
+            {
+                static_cast<Zombie*>(hit.object)->die();
+                events->publish(ZombieKilled{hit.point});
+            }
+        };
+        // Effects come through events, which only use the hit positions.
+        events->subscribe<ProjectileHit>(
+            [this](const std::vector<ProjectileHit>& hits)
+            {
+                for (const auto& hit : hits)
+                {
+                    // Spray sparks back along the hit normal.
+                    spark_params.direction = atan2f(hit.normal.y, hit.normal.x) * RAD2DEG;
+                    particles->burst("assets/zombie_shooter/light.png", hit.point, spark_params, 12);
+                }
+            });
+        // One sound for every zombie killed in a frame.
+        events->subscribe<ZombieKilled>([this](const std::vector<ZombieKilled>& killed) { PlaySound(hit_sound); });
 
         // Create player characters.
-        auto player_entities = level->get_entities_by_name("Start");
+        const auto& player_entities = level->get_entities_by_name("Start");
 
         for (int i = 0; i < player_entities.size() && i < 4; i++)
         {
             auto& player_entity = player_entities[i];
             auto position = level->convert_to_pixels(player_entity->getPosition());
-            auto character = add_game_object<TopDownCharacter>(position, bullets, i);
+            auto character = add_game_object<TopDownCharacter>(position, i);
             character->add_tag("player");
             characters.push_back(character);
         }
@@ -468,84 +490,77 @@ public:
         // We want to control when the foreground layer is drawn.
         level->set_layer_visibility("Foreground", false);
 
-        // Create render texture to scale the level to the screen.
-        renderer = LoadRenderTexture((int)level->get_size().x, (int)level->get_size().y);
-        light_map = LoadRenderTexture((int)level->get_size().x, (int)level->get_size().y);
+        // Create a render target to scale the level to the screen. It drops resolution when frames run long.
+        render_targets = game->get_manager<RenderTargetManager>();
+        render_target = render_targets->create_target((int)level->get_size().x, (int)level->get_size().y);
+
+        // Lay the HUD out at half the level's size so it scales with the window like the level does.
+        ui->size = level->get_size() / 2.0f;
+        ui->add_widget<UIPanel>(Rectangle{5.0f, 5.0f, 105.0f, 105.0f}, Fade(WHITE, 0.3f));
+        health_label = ui->add_widget<UILabel>(
+            font_manager->get_font("Roboto"), 22.5f, Vector2{10.0f, 10.0f}, RED, font_manager->get_shader("Roboto"));
 
-        light_texture = get_service<TextureService>()->get_texture("assets/zombie_shooter/light.png");
+        for (auto& character : characters)
+        {
+            lighting->add_light(character->body->get_position_pixels(), 300.0f, Color{255, 240, 200, 255});
+        }
     }
 
     void update(float delta_time) override
     {
         // Trigger scene change on Enter key or gamepad start button.
-        if (IsKeyPressed(KEY_ENTER) || IsGamepadButtonPressed(0, GAMEPAD_BUTTON_MIDDLE_RIGHT))
+        if (game->get_manager<InputManager>()->is_action_pressed("start"))
         {
             game->go_to_scene_next();
         }
-    }
 
-    void draw_scene() override
-    {
-        // Build up the light mask
-        BeginTextureMode(light_map);
-        ClearBackground(BLACK);
+        // Keep the lights on the players, and the zombies near them updating every frame.
+        scheduler->clear_focus_points();
+        for (int i = 0; i < (int)characters.size(); i++)
+        {
+            lighting->set_light_position(i, characters[i]->body->get_position_pixels());
+            lighting->set_light_active(i, characters[i]->is_active);
+            if (characters[i]->is_active)
+            {
+                scheduler->add_focus_point(characters[i]->body->get_position_pixels());
+            }
+        }
 
-        // Force the blend mode to only set the alpha of the destination
-        rlSetBlendFactors(RLGL_SRC_ALPHA, RLGL_SRC_ALPHA, RLGL_MIN);
-        rlSetBlendMode(BLEND_CUSTOM);
+        // Only formatted and redrawn when someone's health changes.
+        health_label->set_format("Health: %d\nHealth: %d\nHealth: %d\nHealth: %d",
+                                 characters[0]->health,
+                                 characters[1]->health,
+                                 characters[2]->health,
+                                 characters[3]->health);
+    }
 
-        // Merge in all the light masks
-        for (int i = 0; i < 4; i++)
+    void on_exit() override
+    {
+        if (render_target >= 0)
         {
-            // DrawCircleGradient((int)characters[i]->body->get_position_pixels().x,
-            //                    (int)characters[i]->body->get_position_pixels().y,
-            //                    300.0f,
-            //                    ColorAlpha(WHITE, 0),
-            //                    ColorAlpha(BLACK, 1));
-            DrawTexture(light_texture,
-                        (int)(characters[i]->body->get_position_pixels().x - light_texture.width / 2),
-                        (int)(characters[i]->body->get_position_pixels().y - light_texture.height / 2),
-                        WHITE);
+            render_targets->release_texture(render_target);
         }
+        ui->release_texture();
+    }
 
-        rlDrawRenderBatchActive();
-
-        // Go back to normal blend
-        rlSetBlendMode(BLEND_ALPHA);
-        EndTextureMode();
+    void draw_scene() override
+    {
+        // Draw the lights before starting on the scene's render texture.
+        lighting->render_lights();
 
         // Draw to render texture first.
-        BeginTextureMode(renderer);
+        render_targets->begin_target(render_target);
         ClearBackground(MAGENTA);
         Scene::draw_scene();
         level->draw_layer("Foreground");
-        DrawTexturePro(
-            light_map.texture,
-            {0.0f, 0.0f, static_cast<float>(light_map.texture.width), static_cast<float>(-light_map.texture.height)},
-            {0.0f, 0.0f, static_cast<float>(light_map.texture.width), static_cast<float>(light_map.texture.height)},
-            {0.0f, 0.0f},
-            0.0f,
-            ColorAlpha(WHITE, 0.92f));
-        DrawRectangle(10, 10, 210, 210, Fade(WHITE, 0.3f));
-        DrawTextEx(font_manager->get_font("Roboto"),
-                   TextFormat("Health: %d\nHealth: %d\nHealth: %d\nHealth: %d",
-                              characters[0]->health,
-                              characters[1]->health,
-                              characters[2]->health,
-                              characters[3]->health),
-                   Vector2{20.0f, 20.0f},
-                   45.0f,
-                   1.0f,
-                   RED);
-        EndTextureMode();
+        lighting->draw_light_map();
+        render_targets->end_target(render_target);
 
         // Draw the render texture scaled to the screen.
-        DrawTexturePro(
-            renderer.texture,
-            {0.0f, 0.0f, static_cast<float>(renderer.texture.width), static_cast<float>(-renderer.texture.height)},
-            {0.0f, 0.0f, static_cast<float>(GetScreenWidth()), static_cast<float>(GetScreenHeight())},
-            {0.0f, 0.0f},
-            0.0f,
-            WHITE);
+        Rectangle screen = {0.0f, 0.0f, static_cast<float>(GetScreenWidth()), static_cast<float>(GetScreenHeight())};
+        render_targets->draw_target(render_target, screen);
+
+        // Draw the HUD on top.
+        ui->draw_ui();
     }
 };
@@ -16,6 +16,9 @@ target("game_jam_kit")
     add_files("src/*.cpp")
     add_includedirs("src", { public = true })
     add_packages("raylib", "box2d", "ldtkloader")
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
 
     -- Copy assets to output directory after build
     after_build(function (target)